@@ -0,0 +1,112 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <json/json.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "model/map.h"
+#include "model/mapped.h"
+#include "model/loader.h"
+
+using namespace ::std;
+using namespace ::vprobot;
+using namespace ::vprobot::map;
+
+/* Перевести карту из файла модели в двоичный формат и записать
+ * файл модели, ссылающийся на нее */
+int Convert(const char *in_file, const char *out_file, const char *map_file) {
+	mapped::CMappedFile inp;
+
+	if (!inp.Open(in_file)) {
+		clog << in_file << ": " << strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	if (inp.GetSize() == 0) {
+		clog << in_file << ": empty model file" << endl;
+		return EXIT_FAILURE;
+	}
+
+	Json::Value root;
+	SMapGeometry Geometry;
+
+	if (!loader::ParseModel(inp.GetData(), inp.GetData() + inp.GetSize(), root,
+			Geometry))
+		return EXIT_FAILURE;
+	inp.Close();
+
+	Json::Value &SceneObject = root["scene"];
+	Json::Value &MapObject = SceneObject["map"];
+	string MapType(SceneObject["map_type"].asString());
+	bool Loaded, Saved;
+
+	if (MapType == "Point") {
+		CPointMap Map(MapObject, &Geometry);
+
+		Loaded = Map.IsLoaded();
+		Saved = Loaded && Map.Save(map_file);
+	} else if (MapType == "Line") {
+		CLineMap Map(MapObject, &Geometry);
+
+		Loaded = Map.IsLoaded();
+		Saved = Loaded && Map.Save(map_file);
+	} else if (MapType == "Grid") {
+		CGridMap Map(MapObject);
+
+		Loaded = Map.IsLoaded();
+		Saved = Loaded && Map.Save(map_file);
+	} else {
+		clog << "Unknown map type " << MapType << endl;
+		return EXIT_FAILURE;
+	}
+	if (!Loaded) {
+		clog << "Couldn't read map of " << in_file << endl;
+		return EXIT_FAILURE;
+	}
+	if (!Saved) {
+		clog << "Couldn't write map " << map_file << endl;
+		return EXIT_FAILURE;
+	}
+	MapObject.removeMember("points");
+	MapObject.removeMember("lines");
+	MapObject.removeMember("rows");
+	MapObject["file"] = map_file;
+
+	ofstream out(out_file, ios::out | ios::trunc);
+
+	if (!out) {
+		clog << out_file << ": " << strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	out << root;
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 4) {
+		cerr << "Usage: " << argv[0] << " model_file out_model_file map_file"
+				<< endl;
+		return EXIT_FAILURE;
+	}
+	return Convert(argv[1], argv[2], argv[3]);
+}
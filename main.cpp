@@ -17,8 +17,6 @@
  */
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <json/json.h>
 #include <cstdlib>
@@ -26,6 +24,10 @@
 
 #include "model/scene.h"
 #include "model/parser.h"
+#include "model/mapped.h"
+#include "model/loader.h"
+#include "model/profiler.h"
+#include "model/stats.h"
 #include "ui/ui.h"
 
 using namespace ::std;
@@ -34,26 +36,47 @@ using namespace ::vprobot::scene;
 using namespace ::vprobot::ui;
 
 int ParseAndRun(const char *in_file) {
-	std::ifstream inp(in_file);
-	std::stringstream json;
+	mapped::CMappedFile inp;
 
-	if (inp.fail()) {
-		clog << strerror(errno) << endl;
+	if (!inp.Open(in_file)) {
+		clog << in_file << ": " << strerror(errno) << endl;
+		return EXIT_FAILURE;
+	}
+	if (inp.GetSize() == 0) {
+		clog << in_file << ": empty model file" << endl;
 		return EXIT_FAILURE;
 	}
-	json << inp.rdbuf();
 
-	Json::Reader reader;
+	/* Разбор прямо из отображенного файла, геометрия карты читается
+	 * потоково, без дерева Json::Value */
 	Json::Value root;
+	vprobot::map::SMapGeometry Geometry;
 
-	if (!reader.parse(json.str(), root))
+	if (!loader::ParseModel(inp.GetData(), inp.GetData() + inp.GetSize(), root,
+			Geometry))
 		return EXIT_FAILURE;
+	inp.Close();
 
-	CScene *oScene = Scene(root["scene"]);
+	profiler::Enable(root["profile"].asBool());
+	profiler::EnableTrace(root["trace"].asString());
+	stats::Configure(root["stats"]);
+
+	CScene *oScene = Scene(root["scene"], &Geometry);
 
 	if (oScene == NULL)
 		return EXIT_FAILURE;
 
+	/* Контрольные точки: {"file": имя, "interval": период в шагах} */
+	const Json::Value &Checkpoint = root["checkpoint"];
+
+	oScene->SetCheckpoint(Checkpoint["file"].asString(),
+			Checkpoint.get("interval", 0).asUInt());
+	if (root.isMember("restore")
+			&& !oScene->LoadCheckpoint(root["restore"].asString())) {
+		delete oScene;
+		return EXIT_FAILURE;
+	}
+
 	CUI UI(*oScene, root["presentation"]);
 
 	UI.Process([&] {oScene->Simulate();});
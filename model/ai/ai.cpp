@@ -21,6 +21,7 @@
 #include <cmath>
 #include <cstring>
 
+#include "../stats.h"
 #include "../../types.h"
 
 using namespace ::std;
@@ -29,23 +30,29 @@ using namespace ::vprobot;
 using namespace ::vprobot::presentation;
 using namespace ::vprobot::robot;
 using namespace ::vprobot::control;
+using namespace ::vprobot::control::mapping;
 using namespace ::vprobot::control::ai;
 
 /* CAIControlSystem */
 
 vprobot::control::ai::CAIControlSystem::CAIControlSystem(
 		const Json::Value &ControlSystemObject) :
-		CControlSystem(ControlSystemObject), m_Generator(), m_States() {
-	random_device rd;
+		CControlSystem(ControlSystemObject), m_StatsInstance(
+				stats::NewInstance()), m_Generator(), m_States() {
+	if (ControlSystemObject.isMember("seed")) {
+		m_Generator.seed(ControlSystemObject["seed"].asUInt());
+	} else {
+		random_device rd;
 
-	m_Generator.seed(rd());
+		m_Generator.seed(rd());
+	}
 	RandomFunction = [&] {return generate_canonical<double, 10>(m_Generator);};
 
 	double i_Occ, i_Free;
 
-	m_Radius = 1 / ControlSystemObject["radius"].asDouble();
 	m_DRadius = ControlSystemObject["dradius"].asDouble();
-	m_Len = ControlSystemObject["len"].asDouble();
+	m_Motion.SetParameters(ControlSystemObject["len"].asDouble(),
+			1 / ControlSystemObject["radius"].asDouble());
 	m_DLen = ControlSystemObject["dlen"].asDouble();
 	m_MaxAngle = ControlSystemObject["max_angle"].asDouble();
 	m_DAngle = ControlSystemObject["dangle"].asDouble();
@@ -77,6 +84,17 @@ vprobot::control::ai::CAIControlSystem::CAIControlSystem(
 		m_NumCommands *= MaxCommand;
 	}
 
+	const SGridArea Area = {m_StartX, m_StartY, m_MapWidth, m_MapHeight};
+
+	m_SaveMap = ControlSystemObject["save_map"].asString();
+	if (!m_MapSet.empty())
+		LoadPrior(ControlSystemObject, m_MapSet[0], Area);
+
+	/* Маски контура робота (по умолчанию на 32 направления) */
+	m_Footprint.Build(m_RobotWidth, m_RobotHeight, Area, m_NumWidth,
+			m_NumHeight,
+			ControlSystemObject.get("footprint_directions", 32).asUInt());
+
 	double i_Exists, i_NExists;
 
 	m_DetectionThreshold = ControlSystemObject["beacons_threshold"].asDouble();
@@ -124,6 +142,9 @@ vprobot::control::ai::CAIControlSystem::CAIControlSystem(
 vprobot::control::ai::CAIControlSystem::~CAIControlSystem() {
 	size_t i;
 
+	SavePrior(m_SaveMap, m_MapSet,
+			{m_StartX, m_StartY, m_MapWidth, m_MapHeight});
+
 	for (i = 0; i < m_NumCommands; i++) {
 		delete[] m_CommandLibrary[i];
 	}
@@ -135,61 +156,69 @@ vprobot::control::ai::CAIControlSystem::~CAIControlSystem() {
 	delete[] m_Tree;
 }
 
-/* Получить команду */
-const ControlCommand * const vprobot::control::ai::CAIControlSystem::GetCommands(
+/* Учесть последнюю команду */
+void vprobot::control::ai::CAIControlSystem::ProcessCommands() {
+	/* TODO FastSLAM для локализации */
+	UpdateStates(m_LastCommand, m_States);
+}
+
+/* Учесть измерения */
+void vprobot::control::ai::CAIControlSystem::ProcessMeasurements(
 		const SMeasures * const *Measurements) {
+	/* TODO FastSLAM для локализации */
 	size_t i;
 
-	if (m_LastCommand != NULL) { /* TODO FastSLAM для локализации */
-		UpdateStates(m_LastCommand, m_States);
-	}
-	if (Measurements != NULL) { /* TODO FastSLAM для локализации */
-		for (i = 0; i < m_Count; i++) {
-			const SMeasuresDistances *i_Measurement =
-					dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
+	for (i = 0; i < m_Count; i++) {
+		const SMeasuresDistances *i_Measurement =
+				dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
 
-			if (i_Measurement == NULL)
-				continue;
+		if (i_Measurement == NULL)
+			continue;
 
-			double da = m_MaxAngle * 2 / i_Measurement->Value.rows(), dx =
-					m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight,
-					dd = sqrt(dx * dx + dy * dy);
-			size_t x, y;
-
-			for (x = 0; x < m_NumWidth; x++)
-				for (y = 0; y < m_NumHeight; y++) {
-					double cx = dx * (x + 0.5) + m_StartX
-							- m_States[i].s_MeanState[0], cy = dy * (y + 0.5)
-							+ m_StartY - m_States[i].s_MeanState[1], nangle;
-					int nx;
-
-					if (GreaterThan(abs(cx), m_MaxLength)
-							|| GreaterThan(abs(cy), m_MaxLength))
-						continue;
-					nangle = atan2(cy, cx);
-					nx = static_cast<int>((CorrectAngle(
-							nangle - m_States[i].s_MeanState[2]) + m_MaxAngle)
-							/ da);
-					if (nx >= 0 && nx < i_Measurement->Value.rows()) {
-						double md, d = i_Measurement->Value[nx], cd = sqrt(
-								cx * cx + cy * cy);
-
-						if (EqualsZero(d)) {
-							md = 0;
-							d = m_MaxLength;
-						} else {
-							md = d + dd;
-						}
-						if (LessOrEquals(cd, d)) {
-							m_MapSet[i].row(x)[y] += m_Free;
-						} else if (LessOrEquals(cd, md)) {
-							m_MapSet[i].row(x)[y] += m_Occ;
-						}
-					}
+		double da = m_MaxAngle * 2 / i_Measurement->Value.rows(), dx =
+				m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight,
+				dd = sqrt(dx * dx + dy * dy);
+		size_t x, y;
 
+		for (x = 0; x < m_NumWidth; x++)
+			for (y = 0; y < m_NumHeight; y++) {
+				double cx = dx * (x + 0.5) + m_StartX
+						- m_States[i].s_MeanState[0], cy = dy * (y + 0.5)
+						+ m_StartY - m_States[i].s_MeanState[1], nangle;
+				int nx;
+
+				if (GreaterThan(abs(cx), m_MaxLength)
+						|| GreaterThan(abs(cy), m_MaxLength))
+					continue;
+				nangle = atan2(cy, cx);
+				nx = static_cast<int>((CorrectAngle(
+						nangle - m_States[i].s_MeanState[2]) + m_MaxAngle)
+						/ da);
+				if (nx >= 0 && nx < i_Measurement->Value.rows()) {
+					double md, d = i_Measurement->Value[nx], cd = sqrt(
+							cx * cx + cy * cy);
+
+					if (EqualsZero(d)) {
+						md = 0;
+						d = m_MaxLength;
+					} else {
+						md = d + dd;
+					}
+					if (LessOrEquals(cd, d)) {
+						m_MapSet[i].row(x)[y] += m_Free;
+					} else if (LessOrEquals(cd, md)) {
+						m_MapSet[i].row(x)[y] += m_Occ;
+					}
 				}
-		}
+
+			}
 	}
+}
+
+/* Получить команду */
+const ControlCommand * const vprobot::control::ai::CAIControlSystem::GetCommands(
+		const SMeasures * const *Measurements) {
+	Process(Measurements);
 	if (GenerateCommands())
 		m_LastCommand = NULL;
 	return m_LastCommand;
@@ -216,19 +245,9 @@ void vprobot::control::ai::CAIControlSystem::DrawPresentation(
 			for (auto m : m_MapSet)
 				OutMap += m;
 		}
-
-		size_t i, j;
-		double dx = m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight, cx,
-				cy;
-
-		for (i = 0, cx = m_StartX; i < m_NumWidth; i++, cx += dx)
-			for (j = 0, cy = m_StartY; j < m_NumHeight; j++, cy += dy) {
-				double l = exp(OutMap.row(i)[j]);
-				int val = 255 - static_cast<int>(255 * l / (1 + l));
-
-				Driver.DrawRectangle(cx, cy, cx + dx, cy + dy, val, val, val,
-						255);
-			}
+		m_Image.FromLogOdds(OutMap);
+		m_Image.Draw(Driver, m_StartX, m_StartY, m_StartX + m_MapWidth,
+				m_StartY + m_MapHeight);
 		/*if (m_LastCommand != NULL) {
 		 for (i = 0; i < m_Count; i++) {
 		 Driver.DrawLine(m_Tree->States[i].s_MeanState[0],
@@ -249,12 +268,17 @@ void vprobot::control::ai::CAIControlSystem::DrawPresentation(
 
 /* Генерировать команды */
 bool vprobot::control::ai::CAIControlSystem::GenerateCommands() {
-	size_t n = 1;
+	stats::CStopwatch Stopwatch;
+	stats::SStepStats Stats("ai", m_StatsInstance, m_Time);
+	size_t n = 1, i;
 	GridMap OutMap = GridMap::Zero(m_NumWidth, m_NumHeight);
 
 	for (auto m : m_MapSet)
 		OutMap += m;
 	InitializeNode(m_Tree, NULL, OutMap, m_States);
+	CFootprint::MarkOccupied(m_Tree->Map, m_Tree->Occupied);
+	for (i = 0; i < m_Count; i++)
+		m_Footprint.Release(m_Tree->Occupied, m_States[i].s_MeanState);
 	UpdateY(m_Tree, m_Time);
 	while (n < m_NumSimulations) {
 		AddChild(m_Tree, m_Tree + n, m_Time + 1);
@@ -262,27 +286,35 @@ bool vprobot::control::ai::CAIControlSystem::GenerateCommands() {
 	}
 	m_Time++;
 
-	/* Debug output */
-	cout << m_Tree[0].SelfY << endl << m_Tree[0].BestY << endl << m_Tree[0].Q
-			<< endl << m_Tree[0].EndPoint << endl;
-
 	double diff = abs(m_Tree[0].SelfY - m_Tree[0].BestY);
 
-	if (GreaterThan(m_EndC, diff))
+	Stats.s_Playouts = m_NumSimulations - 1;
+	Stats.s_TreeSize = m_NumSimulations;
+	Stats.s_BestDepth = m_Tree[0].EndPoint - Stats.s_Step;
+	Stats.s_BestVisits = m_Tree[0].n_vis;
+	Stats.s_InitialY = m_Tree[0].SelfY;
+	Stats.s_MeanY = m_Tree[0].Q;
+	Stats.s_BestY = m_Tree[0].BestY;
+	Stats.s_ExpectedDiff = diff;
+	if (GreaterThan(m_EndC, diff)) {
+		Stats.s_Finished = true;
+		Stats.s_WallTime = Stopwatch.Elapsed();
+		stats::Record(Stats);
 		return true;
+	}
+	m_LastCommand = m_CommandLibrary[0];
+	Stats.s_Command = 0;
 	for (n = 0; n < m_NumCommands; n++) {
 		if (m_Tree[0].Fouls[n] || m_Tree[0].Childs[n] == NULL)
 			continue;
 		if (Equals(m_Tree[0].BestY, m_Tree[0].Childs[n]->BestY)) {
 			m_LastCommand = m_CommandLibrary[n];
-			/* Debug output */
-			cout << n << endl;
-			return false;
+			Stats.s_Command = n;
+			break;
 		}
 	}
-	m_LastCommand = m_CommandLibrary[0];
-	/* Debug output */
-	cout << 0 << endl;
+	Stats.s_WallTime = Stopwatch.Elapsed();
+	stats::Record(Stats);
 	return false;
 }
 
@@ -399,48 +431,9 @@ void vprobot::control::ai::CAIControlSystem::AddChild(STreeNode *Node,
 void vprobot::control::ai::CAIControlSystem::UpdateStates(
 		const ControlCommand *Commands, StateSet &States) {
 	size_t i;
-	for (i = 0; i < m_Count; i++) {
-		if (Commands[i] == Nothing)
-			continue;
-
-		Vector2d u;
-
-		switch (Commands[i]) {
-			case Forward:
-				u << m_Len, 0;
-				break;
-			case ForwardLeft:
-				u << m_Len, m_Radius;
-				break;
-			case ForwardRight:
-				u << m_Len, -m_Radius;
-				break;
-			case Backward:
-				u << -m_Len, 0;
-				break;
-			case BackwardLeft:
-				u << -m_Len, m_Radius;
-				break;
-			case BackwardRight:
-				u << -m_Len, -m_Radius;
-				break;
-			default:
-				break;
-		}
-		double nangle = States[i].s_MeanState[2];
-		double dx, dy;
 
-		if (EqualsZero(u[1])) {
-			dx = u[0] * cos(nangle);
-			dy = u[0] * sin(nangle);
-		} else {
-			nangle = CorrectAngle(nangle + u[0] * u[1]);
-			dx = (sin(nangle) - sin(States[i].s_MeanState[2])) / u[1];
-			dy = (cos(States[i].s_MeanState[2]) - cos(nangle)) / u[1];
-		}
-		Vector3d OldMean = States[i].s_MeanState;
-		States[i].s_MeanState << OldMean[0] + dx, OldMean[1] + dy, nangle;
-	}
+	for (i = 0; i < m_Count; i++)
+		m_Motion.Apply(States[i].s_MeanState, Commands[i]);
 }
 
 /* Проверить на фол */
@@ -451,13 +444,16 @@ bool vprobot::control::ai::CAIControlSystem::CheckForFoul(STreeNode *Node,
 	for (i = 0; i < m_Count; i++) {
 		int rx, ry;
 
+		/* Центр робота - в исследованной свободной клетке,
+		 * контур не задевает занятых клеток */
 		rx = static_cast<int>((States[i].s_MeanState[0] - m_StartX) / m_MapWidth
 				* m_NumWidth);
 		ry = static_cast<int>((States[i].s_MeanState[1] - m_StartY)
 				/ m_MapHeight * m_NumHeight);
 		if (rx < 0 || ry < 0 || rx >= static_cast<int>(m_NumWidth)
 				|| ry >= static_cast<int>(m_NumHeight)
-				|| !LessThanZero(Node->Map.row(rx)[ry]))
+				|| !LessThanZero(Node->Map.row(rx)[ry])
+				|| m_Footprint.Overlaps(Node->Occupied, States[i].s_MeanState))
 			return true;
 	}
 	return false;
@@ -566,4 +562,42 @@ void vprobot::control::ai::CAIControlSystem::UpdateMap(STreeNode *Node) {
 		odMap += dMap;
 	}
 	Node->Map += odMap;
+	CFootprint::MarkOccupied(Node->Map, Node->Occupied);
+	for (i = 0; i < m_Count; i++)
+		m_Footprint.Release(Node->Occupied, m_States[i].s_MeanState);
+}
+
+/* Записать состояние в контрольную точку */
+void vprobot::control::ai::CAIControlSystem::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	size_t i;
+
+	CControlSystem::SaveState(Writer);
+	Writer.PutTag("ai");
+	Writer.Put<int32_t>(m_Time);
+	Writer.PutEngine(m_Generator);
+	Writer.Put<uint64_t>(m_States.size());
+	for (i = 0; i < m_States.size(); i++) {
+		Writer.PutMatrix(m_States[i].s_MeanState);
+		Writer.PutMatrix(m_MapSet[i]);
+	}
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::control::ai::CAIControlSystem::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	int32_t Time;
+	uint64_t Count;
+	size_t i;
+
+	if (!CControlSystem::LoadState(Reader) || !Reader.ExpectTag("ai")
+			|| !Reader.Get(Time) || !Reader.GetEngine(m_Generator)
+			|| !Reader.Get(Count) || Count != m_States.size())
+		return false;
+	m_Time = Time;
+	for (i = 0; i < m_States.size(); i++)
+		if (!Reader.GetMatrix(m_States[i].s_MeanState)
+				|| !Reader.GetMatrix(m_MapSet[i]))
+			return false;
+	return true;
 }
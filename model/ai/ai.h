@@ -25,6 +25,7 @@
 
 #include <cstddef>
 #include <vector>
+#include <string>
 #include <functional>
 #include <random>
 #include <Eigen/Dense>
@@ -32,6 +33,9 @@
 #include "../presentation.h"
 #include "../robot.h"
 #include "../control.h"
+#include "../mapping/prior.h"
+#include "../bitgrid.h"
+#include "footprint.h"
 
 namespace vprobot {
 
@@ -46,11 +50,9 @@ public:
 	/* Набор карт */
 	typedef std::vector<GridMap> MapSet;
 private:
-	/* Обратный радус поворота */
-	double m_Radius;
 	double m_DRadius;
-	/* Длина перемещения */
-	double m_Len;
+	/* Модель движения */
+	vprobot::robot::CMotionModel m_Motion;
 	double m_DLen;
 	/* Угол отклонения */
 	double m_MaxAngle;
@@ -64,6 +66,8 @@ private:
 	/* Габариты робота */
 	double m_RobotWidth;
 	double m_RobotHeight;
+	/* Маски контура робота */
+	CFootprint m_Footprint;
 	/* Размеры карты */
 	double m_MapWidth;
 	double m_MapHeight;
@@ -72,8 +76,12 @@ private:
 	/* Начальная позиция */
 	double m_StartX;
 	double m_StartY;
+	/* Файл, в который карта сохраняется в конце работы */
+	std::string m_SaveMap;
 	/* Набор карт */
 	MapSet m_MapSet;
+	/* Изображение карты для вывода */
+	vprobot::presentation::CGridImage m_Image;
 	/* Граница для поиска маяков */
 	double m_DetectionThreshold;
 	/* Границы учета маяков */
@@ -95,6 +103,8 @@ private:
 	double m_EndC;
 	/* Текущее время */
 	int m_Time;
+	/* Номер экземпляра в статистике */
+	std::size_t m_StatsInstance;
 	/* Библиотека команд */
 	std::size_t m_NumCommands;
 	vprobot::robot::ControlCommand **m_CommandLibrary;
@@ -146,6 +156,8 @@ private:
 		std::size_t n_foul;
 		/* Карта */
 		GridMap Map;
+		/* Занятые клетки карты */
+		vprobot::bitgrid::CBitGrid Occupied;
 		/* Состояния роботов */
 		StateSet States;
 	};
@@ -172,6 +184,11 @@ private:
 
 	CAIControlSystem(const CAIControlSystem &AIControlSystem) = default;
 protected:
+	/* Учесть последнюю команду */
+	void ProcessCommands();
+	/* Учесть измерения */
+	void ProcessMeasurements(
+			const vprobot::robot::SMeasures * const *Measurements);
 	/* Парсинг параметров для экрана */
 	vprobot::presentation::SPresentationParameters *ParsePresentation(
 			const Json::Value &PresentationObject);
@@ -187,6 +204,11 @@ public:
 	/* Получить команду */
 	const vprobot::robot::ControlCommand * const GetCommands(
 			const vprobot::robot::SMeasures * const *Measurements);
+
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 }
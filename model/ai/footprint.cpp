@@ -0,0 +1,207 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "footprint.h"
+
+#include <cmath>
+
+#include "../../types.h"
+
+using namespace ::std;
+using namespace ::Eigen;
+using namespace ::vprobot;
+using namespace ::vprobot::bitgrid;
+using namespace ::vprobot::control;
+using namespace ::vprobot::control::mapping;
+
+/* CFootprint */
+
+vprobot::control::CFootprint::CFootprint() :
+		m_Masks(), m_Words(), m_Area(), m_ScaleX(0), m_ScaleY(0), m_AngleStep(
+				2 * PI) {
+}
+
+vprobot::control::CFootprint::~CFootprint() {
+}
+
+/* Пересекает ли повернутый прямоугольник прямоугольник со сторонами по осям
+ * (теорема о разделяющей оси, касание пересечением не считается) */
+bool vprobot::control::CFootprint::Intersects(double HalfX, double HalfY,
+		double c, double s, double x1, double y1, double x2, double y2) {
+	double hx = HalfX * std::abs(c) + HalfY * std::abs(s);
+	double hy = HalfX * std::abs(s) + HalfY * std::abs(c);
+	double cx = (x1 + x2) / 2, cy = (y1 + y2) / 2;
+	double ex = (x2 - x1) / 2, ey = (y2 - y1) / 2;
+
+	if (hx <= x1 || -hx >= x2 || hy <= y1 || -hy >= y2)
+		return false;
+	/* Оси робота */
+	if (std::abs(cx * c + cy * s) >= HalfX + ex * std::abs(c) + ey * std::abs(s))
+		return false;
+	if (std::abs(cy * c - cx * s) >= HalfY + ex * std::abs(s) + ey * std::abs(c))
+		return false;
+	return true;
+}
+
+/* Построить маски */
+void vprobot::control::CFootprint::Build(double Width, double Height,
+		const SGridArea &Area, size_t NumWidth, size_t NumHeight,
+		size_t Directions) {
+	double cw = Area.s_Width / NumWidth, ch = Area.s_Height / NumHeight;
+	double a = Width / 2, b = Height / 2;
+	size_t d;
+
+	if (Directions == 0)
+		Directions = 1;
+	m_Area = Area;
+	m_ScaleX = NumWidth / Area.s_Width;
+	m_ScaleY = NumHeight / Area.s_Height;
+	m_AngleStep = 2 * PI / Directions;
+	m_Masks.resize(Directions);
+	m_Words.clear();
+
+	/* Поворот в пределах половины сектора сдвигает точки контура
+	 * не больше, чем на Margin */
+	double Radius = sqrt(a * a + b * b);
+	double Margin = 2 * Radius * sin(m_AngleStep / 4);
+	int rx = static_cast<int>(ceil((Radius + Margin) / cw)) + 1;
+	int ry = static_cast<int>(ceil((Radius + Margin) / ch)) + 1;
+	vector<char> Hits((2 * rx + 1) * (2 * ry + 1));
+
+	for (d = 0; d < Directions; d++) {
+		double c = cos(d * m_AngleStep), s = sin(d * m_AngleStep);
+		int MinX = rx, MinY = ry, MaxX = -rx, MaxY = -ry, i, j;
+
+		/* Центр робота может быть где угодно в центральной клетке, поэтому
+		 * клетка (i, j) задевается, если контур пересекает ее, расширенную
+		 * на клетку влево и вниз */
+		for (j = -ry; j <= ry; j++) {
+			for (i = -rx; i <= rx; i++) {
+				bool Hit = Intersects(a + Margin, b + Margin, c, s,
+						(i - 1) * cw, (j - 1) * ch, (i + 1) * cw,
+						(j + 1) * ch);
+
+				Hits[(j + ry) * (2 * rx + 1) + i + rx] = Hit;
+				if (Hit) {
+					MinX = std::min(MinX, i);
+					MinY = std::min(MinY, j);
+					MaxX = std::max(MaxX, i);
+					MaxY = std::max(MaxY, j);
+				}
+			}
+		}
+
+		SMask &Mask = m_Masks[d];
+
+		Mask.s_X0 = MinX;
+		Mask.s_Y0 = MinY;
+		Mask.s_Width = MaxX - MinX + 1;
+		Mask.s_Height = MaxY - MinY + 1;
+		Mask.s_RowWords = (Mask.s_Width + 63) / 64;
+		Mask.s_Offset = m_Words.size();
+		m_Words.resize(m_Words.size() + Mask.s_RowWords * Mask.s_Height, 0);
+		for (j = MinY; j <= MaxY; j++) {
+			uint64_t *Row = &m_Words[Mask.s_Offset
+					+ (j - MinY) * Mask.s_RowWords];
+
+			for (i = MinX; i <= MaxX; i++)
+				if (Hits[(j + ry) * (2 * rx + 1) + i + rx])
+					Row[(i - MinX) >> 6] |= static_cast<uint64_t>(1)
+							<< ((i - MinX) & 63);
+		}
+	}
+}
+
+/* Задевает ли робот занятые клетки */
+bool vprobot::control::CFootprint::Overlaps(const CBitGrid &Grid,
+		const Vector3d &State) const {
+	int n = m_Masks.size();
+	int d = static_cast<int>(floor(State[2] / m_AngleStep + 0.5)) % n;
+
+	if (d < 0)
+		d += n;
+
+	const SMask &Mask = m_Masks[d];
+	double x0 = floor((State[0] - m_Area.s_StartX) * m_ScaleX) + Mask.s_X0;
+	double y0 = floor((State[1] - m_Area.s_StartY) * m_ScaleY) + Mask.s_Y0;
+
+	/* Маска обрезана по занятым клеткам, поэтому выход рамки за сетку -
+	 * выход робота */
+	if (!(x0 >= 0 && y0 >= 0 && x0 + Mask.s_Width <= Grid.GetWidth()
+			&& y0 + Mask.s_Height <= Grid.GetHeight()))
+		return true;
+
+	size_t x = static_cast<size_t>(x0), y = static_cast<size_t>(y0);
+	size_t First = x >> 6, Shift = x & 63, Words = Grid.GetRowWords(), r, k;
+	const uint64_t *m = &m_Words[Mask.s_Offset];
+
+	for (r = 0; r < Mask.s_Height; r++, m += Mask.s_RowWords) {
+		const uint64_t *Row = Grid.Row(y + r) + First;
+
+		for (k = 0; k < Mask.s_RowWords; k++) {
+			uint64_t Window = Row[k] >> Shift;
+
+			if (Shift != 0 && First + k + 1 < Words)
+				Window |= Row[k + 1] << (64 - Shift);
+			if ((Window & m[k]) != 0)
+				return true;
+		}
+	}
+	return false;
+}
+
+/* Освободить клетки под роботом */
+void vprobot::control::CFootprint::Release(CBitGrid &Grid,
+		const Vector3d &State) const {
+	int n = m_Masks.size();
+	int d = static_cast<int>(floor(State[2] / m_AngleStep + 0.5)) % n;
+
+	if (d < 0)
+		d += n;
+
+	const SMask &Mask = m_Masks[d];
+	double x0 = floor((State[0] - m_Area.s_StartX) * m_ScaleX) + Mask.s_X0;
+	double y0 = floor((State[1] - m_Area.s_StartY) * m_ScaleY) + Mask.s_Y0;
+	size_t i, j;
+
+	for (j = 0; j < Mask.s_Height; j++) {
+		const uint64_t *m = &m_Words[Mask.s_Offset + j * Mask.s_RowWords];
+		double y = y0 + j;
+
+		if (!(y >= 0 && y < Grid.GetHeight()))
+			continue;
+		for (i = 0; i < Mask.s_Width; i++) {
+			double x = x0 + i;
+
+			if (x >= 0 && x < Grid.GetWidth() && ((m[i >> 6] >> (i & 63)) & 1))
+				Grid.Set(static_cast<size_t>(x), static_cast<size_t>(y), false);
+		}
+	}
+}
+
+/* Отметить занятые клетки */
+void vprobot::control::CFootprint::MarkOccupied(const MatrixXd &Map,
+		CBitGrid &Grid) {
+	Index x, y;
+
+	Grid.Resize(Map.rows(), Map.cols());
+	for (y = 0; y < Map.cols(); y++)
+		for (x = 0; x < Map.rows(); x++)
+			if (GreaterThanZero(Map(x, y)))
+				Grid.Set(x, y);
+}
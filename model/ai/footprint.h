@@ -0,0 +1,102 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FOOTPRINT_H_
+#define __FOOTPRINT_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Dense>
+#include "../bitgrid.h"
+#include "../mapping/prior.h"
+
+namespace vprobot {
+
+namespace control {
+
+/* Проверка столкновений по прямоугольному контуру робота. Для каждого
+ * направления из заданного количества заранее строится маска клеток,
+ * которые может задеть робот с центром где угодно в центральной клетке
+ * и курсом в пределах сектора направления. Проверка позиции - AND масок
+ * со строками битовой сетки занятых клеток. */
+class CFootprint {
+private:
+	/* Маска направления: строки снизу вверх, бит i слова - клетка i */
+	struct SMask {
+		/* Смещение левой нижней клетки от центральной */
+		int s_X0;
+		int s_Y0;
+		/* Размеры в клетках и слов на строку */
+		std::size_t s_Width;
+		std::size_t s_Height;
+		std::size_t s_RowWords;
+		/* Начало слов маски в m_Words */
+		std::size_t s_Offset;
+	};
+
+	/* Маски по направлениям */
+	std::vector<SMask> m_Masks;
+	std::vector<std::uint64_t> m_Words;
+	/* Сетка */
+	vprobot::control::mapping::SGridArea m_Area;
+	double m_ScaleX;
+	double m_ScaleY;
+	/* Размер сектора направления */
+	double m_AngleStep;
+
+	/* Пересекает ли прямоугольник с центром в начале координат,
+	 * полуразмерами HalfX, HalfY и повернутый на угол с косинусом c и
+	 * синусом s, прямоугольник со сторонами по осям */
+	static bool Intersects(double HalfX, double HalfY, double c, double s,
+			double x1, double y1, double x2, double y2);
+public:
+	CFootprint();
+	~CFootprint();
+
+	/* Построить маски для робота с габаритами Width x Height при нулевом
+	 * курсе на сетке NumWidth x NumHeight, покрывающей Area */
+	void Build(double Width, double Height,
+			const vprobot::control::mapping::SGridArea &Area,
+			std::size_t NumWidth, std::size_t NumHeight,
+			std::size_t Directions);
+
+	/* Задевает ли робот в позиции State занятые клетки Grid
+	 * или выходит за сетку */
+	bool Overlaps(const vprobot::bitgrid::CBitGrid &Grid,
+			const Eigen::Vector3d &State) const;
+
+	/* Освободить клетки, которые задевает робот в позиции State (место,
+	 * где робот стоит, занятым быть не может - это шум карты) */
+	void Release(vprobot::bitgrid::CBitGrid &Grid,
+			const Eigen::Vector3d &State) const;
+
+	/* Отметить занятые клетки (логарифм шансов больше нуля) */
+	static void MarkOccupied(const Eigen::MatrixXd &Map,
+			vprobot::bitgrid::CBitGrid &Grid);
+};
+
+}
+
+}
+
+#endif
@@ -20,7 +20,12 @@
 
 #include <cmath>
 #include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <limits>
 
+#include "../profiler.h"
+#include "../stats.h"
 #include "../../types.h"
 
 using namespace ::std;
@@ -28,18 +33,24 @@ using namespace ::Eigen;
 using namespace ::vprobot;
 using namespace ::vprobot::presentation;
 using namespace ::vprobot::robot;
+using namespace ::vprobot::bitgrid;
 using namespace ::vprobot::control;
+using namespace ::vprobot::control::mapping;
 using namespace ::vprobot::control::mcts_ai;
 
 /* CMCTSAI */
 
 vprobot::control::mcts_ai::CMCTSAI::CMCTSAI(
 		const Json::Value &ControlSystemObject) :
-		CControlSystem(ControlSystemObject), m_Generator(), m_States(), m_Distribution(
-				0, 1) {
-	random_device rd;
+		CControlSystem(ControlSystemObject), m_Generator(), m_States(), m_StatsInstance(
+				stats::NewInstance()), m_Step(0), m_Distribution(0, 1) {
+	if (ControlSystemObject.isMember("seed")) {
+		m_Generator.seed(ControlSystemObject["seed"].asUInt());
+	} else {
+		random_device rd;
 
-	m_Generator.seed(rd());
+		m_Generator.seed(rd());
+	}
 	RandomFunction = [&] {return m_Distribution(m_Generator);};
 
 	double i_Occ, i_Free;
@@ -68,6 +79,16 @@ vprobot::control::mcts_ai::CMCTSAI::CMCTSAI(
 	m_StartX = ControlSystemObject["start_x"].asDouble();
 	m_StartY = ControlSystemObject["start_y"].asDouble();
 
+	const SGridArea Area = {m_StartX, m_StartY, m_MapWidth, m_MapHeight};
+
+	m_SaveMap = ControlSystemObject["save_map"].asString();
+	LoadPrior(ControlSystemObject, m_Map, Area);
+
+	/* Маски контура робота (по умолчанию на 32 направления) */
+	m_Footprint.Build(m_RobotWidth, m_RobotHeight, Area, m_NumWidth,
+			m_NumHeight,
+			ControlSystemObject.get("footprint_directions", 32).asUInt());
+
 	size_t i;
 	const Json::Value Params = ControlSystemObject["robot_params"];
 
@@ -80,6 +101,12 @@ vprobot::control::mcts_ai::CMCTSAI::CMCTSAI(
 		m_NumCommands *= MaxCommand;
 	}
 
+	m_Motion.SetParameters(m_Len, m_Radius);
+	m_RolloutFrontier =
+			ControlSystemObject.get("rollout_frontier", 0.0).asDouble();
+	m_MovePoses.resize(m_Count * MaxCommand);
+	m_MoveChecks.resize(m_Count * MaxCommand);
+
 	m_EndC = ControlSystemObject["end_c"].asDouble();
 	m_SelectC = ControlSystemObject["select_c"].asDouble();
 	m_AddMoves = ControlSystemObject["add_moves"].asInt();
@@ -91,6 +118,26 @@ vprobot::control::mcts_ai::CMCTSAI::CMCTSAI(
 		m_Tree[i].Fouls = new bool[m_NumCommands];
 	}
 
+	/* Таблица транспозиций: {"size", "position", "angle"}, по умолчанию
+	 * шаг - половина перемещения и поворот за один ход */
+	const Json::Value Transposition = ControlSystemObject["transposition"];
+
+	m_TranspositionPosition =
+			Transposition.get("position", m_Len / 2).asDouble();
+	m_TranspositionAngle =
+			Transposition.get("angle", m_Len * m_Radius).asDouble();
+	if (Transposition.isObject()) {
+		/* Ключ делится на шаги квантования */
+		if (!GreaterThanZero(m_TranspositionPosition)
+				|| !GreaterThanZero(m_TranspositionAngle))
+			clog << "Transposition position and angle must be positive, "
+					"table disabled" << endl;
+		else
+			m_Transpositions.Resize(
+					Transposition.get("size",
+							static_cast<Json::UInt>(4 * m_NumSimulations)).asUInt());
+	}
+
 	size_t j;
 
 	m_CommandLibrary = new ControlCommand *[m_NumCommands];
@@ -114,6 +161,8 @@ vprobot::control::mcts_ai::CMCTSAI::CMCTSAI(
 vprobot::control::mcts_ai::CMCTSAI::~CMCTSAI() {
 	size_t i;
 
+	SavePrior(m_SaveMap, m_Map, {m_StartX, m_StartY, m_MapWidth, m_MapHeight});
+
 	for (i = 0; i < m_NumCommands; i++) {
 		delete[] m_CommandLibrary[i];
 	}
@@ -136,93 +185,83 @@ void vprobot::control::mcts_ai::CMCTSAI::DrawPresentation(
 	const SGridPresentationPrameters *i_Params =
 			dynamic_cast<const SGridPresentationPrameters *>(Params);
 	if (i_Params != NULL) {
-		size_t i, j;
-		double dx = m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight, cx,
-				cy;
-
 		if (i_Params->m_Type == "Result map") {
-			for (i = 0, cx = m_StartX; i < m_NumWidth; i++, cx += dx) {
-				for (j = 0, cy = m_StartY; j < m_NumHeight; j++, cy += dy) {
-					double l = exp(m_Map.row(i)[j]);
-					int val = 255 - static_cast<int>(255 * l / (1 + l));
-
-					Driver.DrawRectangle(cx, cy, cx + dx, cy + dy, val, val,
-							val, 255);
-				}
-			}
+			m_Image.FromLogOdds(m_Map);
+			m_Image.Draw(Driver, m_StartX, m_StartY, m_StartX + m_MapWidth,
+					m_StartY + m_MapHeight);
 		} else if (i_Params->m_Type == "Mean map") {
 			if (m_NumMean > 0) {
-				for (i = 0, cx = m_StartX; i < m_NumWidth; i++, cx += dx) {
-					for (j = 0, cy = m_StartY; j < m_NumHeight; j++, cy += dy) {
-						double l = m_MeanMap.row(i)[j];
-						int val = 255 - static_cast<int>(l / m_NumMean * 255);
-
-						Driver.DrawRectangle(cx, cy, cx + dx, cy + dy, val, val,
-								val, 255);
-					}
-				}
+				m_Image.FromMean(m_MeanMap, m_NumMean);
+				m_Image.Draw(Driver, m_StartX, m_StartY, m_StartX + m_MapWidth,
+						m_StartY + m_MapHeight);
 			}
 		}
 	}
 }
 
-const ControlCommand * const vprobot::control::mcts_ai::CMCTSAI::GetCommands(
+/* Учесть последнюю команду */
+void vprobot::control::mcts_ai::CMCTSAI::ProcessCommands() {
+	UpdateStates(m_LastCommand, m_States);
+}
+
+/* Учесть измерения */
+void vprobot::control::mcts_ai::CMCTSAI::ProcessMeasurements(
 		const SMeasures * const *Measurements) {
 	size_t i;
 
-	m_MeanMap = GridMap::Zero(m_NumWidth, m_NumHeight);
-	m_NumMean = 0;
-	if (m_LastCommand != NULL) {
-		UpdateStates(m_LastCommand, m_States);
-	}
-	if (Measurements != NULL) {
-		for (i = 0; i < m_Count; i++) {
-			const SMeasuresDistances *i_Measurement =
-					dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
+	for (i = 0; i < m_Count; i++) {
+		const SMeasuresDistances *i_Measurement =
+				dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
 
-			if (i_Measurement == NULL)
-				continue;
+		if (i_Measurement == NULL)
+			continue;
 
-			double da = m_MaxAngle * 2 / i_Measurement->Value.rows(), dx =
-					m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight,
-					dd = sqrt(dx * dx + dy * dy);
-			size_t x, y;
-
-			for (x = 0; x < m_NumWidth; x++) {
-				for (y = 0; y < m_NumHeight; y++) {
-					double cx = dx * (x + 0.5) + m_StartX
-							- m_States[i].s_MeanState[0], cy = dy * (y + 0.5)
-							+ m_StartY - m_States[i].s_MeanState[1], nangle;
-					int nx;
-
-					if (GreaterThan(abs(cx), m_MaxLength)
-							|| GreaterThan(abs(cy), m_MaxLength))
-						continue;
-					nangle = atan2(cy, cx);
-					nx = static_cast<int>((CorrectAngle(
-							nangle - m_States[i].s_MeanState[2]) + m_MaxAngle)
-							/ da);
-					if (nx >= 0 && nx < i_Measurement->Value.rows()) {
-						double md, d = i_Measurement->Value[nx], cd = sqrt(
-								cx * cx + cy * cy);
-
-						if (EqualsZero(d)) {
-							md = 0;
-							d = m_MaxLength;
-						} else {
-							md = d + dd;
-						}
-						if (LessOrEquals(cd, d)) {
-							m_Map.row(x)[y] += m_Free;
-						} else if (LessOrEquals(cd, md)) {
-							m_Map.row(x)[y] += m_Occ;
-						}
-					}
+		double da = m_MaxAngle * 2 / i_Measurement->Value.rows(), dx =
+				m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight,
+				dd = sqrt(dx * dx + dy * dy);
+		size_t x, y;
+
+		for (x = 0; x < m_NumWidth; x++) {
+			for (y = 0; y < m_NumHeight; y++) {
+				double cx = dx * (x + 0.5) + m_StartX
+						- m_States[i].s_MeanState[0], cy = dy * (y + 0.5)
+						+ m_StartY - m_States[i].s_MeanState[1], nangle;
+				int nx;
 
+				if (GreaterThan(abs(cx), m_MaxLength)
+						|| GreaterThan(abs(cy), m_MaxLength))
+					continue;
+				nangle = atan2(cy, cx);
+				nx = static_cast<int>((CorrectAngle(
+						nangle - m_States[i].s_MeanState[2]) + m_MaxAngle)
+						/ da);
+				if (nx >= 0 && nx < i_Measurement->Value.rows()) {
+					double md, d = i_Measurement->Value[nx], cd = sqrt(
+							cx * cx + cy * cy);
+
+					if (EqualsZero(d)) {
+						md = 0;
+						d = m_MaxLength;
+					} else {
+						md = d + dd;
+					}
+					if (LessOrEquals(cd, d)) {
+						m_Map.row(x)[y] += m_Free;
+					} else if (LessOrEquals(cd, md)) {
+						m_Map.row(x)[y] += m_Occ;
+					}
 				}
+
 			}
 		}
 	}
+}
+
+const ControlCommand * const vprobot::control::mcts_ai::CMCTSAI::GetCommands(
+		const SMeasures * const *Measurements) {
+	m_MeanMap = GridMap::Zero(m_NumWidth, m_NumHeight);
+	m_NumMean = 0;
+	Process(Measurements);
 	if (GenerateCommands())
 		m_LastCommand = NULL;
 	return m_LastCommand;
@@ -231,48 +270,9 @@ const ControlCommand * const vprobot::control::mcts_ai::CMCTSAI::GetCommands(
 void vprobot::control::mcts_ai::CMCTSAI::UpdateStates(
 		const ControlCommand *Commands, StateSet &States) {
 	size_t i;
-	for (i = 0; i < m_Count; i++) {
-		if (Commands[i] == Nothing)
-			continue;
-
-		Vector2d u;
-
-		switch (Commands[i]) {
-			case Forward:
-				u << m_Len, 0;
-				break;
-			case ForwardLeft:
-				u << m_Len, m_Radius;
-				break;
-			case ForwardRight:
-				u << m_Len, -m_Radius;
-				break;
-			case Backward:
-				u << -m_Len, 0;
-				break;
-			case BackwardLeft:
-				u << -m_Len, m_Radius;
-				break;
-			case BackwardRight:
-				u << -m_Len, -m_Radius;
-				break;
-			default:
-				break;
-		}
-		double nangle = States[i].s_MeanState[2];
-		double dx, dy;
 
-		if (EqualsZero(u[1])) {
-			dx = u[0] * cos(nangle);
-			dy = u[0] * sin(nangle);
-		} else {
-			nangle = CorrectAngle(nangle + u[0] * u[1]);
-			dx = (sin(nangle) - sin(States[i].s_MeanState[2])) / u[1];
-			dy = (cos(States[i].s_MeanState[2]) - cos(nangle)) / u[1];
-		}
-		Vector3d OldMean = States[i].s_MeanState;
-		States[i].s_MeanState << OldMean[0] + dx, OldMean[1] + dy, nangle;
-	}
+	for (i = 0; i < m_Count; i++)
+		m_Motion.Apply(States[i].s_MeanState, Commands[i]);
 }
 
 bool vprobot::control::mcts_ai::CMCTSAI::CheckForStaticFoul(
@@ -282,33 +282,39 @@ bool vprobot::control::mcts_ai::CMCTSAI::CheckForStaticFoul(
 	for (i = 0; i < m_Count; i++) {
 		int rx, ry;
 
+		/* Центр робота - в исследованной свободной клетке,
+		 * контур не задевает занятых клеток */
 		rx = ConvertX(States[i].s_MeanState[0]);
-		ry = ConvertX(States[i].s_MeanState[1]);
+		ry = ConvertY(States[i].s_MeanState[1]);
 		if (rx < 0 || ry < 0 || rx >= static_cast<int>(m_NumWidth)
 				|| ry >= static_cast<int>(m_NumHeight)
-				|| !LessThanZero(m_Map.row(rx)[ry]))
+				|| !LessThanZero(m_Map.row(rx)[ry])
+				|| m_Footprint.Overlaps(m_Occupied, States[i].s_MeanState))
 			return true;
 	}
 	return false;
 }
 
-bool vprobot::control::mcts_ai::CMCTSAI::CheckForFoul(const BinaryMap &Map,
+/* Проверить позицию робота на фол */
+bool vprobot::control::mcts_ai::CMCTSAI::IsFoul(const CBitGrid &Map,
+		const Vector3d &State) {
+	return m_Footprint.Overlaps(Map, State);
+}
+
+bool vprobot::control::mcts_ai::CMCTSAI::CheckForFoul(const CBitGrid &Map,
 		const StateSet &States) {
 	size_t i;
 
 	for (i = 0; i < m_Count; i++) {
-		int rx, ry;
-
-		rx = ConvertX(States[i].s_MeanState[0]);
-		ry = ConvertX(States[i].s_MeanState[1]);
-		if (rx < 0 || ry < 0 || rx >= static_cast<int>(m_NumWidth)
-				|| ry >= static_cast<int>(m_NumHeight) || Map.row(rx)[ry])
+		if (IsFoul(Map, States[i].s_MeanState))
 			return true;
 	}
 	return false;
 }
 
 bool vprobot::control::mcts_ai::CMCTSAI::GenerateCommands() {
+	stats::CStopwatch Stopwatch;
+	stats::SStepStats Stats("mcts", m_StatsInstance, m_Step++);
 	double Y = 0;
 
 	size_t i, j;
@@ -317,28 +323,41 @@ bool vprobot::control::mcts_ai::CMCTSAI::GenerateCommands() {
 			Y += 1 / cosh(m_Map.row(i)[j] * 0.64);
 		}
 	}
+	m_Transpositions.Clear();
+	CFootprint::MarkOccupied(m_Map, m_Occupied);
+	for (i = 0; i < m_Count; i++)
+		m_Footprint.Release(m_Occupied, m_States[i].s_MeanState);
 	InitializeNode(m_Tree, NULL, m_States);
 	m_Tree[0].BestDepth = 0;
+	if (m_Transpositions.IsEnabled())
+		m_Tree[0].Key = StateKey(m_Tree[0].States, 0);
 
 	int cmd;
+	size_t n, Playouts = 0;
 
-	for (size_t n = 1; n < m_NumSimulations; n++) {
+	for (n = 1; n < m_NumSimulations; n++) {
 		STreeNode *FreeNode = m_Tree + n;
 		STreeNode *ParentNode = m_Tree;
-		for (;;) {
-			cmd = SelectNode(ParentNode);
-			if (cmd < 0) { //Terminate state
-				STreeNode *ParentNodeParent = ParentNode->Parent;
-				if (ParentNode->Parent == NULL)
+		{
+			profiler::CScopedTimer Timer(profiler::PhaseSelection);
+
+			for (;;) {
+				cmd = SelectNode(ParentNode);
+				if (cmd < 0) { //Terminate state
+					STreeNode *ParentNodeParent = ParentNode->Parent;
+					if (ParentNode->Parent == NULL)
+						break;
+					if (!ParentNodeParent->Fouls[ParentNode->cmd]) {
+						ParentNodeParent->Fouls[ParentNode->cmd] = true;
+						ParentNodeParent->n_fouls++;
+					}
+					ParentNode = ParentNodeParent;
+					continue;
+				}
+				if (ParentNode->Childs[cmd] == NULL)
 					break;
-				ParentNodeParent->Fouls[ParentNode->cmd] = true;
-				ParentNodeParent->n_fouls++;
-				ParentNode = ParentNodeParent;
-				continue;
+				ParentNode = ParentNode->Childs[cmd];
 			}
-			if (ParentNode->Childs[cmd] == NULL)
-				break;
-			ParentNode = ParentNode->Childs[cmd];
 		}
 		if (cmd < 0)
 			break;
@@ -348,10 +367,31 @@ bool vprobot::control::mcts_ai::CMCTSAI::GenerateCommands() {
 		UpdateStates(m_CommandLibrary[cmd], FreeNode->States);
 
 		SSample Sample;
+		const CTranspositionTable::SEntry *Entry = NULL;
 
-		GenerateSample(Sample, FreeNode);
-		Sample.Y += Y;
-		BackPropagation(Sample, FreeNode);
+		if (m_Transpositions.IsEnabled()) {
+			FreeNode->Key = StateKey(FreeNode->States, FreeNode->Depth);
+			Entry = m_Transpositions.Find(FreeNode->Key);
+		}
+		if (Entry != NULL) {
+			/* Состояние уже оценено по другому пути, новый семпл
+			 * не дал бы новой информации */
+			Sample.Y = Entry->s_Y / Entry->s_Visits;
+			Sample.Time = static_cast<int>(Entry->s_Time / Entry->s_Visits
+					+ 0.5);
+		} else {
+			{
+				profiler::CScopedTimer Timer(profiler::PhasePlayout);
+
+				GenerateSample(Sample, FreeNode);
+			}
+			Playouts++;
+			Sample.Y += Y;
+		}
+
+		profiler::CScopedTimer Timer(profiler::PhaseBackprop);
+
+		BackPropagation(Sample, FreeNode, Entry != NULL);
 	}
 
 	if (m_Tree[0].BestChildComputed >= 0) {
@@ -360,17 +400,28 @@ bool vprobot::control::mcts_ai::CMCTSAI::GenerateCommands() {
 		m_LastCommand = NULL;
 	}
 
-	cout << "Mean Y: " << m_Tree[0].Y / m_Tree[0].n_vis << endl << "Mean time: "
-			<< m_Tree[0].Time / m_Tree[0].n_vis << endl << "Total visits: "
-			<< m_Tree[0].n_vis << endl << "Best node depth: "
-			<< m_Tree[0].BestDepth << endl << "Best node visits: "
-			<< (m_Tree[0].BestChild >= 0 ?
-					m_Tree[0].Childs[m_Tree[0].BestChild]->n_vis : 0) << endl
-			<< "Initial Y: " << Y << endl << "Expected diff: "
-			<< abs(m_Tree[0].Y / m_Tree[0].n_vis - Y) << endl << endl;
-	if (GreaterThan(m_EndC, abs(m_Tree[0].Y / m_Tree[0].n_vis - Y)))
-		return true;
-	return false;
+	Stats.s_Playouts = Playouts;
+	Stats.s_TreeSize = n;
+	Stats.s_BestDepth = m_Tree[0].BestDepth;
+	Stats.s_BestVisits = (
+			m_Tree[0].BestChild >= 0 ?
+					m_Tree[0].Childs[m_Tree[0].BestChild]->n_vis : 0);
+	Stats.s_InitialY = Y;
+	Stats.s_Command = m_Tree[0].BestChildComputed;
+	if (m_Tree[0].n_vis > 0) {
+		Stats.s_MeanY = m_Tree[0].Y / m_Tree[0].n_vis;
+		Stats.s_MeanTime = m_Tree[0].Time / m_Tree[0].n_vis;
+		Stats.s_ExpectedDiff = abs(Stats.s_MeanY - Y);
+		Stats.s_Finished = GreaterThan(m_EndC, Stats.s_ExpectedDiff);
+	} else {
+		/* Симуляций не было (все команды фолят), оценок нет */
+		Stats.s_MeanY = Stats.s_MeanTime = Stats.s_ExpectedDiff =
+				numeric_limits<double>::quiet_NaN();
+		Stats.s_Finished = false;
+	}
+	Stats.s_WallTime = Stopwatch.Elapsed();
+	stats::Record(Stats);
+	return Stats.s_Finished;
 }
 
 int vprobot::control::mcts_ai::CMCTSAI::ConvertX(double x) {
@@ -382,7 +433,7 @@ int vprobot::control::mcts_ai::CMCTSAI::ConvertY(double y) {
 }
 
 double vprobot::control::mcts_ai::CMCTSAI::GoAround(GridMap &Map,
-		const BinaryMap &GeneratedMap, const StateSet &States) {
+		const CBitGrid &GeneratedMap, const StateSet &States) {
 	double deltaY = 0;
 	size_t i;
 
@@ -393,7 +444,7 @@ double vprobot::control::mcts_ai::CMCTSAI::GoAround(GridMap &Map,
 						/ m_MapWidth * m_NumWidth, cy = (dry - m_StartY)
 						/ m_MapHeight * m_NumHeight;
 		int rx = ConvertX(drx);
-		int ry = ConvertX(dry);
+		int ry = ConvertY(dry);
 		int x = max(
 				max(ConvertX(drx + m_MaxLength) - rx,
 						rx - ConvertX(drx - m_MaxLength)),
@@ -432,7 +483,7 @@ double vprobot::control::mcts_ai::CMCTSAI::GoAround(GridMap &Map,
 }
 
 double vprobot::control::mcts_ai::CMCTSAI::GoLinear(GridMap &Map,
-		const BinaryMap &GeneratedMap, BinaryMap &VisitedMap, double x0,
+		const CBitGrid &GeneratedMap, BinaryMap &VisitedMap, double x0,
 		double y0, double xf, double yf, double angle) {
 	double cy = yf - y0, cx = xf - x0;
 
@@ -491,7 +542,7 @@ double vprobot::control::mcts_ai::CMCTSAI::GoLinear(GridMap &Map,
 }
 
 bool vprobot::control::mcts_ai::CMCTSAI::GoExact(GridMap &Map,
-		const BinaryMap &GeneratedMap, BinaryMap &VisitedMap, int x, int y,
+		const CBitGrid &GeneratedMap, BinaryMap &VisitedMap, int x, int y,
 		int px, int py, double &CurY) {
 	if (x < 0 || x >= m_NumWidth || y < 0 || y >= m_NumHeight)
 		return false;
@@ -502,22 +553,22 @@ bool vprobot::control::mcts_ai::CMCTSAI::GoExact(GridMap &Map,
 	double oldP = Map.row(x)[y];
 	bool endFlag;
 
-	if (GeneratedMap.row(x)[y]) {
+	if (GeneratedMap.Get(x, y)) {
 		Map.row(x)[y] += m_Occ;
 		endFlag = true;
 	} else {
 		Map.row(x)[y] += m_Free;
 		endFlag = false;
 		if (px != x) {
-			if (GeneratedMap.row(px)[y]) {
+			if (GeneratedMap.Get(px, y)) {
 				endFlag = true;
 			} else if (py != y) {
-				if (GeneratedMap.row(px)[py] || GeneratedMap.row(x)[py]) {
+				if (GeneratedMap.Get(px, py) || GeneratedMap.Get(x, py)) {
 					endFlag = true;
 				}
 			}
 		} else if (py != y) {
-			if (GeneratedMap.row(x)[py]) {
+			if (GeneratedMap.Get(x, py)) {
 				endFlag = true;
 			}
 		}
@@ -530,7 +581,7 @@ void vprobot::control::mcts_ai::CMCTSAI::GenerateSample(SSample &Sample,
 		STreeNode *Node) {
 	GridMap TempMap = m_Map;
 	StateSet TempStates = Node->States;
-	BinaryMap GeneratedMap(m_NumWidth, m_NumHeight);
+	CBitGrid GeneratedMap(m_NumWidth, m_NumHeight);
 	size_t i, j, time = 0;
 	double diff;
 
@@ -538,9 +589,12 @@ void vprobot::control::mcts_ai::CMCTSAI::GenerateSample(SSample &Sample,
 		for (j = 0; j < m_NumHeight; j++) {
 			double t = RandomFunction(), l = exp(m_Map.row(i)[j]);
 
-			GeneratedMap.row(i)[j] = LessThan(t, l / (l + 1)) ? 1 : 0;
+			if (LessThan(t, l / (l + 1)))
+				GeneratedMap.Set(i, j);
 		}
 	}
+	for (i = 0; i < m_Count; i++)
+		m_Footprint.Release(GeneratedMap, m_States[i].s_MeanState);
 
 	STreeNode *BackNode = Node;
 
@@ -558,24 +612,14 @@ void vprobot::control::mcts_ai::CMCTSAI::GenerateSample(SSample &Sample,
 	}
 	i = m_AddMoves;
 	for (;;) {
-		const ControlCommand *cmd = m_CommandLibrary[0];
-		int cmdNum = static_cast<int>(RandomFunction() * (m_NumCommands - 1)),
-				cmdRand = cmdNum;
-		for (;;) {
-			cmdRand++;
-			if (cmdRand == m_NumCommands) {
-				cmdRand = 0;
-			}
-			if (cmdRand == cmdNum)
-				break;
-			StateSet CheckStates = TempStates;
-			UpdateStates(m_CommandLibrary[cmdRand], CheckStates);
-			if (!CheckForFoul(GeneratedMap, CheckStates)) {
-				cmd = m_CommandLibrary[cmdRand];
-				break;
-			}
+		const ControlCommand *cmd = m_CommandLibrary[SelectRolloutCommand(
+				TempMap, GeneratedMap, TempStates)];
+
+		/* Позиции выбранного хода уже посчитаны при проверке */
+		for (j = 0; j < m_Count; j++) {
+			if (cmd[j] != Nothing)
+				TempStates[j].s_MeanState = m_MovePoses[j * MaxCommand + cmd[j]];
 		}
-		UpdateStates(cmd, TempStates);
 		if (m_NumMean == 0) {
 			m_MeanMap.row(ConvertX(TempStates[0].s_MeanState[0]))[ConvertY(TempStates[0].s_MeanState[1])] = 1;
 		}
@@ -602,6 +646,101 @@ void vprobot::control::mcts_ai::CMCTSAI::GenerateSample(SSample &Sample,
 	m_NumMean++;
 }
 
+/* Проверить ход робота на сгенерированной карте (с запоминанием) */
+bool vprobot::control::mcts_ai::CMCTSAI::IsFreeMove(const CBitGrid &Map,
+		size_t Robot, ControlCommand Command) {
+	size_t n = Robot * MaxCommand + Command;
+
+	if (m_MoveChecks[n] == MoveUnknown)
+		m_MoveChecks[n] = IsFoul(Map, m_MovePoses[n]) ? MoveFoul : MoveFree;
+	return m_MoveChecks[n] == MoveFree;
+}
+
+/* Выбрать ход симуляции (номер в библиотеке команд) */
+size_t vprobot::control::mcts_ai::CMCTSAI::SelectRolloutCommand(
+		const GridMap &Map, const CBitGrid &GeneratedMap,
+		const StateSet &States) {
+	size_t j, k, Start;
+
+	/* Позиции по всем командам считаются сразу (один поворот на робота),
+	 * проверки - по мере необходимости */
+	for (j = 0; j < m_Count; j++)
+		m_Motion.ApplyAll(States[j].s_MeanState, &m_MovePoses[j * MaxCommand]);
+	fill(m_MoveChecks.begin(), m_MoveChecks.end(), MoveUnknown);
+	if (GreaterThanZero(m_RolloutFrontier)
+			&& LessThan(RandomFunction(), m_RolloutFrontier)) {
+		/* Роботы проверяются независимо, поэтому лучший общий ход -
+		 * лучший свободный ход каждого робота */
+		size_t Index = 0, Scale = 1;
+
+		for (j = 0; j < m_Count; j++) {
+			int c, Best = Nothing;
+			double BestScore = -1;
+
+			for (c = Nothing; c < MaxCommand; c++) {
+				if (!IsFreeMove(GeneratedMap, j,
+						static_cast<ControlCommand>(c)))
+					continue;
+
+				double Score = FrontierScore(Map,
+						m_MovePoses[j * MaxCommand + c]);
+
+				if (Score > BestScore) {
+					Best = c;
+					BestScore = Score;
+				}
+			}
+			Index += Best * Scale;
+			Scale *= MaxCommand;
+		}
+		return Index;
+	}
+	/* Первый свободный ход после случайного, ход каждого робота
+	 * проверяется не больше одного раза */
+	Start = static_cast<size_t>(RandomFunction() * (m_NumCommands - 1));
+	for (k = Start + 1;; k++) {
+		if (k == m_NumCommands)
+			k = 0;
+		if (k == Start)
+			break;
+		for (j = 0; j < m_Count; j++) {
+			if (!IsFreeMove(GeneratedMap, j, m_CommandLibrary[k][j]))
+				break;
+		}
+		if (j == m_Count)
+			return k;
+	}
+	/* Свободного хода нет, делается первый. Проверки могли не дойти до
+	 * его позиций, поэтому они считаются заново */
+	for (j = 0; j < m_Count; j++) {
+		ControlCommand Command = m_CommandLibrary[0][j];
+		Vector3d &Pose = m_MovePoses[j * MaxCommand + Command];
+
+		Pose = States[j].s_MeanState;
+		m_Motion.Apply(Pose, Command);
+	}
+	return 0;
+}
+
+/* Неопределенность карты в позиции робота и впереди на половине
+ * дальности сканера */
+double vprobot::control::mcts_ai::CMCTSAI::FrontierScore(const GridMap &Map,
+		const Vector3d &State) {
+	double Ahead = m_MaxLength / 2, Score = 0;
+	double x[2] = {State[0], State[0] + Ahead * cos(State[2])};
+	double y[2] = {State[1], State[1] + Ahead * sin(State[2])};
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		int rx = ConvertX(x[i]), ry = ConvertY(y[i]);
+
+		if (rx >= 0 && ry >= 0 && rx < static_cast<int>(m_NumWidth)
+				&& ry < static_cast<int>(m_NumHeight))
+			Score += 1 / cosh(Map.row(rx)[ry] * 0.64);
+	}
+	return Score;
+}
+
 void vprobot::control::mcts_ai::CMCTSAI::InitializeNode(STreeNode *Node,
 		STreeNode *Parent, const StateSet &States) {
 	size_t i;
@@ -615,6 +754,8 @@ void vprobot::control::mcts_ai::CMCTSAI::InitializeNode(STreeNode *Node,
 	Node->BestChild = -1;
 	Node->BestChildComputed = -1;
 	Node->BestDepth = 0;
+	Node->Depth = Parent == NULL ? 0 : Parent->Depth + 1;
+	Node->Key = 0;
 	for (i = 0; i < m_NumCommands; i++) {
 		Node->Childs[i] = NULL;
 		Node->Fouls[i] = false;
@@ -622,62 +763,66 @@ void vprobot::control::mcts_ai::CMCTSAI::InitializeNode(STreeNode *Node,
 }
 
 int vprobot::control::mcts_ai::CMCTSAI::SelectNode(STreeNode *Parent) {
-	size_t ret, i;
-	if ((Parent->n_vis + Parent->n_fouls) < m_NumCommands) {
-		for (;;) {
-			i = static_cast<ssize_t>(RandomFunction()
-					* (m_NumCommands - Parent->n_fouls - Parent->n_vis - 1));
-			for (ret = 0; i > 0 && ret < m_NumCommands; ret++) {
-				if (Parent->Fouls[ret] || Parent->Childs[ret] != NULL)
-					continue;
-				i--;
-			}
-			if (ret == m_NumCommands)
-				break;
-			StateSet TempStates = Parent->States;
-			UpdateStates(m_CommandLibrary[ret], TempStates);
-			if (!CheckForStaticFoul(TempStates))
+	size_t ret, i, n_free = 0, n_childs = 0;
+
+	for (i = 0; i < m_NumCommands; i++) {
+		if (Parent->Fouls[i])
+			continue;
+		if (Parent->Childs[i] == NULL)
+			n_free++;
+		else
+			n_childs++;
+	}
+	/* Сначала раскрываем все неопробованные команды */
+	while (n_free > 0) {
+		i = min(static_cast<size_t>(RandomFunction() * n_free), n_free - 1);
+		for (ret = 0; ret < m_NumCommands; ret++) {
+			if (Parent->Fouls[ret] || Parent->Childs[ret] != NULL)
+				continue;
+			if (i-- == 0)
 				break;
-			Parent->Fouls[ret] = true;
-			Parent->n_fouls++;
 		}
-		if (ret == m_NumCommands)
-			return -1;
-	} else {
-		if (GreaterThan(m_SelectC, RandomFunction())) {
-			if (Parent->BestChild >= 0 && Parent->Fouls[Parent->BestChild]) {
-				double bestY, curY, bestT, curT;
-
-				Parent->BestChild = -1;
-				for (i = 0; i < m_NumCommands; i++) {
-					if (Parent->Fouls[i] || Parent->Childs[i] == NULL)
-						continue;
-					curY = Parent->Childs[i]->Y / Parent->Childs[i]->n_vis;
-					curT = Parent->Childs[i]->Time / Parent->Childs[i]->n_vis;
-					if (Parent->BestChild < 0 || LessThan(curY, bestY)
-							|| (Equals(curY, bestY) && LessThan(curT, bestT))) {
-						Parent->BestChild = i;
-						bestT = curT;
-						bestY = curY;
-					}
-				}
-			}
-			return Parent->BestChild;
-		} else {
-			i = static_cast<ssize_t>(RandomFunction()
-					* (m_NumCommands - Parent->n_fouls - 1));
-			for (ret = 0; i > 0 && ret < m_NumCommands; ret++) {
-				if (Parent->Fouls[ret])
+		StateSet TempStates = Parent->States;
+		UpdateStates(m_CommandLibrary[ret], TempStates);
+		if (!CheckForStaticFoul(TempStates))
+			return ret;
+		Parent->Fouls[ret] = true;
+		Parent->n_fouls++;
+		n_free--;
+	}
+	if (n_childs == 0)
+		return -1;
+	if (GreaterThan(m_SelectC, RandomFunction())) {
+		if (Parent->BestChild < 0 || Parent->Fouls[Parent->BestChild]) {
+			double bestY = 0, curY, bestT = 0, curT;
+
+			Parent->BestChild = -1;
+			for (i = 0; i < m_NumCommands; i++) {
+				if (Parent->Fouls[i] || Parent->Childs[i] == NULL)
 					continue;
-				i--;
+				NodeValue(Parent->Childs[i], curY, curT);
+				if (Parent->BestChild < 0 || LessThan(curY, bestY)
+						|| (Equals(curY, bestY) && LessThan(curT, bestT))) {
+					Parent->BestChild = i;
+					bestT = curT;
+					bestY = curY;
+				}
 			}
 		}
+		return Parent->BestChild;
+	}
+	i = min(static_cast<size_t>(RandomFunction() * n_childs), n_childs - 1);
+	for (ret = 0; ret < m_NumCommands; ret++) {
+		if (Parent->Fouls[ret] || Parent->Childs[ret] == NULL)
+			continue;
+		if (i-- == 0)
+			break;
 	}
 	return ret;
 }
 
 void vprobot::control::mcts_ai::CMCTSAI::BackPropagation(const SSample &Sample,
-		STreeNode *Node) {
+		STreeNode *Node, bool Cached) {
 	STreeNode *CurrentNode = Node;
 	STreeNode *ParentNode;
 	STreeNode *BestChild;
@@ -688,16 +833,19 @@ void vprobot::control::mcts_ai::CMCTSAI::BackPropagation(const SSample &Sample,
 		CurrentNode->Y += Sample.Y;
 		CurrentNode->Time += Sample.Time;
 		CurrentNode->n_vis++;
+		/* Оценка из таблицы не является новым семплом */
+		if (!Cached)
+			m_Transpositions.Add(CurrentNode->Key, Sample.Y, Sample.Time);
 		ParentNode = CurrentNode->Parent;
 		if (ParentNode != NULL) {
 			if (ParentNode->BestChild < 0) {
 				ParentNode->BestChild = CurrentNode->cmd;
 			} else {
 				BestChild = ParentNode->Childs[ParentNode->BestChild];
-				double bestY = BestChild->Y / BestChild->n_vis, curY =
-						CurrentNode->Y / CurrentNode->n_vis, bestT =
-						BestChild->Time / BestChild->n_vis, curT =
-						CurrentNode->Time / CurrentNode->n_vis;
+				double bestY = 0, curY, bestT = 0, curT;
+
+				NodeValue(BestChild, bestY, bestT);
+				NodeValue(CurrentNode, curY, curT);
 				if (LessThan(curY, bestY)
 						|| (Equals(curY, bestY) && LessThan(curT, bestT))) {
 					ParentNode->BestChild = CurrentNode->cmd;
@@ -707,10 +855,10 @@ void vprobot::control::mcts_ai::CMCTSAI::BackPropagation(const SSample &Sample,
 				ParentNode->BestChildComputed = CurrentNode->cmd;
 			} else {
 				BestChild = ParentNode->Childs[ParentNode->BestChildComputed];
-				double bestY = BestChild->Y / BestChild->n_vis, curY =
-						CurrentNode->Y / CurrentNode->n_vis, bestT =
-						BestChild->Time / BestChild->n_vis, curT =
-						CurrentNode->Time / CurrentNode->n_vis;
+				double bestY = 0, curY, bestT = 0, curT;
+
+				NodeValue(BestChild, bestY, bestT);
+				NodeValue(CurrentNode, curY, curT);
 				if (LessThan(curY, bestY)
 						|| (Equals(curY, bestY) && LessThan(curT, bestT))) {
 					ParentNode->BestChildComputed = CurrentNode->cmd;
@@ -724,3 +872,72 @@ void vprobot::control::mcts_ai::CMCTSAI::BackPropagation(const SSample &Sample,
 		CurrentNode = ParentNode;
 	}
 }
+
+/* Ключ квантованного состояния на глубине Depth */
+uint64_t vprobot::control::mcts_ai::CMCTSAI::StateKey(const StateSet &States,
+		size_t Depth) {
+	uint64_t Key = CTranspositionTable::Mix(0, Depth);
+
+	for (auto &s : States) {
+		Key = CTranspositionTable::Mix(Key,
+				static_cast<int64_t>(floor(
+						s.s_MeanState[0] / m_TranspositionPosition)));
+		Key = CTranspositionTable::Mix(Key,
+				static_cast<int64_t>(floor(
+						s.s_MeanState[1] / m_TranspositionPosition)));
+		Key = CTranspositionTable::Mix(Key,
+				static_cast<int64_t>(floor(
+						CorrectAngle(s.s_MeanState[2])
+								/ m_TranspositionAngle)));
+	}
+	return Key;
+}
+
+/* Средние значения узла (из таблицы транспозиций, если есть) */
+void vprobot::control::mcts_ai::CMCTSAI::NodeValue(const STreeNode *Node,
+		double &Y, double &Time) const {
+	const CTranspositionTable::SEntry *Entry = m_Transpositions.Find(
+			Node->Key);
+
+	if (Entry != NULL) {
+		Y = Entry->s_Y / Entry->s_Visits;
+		Time = Entry->s_Time / Entry->s_Visits;
+	} else {
+		Y = Node->Y / Node->n_vis;
+		Time = Node->Time / Node->n_vis;
+	}
+}
+
+/* Записать состояние в контрольную точку (дерево строится заново на
+ * каждом шаге, поэтому не сохраняется) */
+void vprobot::control::mcts_ai::CMCTSAI::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	CControlSystem::SaveState(Writer);
+	Writer.PutTag("mcts");
+	Writer.Put<uint64_t>(m_Step);
+	Writer.PutEngine(m_Generator);
+	Writer.PutMatrix(m_Map);
+	Writer.PutMatrix(m_MeanMap);
+	Writer.Put<uint64_t>(m_NumMean);
+	Writer.Put<uint64_t>(m_States.size());
+	for (auto &s : m_States)
+		Writer.PutMatrix(s.s_MeanState);
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::control::mcts_ai::CMCTSAI::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	uint64_t NumMean, Count;
+
+	if (!CControlSystem::LoadState(Reader) || !Reader.ExpectTag("mcts")
+			|| !Reader.Get(m_Step) || !Reader.GetEngine(m_Generator)
+			|| !Reader.GetMatrix(m_Map) || !Reader.GetMatrix(m_MeanMap)
+			|| !Reader.Get(NumMean) || !Reader.Get(Count)
+			|| Count != m_States.size())
+		return false;
+	m_NumMean = NumMean;
+	for (auto &s : m_States)
+		if (!Reader.GetMatrix(s.s_MeanState))
+			return false;
+	return true;
+}
@@ -24,6 +24,7 @@
 #endif
 
 #include <cstddef>
+#include <cstdint>
 #include <random>
 #include <functional>
 #include <vector>
@@ -33,6 +34,10 @@
 #include "../presentation.h"
 #include "../robot.h"
 #include "../control.h"
+#include "../mapping/prior.h"
+#include "../bitgrid.h"
+#include "transposition.h"
+#include "footprint.h"
 
 namespace vprobot {
 
@@ -44,7 +49,7 @@ class CMCTSAI: public CControlSystem {
 public:
 	/* Графическая карта */
 	typedef Eigen::MatrixXd GridMap;
-	/* Сгенерированная карта */
+	/* Бинарная карта (посещенные клетки) */
 	typedef Eigen::MatrixXi BinaryMap;
 private:
 	/* Обратный радус поворота */
@@ -65,11 +70,17 @@ private:
 	/* Габариты робота */
 	double m_RobotWidth;
 	double m_RobotHeight;
+	/* Маски контура робота */
+	CFootprint m_Footprint;
 	/* Графическая карта */
 	GridMap m_Map;
+	/* Занятые клетки карты */
+	vprobot::bitgrid::CBitGrid m_Occupied;
 	/* Карта для отображения */
 	GridMap m_MeanMap;
 	std::size_t m_NumMean;
+	/* Изображение карты для вывода */
+	vprobot::presentation::CGridImage m_Image;
 	/* Размеры карты */
 	double m_MapWidth;
 	double m_MapHeight;
@@ -78,6 +89,8 @@ private:
 	/* Начальная позиция */
 	double m_StartX;
 	double m_StartY;
+	/* Файл, в который карта сохраняется в конце работы */
+	std::string m_SaveMap;
 	/* Библиотека команд */
 	std::size_t m_NumCommands;
 	vprobot::robot::ControlCommand **m_CommandLibrary;
@@ -91,6 +104,9 @@ private:
 	StateSet m_States;
 	/* Критерий окончания */
 	double m_EndC;
+	/* Номер экземпляра и шага в статистике */
+	std::size_t m_StatsInstance;
+	std::uint64_t m_Step;
 	/* Критерий выборки */
 	double m_SelectC;
 	/* Количество холостых ходов */
@@ -105,6 +121,17 @@ private:
 	std::uniform_real_distribution<double> m_Distribution;
 	/* Функция генератора случайных чисел */
 	std::function<double()> RandomFunction;
+	/* Модель движения */
+	vprobot::robot::CMotionModel m_Motion;
+	/* Вероятность выбора хода к неисследованной области в симуляции */
+	double m_RolloutFrontier;
+	/* Позиции роботов после каждой команды на текущем ходе симуляции
+	 * и результат проверки (MoveUnknown, если еще не проверялась) */
+	enum MoveCheck {
+		MoveUnknown = 0, MoveFree, MoveFoul
+	};
+	std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d>> m_MovePoses;
+	std::vector<unsigned char> m_MoveChecks;
 
 	/* Семпл данных */
 	struct SSample {
@@ -131,9 +158,17 @@ private:
 		int BestChildComputed;
 		StateSet States;
 		int BestDepth;
+		/* Глубина и ключ состояния в таблице транспозиций */
+		std::size_t Depth;
+		std::uint64_t Key;
 	};
 	/* Дерево */
 	STreeNode *m_Tree;
+	/* Таблица транспозиций (выключена, если не задана) */
+	CTranspositionTable m_Transpositions;
+	/* Шаг квантования координат и угла для ключа состояния */
+	double m_TranspositionPosition;
+	double m_TranspositionAngle;
 
 	/* Вывод данных */
 	struct SGridPresentationPrameters: public vprobot::presentation::SPresentationParameters {
@@ -147,21 +182,38 @@ private:
 	/* Обновить состояния */
 	void UpdateStates(const vprobot::robot::ControlCommand *Commands,
 			StateSet &States);
+	/* Проверить ход робота на сгенерированной карте (с запоминанием) */
+	bool IsFreeMove(const vprobot::bitgrid::CBitGrid &Map,
+			std::size_t Robot, vprobot::robot::ControlCommand Command);
+	/* Выбрать ход симуляции (номер в библиотеке команд), позиции роботов
+	 * после него остаются в m_MovePoses */
+	std::size_t SelectRolloutCommand(const GridMap &Map,
+			const vprobot::bitgrid::CBitGrid &GeneratedMap,
+			const StateSet &States);
+	/* Неопределенность карты вокруг позиции */
+	double FrontierScore(const GridMap &Map, const Eigen::Vector3d &State);
+	/* Проверить позицию робота на фол */
+	bool IsFoul(const vprobot::bitgrid::CBitGrid &Map,
+			const Eigen::Vector3d &State);
 	/* Проверить на фол */
-	bool CheckForFoul(const BinaryMap &Map, const StateSet &States);
+	bool CheckForFoul(const vprobot::bitgrid::CBitGrid &Map,
+			const StateSet &States);
 	/* Проверить на фол */
 	bool CheckForStaticFoul(const StateSet &States);
 	/* Генерировать команды */
 	bool GenerateCommands();
 	/* Пройти по кругу */
-	double GoAround(GridMap &Map, const BinaryMap &GeneratedMap,
+	double GoAround(GridMap &Map,
+			const vprobot::bitgrid::CBitGrid &GeneratedMap,
 			const StateSet &States);
 	/* Пройти по линии */
-	double GoLinear(GridMap &Map, const BinaryMap &GeneratedMap,
+	double GoLinear(GridMap &Map,
+			const vprobot::bitgrid::CBitGrid &GeneratedMap,
 			BinaryMap &VisitedMap, double x0, double y0, double xf, double yf,
 			double angle);
 	/* Обработать точку */
-	bool GoExact(GridMap &Map, const BinaryMap &GeneratedMap,
+	bool GoExact(GridMap &Map,
+			const vprobot::bitgrid::CBitGrid &GeneratedMap,
 			BinaryMap &VisitedMap, int x, int y, int px, int py, double &CurY);
 	/* Преобразовать x в номер */
 	int ConvertX(double x);
@@ -174,10 +226,20 @@ private:
 			const StateSet &States);
 	/* Выбор ветви */
 	int SelectNode(STreeNode *Parent);
-	/* Обратное распространение */
-	void BackPropagation(const SSample &Sample, STreeNode *Node);
+	/* Обратное распространение (Cached - оценка взята из таблицы
+	 * транспозиций, таблица не обновляется) */
+	void BackPropagation(const SSample &Sample, STreeNode *Node, bool Cached);
+	/* Ключ квантованного состояния на глубине Depth */
+	std::uint64_t StateKey(const StateSet &States, std::size_t Depth);
+	/* Средние значения узла (из таблицы транспозиций, если есть) */
+	void NodeValue(const STreeNode *Node, double &Y, double &Time) const;
 
 protected:
+	/* Учесть последнюю команду */
+	void ProcessCommands();
+	/* Учесть измерения */
+	void ProcessMeasurements(
+			const vprobot::robot::SMeasures * const *Measurements);
 	/* Парсинг параметров для экрана */
 	vprobot::presentation::SPresentationParameters *ParsePresentation(
 			const Json::Value &PresentationObject);
@@ -193,6 +255,11 @@ public:
 	/* Получить команду */
 	const vprobot::robot::ControlCommand * const GetCommands(
 			const vprobot::robot::SMeasures * const *Measurements);
+
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 }
@@ -21,6 +21,7 @@
 #include <cmath>
 #include <cstring>
 
+#include "../stats.h"
 #include "../../types.h"
 
 using namespace ::std;
@@ -29,18 +30,20 @@ using namespace ::vprobot;
 using namespace ::vprobot::presentation;
 using namespace ::vprobot::robot;
 using namespace ::vprobot::control;
+using namespace ::vprobot::control::mapping;
 using namespace ::vprobot::control::simple_ai;
 
 /* CSimpleAI */
 
 vprobot::control::simple_ai::CSimpleAI::CSimpleAI(
 		const Json::Value &ControlSystemObject) :
-		CControlSystem(ControlSystemObject), m_States() {
+		CControlSystem(ControlSystemObject), m_States(), m_StatsInstance(
+				stats::NewInstance()), m_Step(0) {
 	double i_Occ, i_Free;
 
-	m_Radius = 1 / ControlSystemObject["radius"].asDouble();
 	m_DRadius = ControlSystemObject["dradius"].asDouble();
-	m_Len = ControlSystemObject["len"].asDouble();
+	m_Motion.SetParameters(ControlSystemObject["len"].asDouble(),
+			1 / ControlSystemObject["radius"].asDouble());
 	m_DLen = ControlSystemObject["dlen"].asDouble();
 	m_MaxAngle = ControlSystemObject["max_angle"].asDouble();
 	m_DAngle = ControlSystemObject["dangle"].asDouble();
@@ -60,6 +63,16 @@ vprobot::control::simple_ai::CSimpleAI::CSimpleAI(
 	m_StartX = ControlSystemObject["start_x"].asDouble();
 	m_StartY = ControlSystemObject["start_y"].asDouble();
 
+	const SGridArea Area = {m_StartX, m_StartY, m_MapWidth, m_MapHeight};
+
+	m_SaveMap = ControlSystemObject["save_map"].asString();
+	LoadPrior(ControlSystemObject, m_Map, Area);
+
+	/* Маски контура робота (по умолчанию на 32 направления) */
+	m_Footprint.Build(m_RobotWidth, m_RobotHeight, Area, m_NumWidth,
+			m_NumHeight,
+			ControlSystemObject.get("footprint_directions", 32).asUInt());
+
 	size_t i;
 	const Json::Value Params = ControlSystemObject["robot_params"];
 
@@ -97,6 +110,8 @@ vprobot::control::simple_ai::CSimpleAI::CSimpleAI(
 vprobot::control::simple_ai::CSimpleAI::~CSimpleAI() {
 	size_t i;
 
+	SavePrior(m_SaveMap, m_Map, {m_StartX, m_StartY, m_MapWidth, m_MapHeight});
+
 	for (i = 0; i < m_NumCommands; i++) {
 		delete[] m_CommandLibrary[i];
 	}
@@ -114,75 +129,72 @@ void vprobot::control::simple_ai::CSimpleAI::DrawPresentation(
 	const SGridPresentationPrameters *i_Params =
 			dynamic_cast<const SGridPresentationPrameters *>(Params);
 	if (i_Params != NULL) {
-		size_t i, j;
-		double dx = m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight, cx,
-				cy;
-
-		for (i = 0, cx = m_StartX; i < m_NumWidth; i++, cx += dx)
-			for (j = 0, cy = m_StartY; j < m_NumHeight; j++, cy += dy) {
-				double l = exp(m_Map.row(i)[j]);
-				int val = 255 - static_cast<int>(255 * l / (1 + l));
-
-				Driver.DrawRectangle(cx, cy, cx + dx, cy + dy, val, val, val,
-						255);
-			}
+		m_Image.FromLogOdds(m_Map);
+		m_Image.Draw(Driver, m_StartX, m_StartY, m_StartX + m_MapWidth,
+				m_StartY + m_MapHeight);
 	}
 }
 
-const ControlCommand * const vprobot::control::simple_ai::CSimpleAI::GetCommands(
+/* Учесть последнюю команду */
+void vprobot::control::simple_ai::CSimpleAI::ProcessCommands() {
+	UpdateStates(m_LastCommand, m_States);
+}
+
+/* Учесть измерения */
+void vprobot::control::simple_ai::CSimpleAI::ProcessMeasurements(
 		const SMeasures * const *Measurements) {
 	size_t i;
 
-	if (m_LastCommand != NULL) {
-		UpdateStates(m_LastCommand, m_States);
-	}
-	if (Measurements != NULL) {
-		for (i = 0; i < m_Count; i++) {
-			const SMeasuresDistances *i_Measurement =
-					dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
-
-			if (i_Measurement == NULL)
-				continue;
-
-			double da = m_MaxAngle * 2 / i_Measurement->Value.rows(), dx =
-					m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight,
-					dd = sqrt(dx * dx + dy * dy);
-			size_t x, y;
-
-			for (x = 0; x < m_NumWidth; x++)
-				for (y = 0; y < m_NumHeight; y++) {
-					double cx = dx * (x + 0.5) + m_StartX
-							- m_States[i].s_MeanState[0], cy = dy * (y + 0.5)
-							+ m_StartY - m_States[i].s_MeanState[1], nangle;
-					int nx;
-
-					if (GreaterThan(abs(cx), m_MaxLength)
-							|| GreaterThan(abs(cy), m_MaxLength))
-						continue;
-					nangle = atan2(cy, cx);
-					nx = static_cast<int>((CorrectAngle(
-							nangle - m_States[i].s_MeanState[2]) + m_MaxAngle)
-							/ da);
-					if (nx >= 0 && nx < i_Measurement->Value.rows()) {
-						double md, d = i_Measurement->Value[nx], cd = sqrt(
-								cx * cx + cy * cy);
-
-						if (EqualsZero(d)) {
-							md = 0;
-							d = m_MaxLength;
-						} else {
-							md = d + dd;
-						}
-						if (LessOrEquals(cd, d)) {
-							m_Map.row(x)[y] += m_Free;
-						} else if (LessOrEquals(cd, md)) {
-							m_Map.row(x)[y] += m_Occ;
-						}
-					}
+	for (i = 0; i < m_Count; i++) {
+		const SMeasuresDistances *i_Measurement =
+				dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
 
+		if (i_Measurement == NULL)
+			continue;
+
+		double da = m_MaxAngle * 2 / i_Measurement->Value.rows(), dx =
+				m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight,
+				dd = sqrt(dx * dx + dy * dy);
+		size_t x, y;
+
+		for (x = 0; x < m_NumWidth; x++)
+			for (y = 0; y < m_NumHeight; y++) {
+				double cx = dx * (x + 0.5) + m_StartX
+						- m_States[i].s_MeanState[0], cy = dy * (y + 0.5)
+						+ m_StartY - m_States[i].s_MeanState[1], nangle;
+				int nx;
+
+				if (GreaterThan(abs(cx), m_MaxLength)
+						|| GreaterThan(abs(cy), m_MaxLength))
+					continue;
+				nangle = atan2(cy, cx);
+				nx = static_cast<int>((CorrectAngle(
+						nangle - m_States[i].s_MeanState[2]) + m_MaxAngle)
+						/ da);
+				if (nx >= 0 && nx < i_Measurement->Value.rows()) {
+					double md, d = i_Measurement->Value[nx], cd = sqrt(
+							cx * cx + cy * cy);
+
+					if (EqualsZero(d)) {
+						md = 0;
+						d = m_MaxLength;
+					} else {
+						md = d + dd;
+					}
+					if (LessOrEquals(cd, d)) {
+						m_Map.row(x)[y] += m_Free;
+					} else if (LessOrEquals(cd, md)) {
+						m_Map.row(x)[y] += m_Occ;
+					}
 				}
-		}
+
+			}
 	}
+}
+
+const ControlCommand * const vprobot::control::simple_ai::CSimpleAI::GetCommands(
+		const SMeasures * const *Measurements) {
+	Process(Measurements);
 	if (GenerateCommands())
 		m_LastCommand = NULL;
 	return m_LastCommand;
@@ -191,63 +203,29 @@ const ControlCommand * const vprobot::control::simple_ai::CSimpleAI::GetCommands
 void vprobot::control::simple_ai::CSimpleAI::UpdateStates(
 		const ControlCommand *Commands, StateSet &States) {
 	size_t i;
-	for (i = 0; i < m_Count; i++) {
-		if (Commands[i] == Nothing)
-			continue;
 
-		Vector2d u;
-
-		switch (Commands[i]) {
-			case Forward:
-				u << m_Len, 0;
-				break;
-			case ForwardLeft:
-				u << m_Len, m_Radius;
-				break;
-			case ForwardRight:
-				u << m_Len, -m_Radius;
-				break;
-			case Backward:
-				u << -m_Len, 0;
-				break;
-			case BackwardLeft:
-				u << -m_Len, m_Radius;
-				break;
-			case BackwardRight:
-				u << -m_Len, -m_Radius;
-				break;
-			default:
-				break;
-		}
-		double nangle = States[i].s_MeanState[2];
-		double dx, dy;
-
-		if (EqualsZero(u[1])) {
-			dx = u[0] * cos(nangle);
-			dy = u[0] * sin(nangle);
-		} else {
-			nangle = CorrectAngle(nangle + u[0] * u[1]);
-			dx = (sin(nangle) - sin(States[i].s_MeanState[2])) / u[1];
-			dy = (cos(States[i].s_MeanState[2]) - cos(nangle)) / u[1];
-		}
-		Vector3d OldMean = States[i].s_MeanState;
-		States[i].s_MeanState << OldMean[0] + dx, OldMean[1] + dy, nangle;
-	}
+	for (i = 0; i < m_Count; i++)
+		m_Motion.Apply(States[i].s_MeanState, Commands[i]);
 }
 
 bool vprobot::control::simple_ai::CSimpleAI::GenerateCommands() {
+	stats::CStopwatch Stopwatch;
+	stats::SStepStats Stats("simple", m_StatsInstance, m_Step++);
 	size_t i, x, y;
 	GridMap TempMap;
 	StateSet TempStates;
 	double BestY;
 	double CurY;
 	m_LastCommand = NULL;
+	CFootprint::MarkOccupied(m_Map, m_Occupied);
+	for (i = 0; i < m_Count; i++)
+		m_Footprint.Release(m_Occupied, m_States[i].s_MeanState);
 	for (i = 0; i < m_NumCommands; i++) {
-		TempMap = m_Map;
 		TempStates = m_States;
 		UpdateStates(m_CommandLibrary[i], TempStates);
-		if (CheckForFoul(TempMap, TempStates))
+		if (CheckForFoul(TempStates))
 			continue;
+		TempMap = m_Map;
 		UpdateMap(TempMap, TempStates);
 		CurY = 0;
 		for (x = 0; x < m_NumWidth; x++) {
@@ -258,7 +236,9 @@ bool vprobot::control::simple_ai::CSimpleAI::GenerateCommands() {
 		if (m_LastCommand == NULL || LessThan(CurY, BestY)) {
 			BestY = CurY;
 			m_LastCommand = m_CommandLibrary[i];
+			Stats.s_Command = i;
 		}
+		Stats.s_Playouts++;
 	}
 	CurY = 0;
 	for (x = 0; x < m_NumWidth; x++) {
@@ -269,31 +249,37 @@ bool vprobot::control::simple_ai::CSimpleAI::GenerateCommands() {
 	if (m_LastCommand == NULL) {
 		m_LastCommand = m_CommandLibrary[0];
 		BestY = CurY;
+		Stats.s_Command = 0;
 	}
 
-	cout << BestY << ' ' << CurY << endl;
-
 	double diff = abs(CurY - BestY);
 
-	if (GreaterThan(m_EndC, diff))
-		return true;
-	return false;
+	Stats.s_InitialY = CurY;
+	Stats.s_BestY = BestY;
+	Stats.s_ExpectedDiff = diff;
+	Stats.s_Finished = GreaterThan(m_EndC, diff);
+	Stats.s_WallTime = Stopwatch.Elapsed();
+	stats::Record(Stats);
+	return Stats.s_Finished;
 }
 
-bool vprobot::control::simple_ai::CSimpleAI::CheckForFoul(const GridMap &Map,
+bool vprobot::control::simple_ai::CSimpleAI::CheckForFoul(
 		const StateSet &States) {
 	size_t i;
 
 	for (i = 0; i < m_Count; i++) {
 		int rx, ry;
 
+		/* Центр робота - в исследованной свободной клетке,
+		 * контур не задевает занятых клеток */
 		rx = static_cast<int>((States[i].s_MeanState[0] - m_StartX) / m_MapWidth
 				* m_NumWidth);
 		ry = static_cast<int>((States[i].s_MeanState[1] - m_StartY)
 				/ m_MapHeight * m_NumHeight);
 		if (rx < 0 || ry < 0 || rx >= static_cast<int>(m_NumWidth)
 				|| ry >= static_cast<int>(m_NumHeight)
-				|| !LessThanZero(Map.row(rx)[ry]))
+				|| !LessThanZero(m_Map.row(rx)[ry])
+				|| m_Footprint.Overlaps(m_Occupied, States[i].s_MeanState))
 			return true;
 	}
 	return false;
@@ -402,3 +388,30 @@ void vprobot::control::simple_ai::CSimpleAI::UpdateMap(GridMap &Map,
 	}
 	Map += odMap;
 }
+
+/* Записать состояние в контрольную точку */
+void vprobot::control::simple_ai::CSimpleAI::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	CControlSystem::SaveState(Writer);
+	Writer.PutTag("simple-ai");
+	Writer.Put<uint64_t>(m_Step);
+	Writer.PutMatrix(m_Map);
+	Writer.Put<uint64_t>(m_States.size());
+	for (auto &s : m_States)
+		Writer.PutMatrix(s.s_MeanState);
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::control::simple_ai::CSimpleAI::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	uint64_t Count;
+
+	if (!CControlSystem::LoadState(Reader) || !Reader.ExpectTag("simple-ai")
+			|| !Reader.Get(m_Step) || !Reader.GetMatrix(m_Map)
+			|| !Reader.Get(Count) || Count != m_States.size())
+		return false;
+	for (auto &s : m_States)
+		if (!Reader.GetMatrix(s.s_MeanState))
+			return false;
+	return true;
+}
@@ -24,12 +24,17 @@
 #endif
 
 #include <cstddef>
+#include <cstdint>
 #include <vector>
+#include <string>
 #include <Eigen/Dense>
 #include <json/json.h>
 #include "../presentation.h"
 #include "../robot.h"
 #include "../control.h"
+#include "../mapping/prior.h"
+#include "../bitgrid.h"
+#include "footprint.h"
 
 namespace vprobot {
 
@@ -42,11 +47,9 @@ public:
 	/* Графическая карта */
 	typedef Eigen::MatrixXd GridMap;
 private:
-	/* Обратный радус поворота */
-	double m_Radius;
 	double m_DRadius;
-	/* Длина перемещения */
-	double m_Len;
+	/* Модель движения */
+	vprobot::robot::CMotionModel m_Motion;
 	double m_DLen;
 	/* Угол отклонения */
 	double m_MaxAngle;
@@ -60,8 +63,14 @@ private:
 	/* Габариты робота */
 	double m_RobotWidth;
 	double m_RobotHeight;
+	/* Маски контура робота */
+	CFootprint m_Footprint;
 	/* Графическая карта */
 	GridMap m_Map;
+	/* Занятые клетки карты */
+	vprobot::bitgrid::CBitGrid m_Occupied;
+	/* Изображение карты для вывода */
+	vprobot::presentation::CGridImage m_Image;
 	/* Размеры карты */
 	double m_MapWidth;
 	double m_MapHeight;
@@ -70,6 +79,8 @@ private:
 	/* Начальная позиция */
 	double m_StartX;
 	double m_StartY;
+	/* Файл, в который карта сохраняется в конце работы */
+	std::string m_SaveMap;
 	/* Библиотека команд */
 	std::size_t m_NumCommands;
 	vprobot::robot::ControlCommand **m_CommandLibrary;
@@ -83,6 +94,9 @@ private:
 	StateSet m_States;
 	/* Критерий окончания */
 	double m_EndC;
+	/* Номер экземпляра и шага в статистике */
+	std::size_t m_StatsInstance;
+	std::uint64_t m_Step;
 
 	/* Вывод данных */
 	struct SGridPresentationPrameters: public vprobot::presentation::SPresentationParameters {
@@ -99,10 +113,15 @@ private:
 	/* Обновить карту */
 	void UpdateMap(GridMap &Map, const StateSet &States);
 	/* Проверить на фол */
-	bool CheckForFoul(const GridMap &Map, const StateSet &States);
+	bool CheckForFoul(const StateSet &States);
 	/* Генерировать команды */
 	bool GenerateCommands();
 protected:
+	/* Учесть последнюю команду */
+	void ProcessCommands();
+	/* Учесть измерения */
+	void ProcessMeasurements(
+			const vprobot::robot::SMeasures * const *Measurements);
 	/* Парсинг параметров для экрана */
 	vprobot::presentation::SPresentationParameters *ParsePresentation(
 			const Json::Value &PresentationObject);
@@ -118,6 +137,11 @@ public:
 	/* Получить команду */
 	const vprobot::robot::ControlCommand * const GetCommands(
 			const vprobot::robot::SMeasures * const *Measurements);
+
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 }
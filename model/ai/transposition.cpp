@@ -0,0 +1,102 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "transposition.h"
+
+#include <cstring>
+
+using namespace ::std;
+using namespace ::vprobot::control::mcts_ai;
+
+/* CTranspositionTable */
+
+vprobot::control::mcts_ai::CTranspositionTable::CTranspositionTable() :
+		m_Entries(), m_Mask(0) {
+}
+
+vprobot::control::mcts_ai::CTranspositionTable::~CTranspositionTable() {
+}
+
+/* Задать размер (округляется до степени двойки, 0 - таблица выключена) */
+void vprobot::control::mcts_ai::CTranspositionTable::Resize(size_t Size) {
+	size_t Buckets = 1;
+
+	if (Size == 0) {
+		m_Entries.clear();
+		m_Mask = 0;
+		return;
+	}
+	while (Buckets * BucketSize < Size)
+		Buckets <<= 1;
+	m_Entries.resize(Buckets * BucketSize);
+	m_Mask = Buckets - 1;
+	Clear();
+}
+
+/* Очистить таблицу */
+void vprobot::control::mcts_ai::CTranspositionTable::Clear() {
+	if (!m_Entries.empty())
+		memset(m_Entries.data(), 0, m_Entries.size() * sizeof(SEntry));
+}
+
+/* Найти запись (NULL, если состояние не встречалось или вытеснено) */
+const CTranspositionTable::SEntry *vprobot::control::mcts_ai::CTranspositionTable::Find(
+		uint64_t Key) const {
+	const SEntry *Bucket;
+	size_t i;
+
+	if (m_Entries.empty())
+		return NULL;
+	Key = ValidKey(Key);
+	Bucket = &m_Entries[(Key & m_Mask) * BucketSize];
+	for (i = 0; i < BucketSize; i++)
+		if (Bucket[i].s_Key == Key)
+			return Bucket + i;
+	return NULL;
+}
+
+/* Учесть семпл для состояния */
+void vprobot::control::mcts_ai::CTranspositionTable::Add(uint64_t Key,
+		double Y, double Time) {
+	SEntry *Bucket, *Entry = NULL;
+	size_t i;
+
+	if (m_Entries.empty())
+		return;
+	Key = ValidKey(Key);
+	Bucket = &m_Entries[(Key & m_Mask) * BucketSize];
+	for (i = 0; i < BucketSize; i++) {
+		if (Bucket[i].s_Key == Key) {
+			Entry = Bucket + i;
+			break;
+		}
+		/* Иначе занимаем пустую или наименее посещенную запись */
+		if (Entry == NULL || Bucket[i].s_Visits < Entry->s_Visits)
+			Entry = Bucket + i;
+	}
+	if (Entry->s_Key != Key) {
+		Entry->s_Key = Key;
+		Entry->s_Visits = 0;
+		Entry->s_Y = 0;
+		Entry->s_Time = 0;
+	}
+	Entry->s_Visits++;
+	Entry->s_Y += Y;
+	Entry->s_Time += Time;
+}
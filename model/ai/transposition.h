@@ -0,0 +1,98 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __TRANSPOSITION_H_
+#define __TRANSPOSITION_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vprobot {
+
+namespace control {
+
+namespace mcts_ai {
+
+/* Таблица транспозиций: общая статистика узлов, пришедших в одно
+ * состояние разными путями. Записи фиксированного размера без указателей
+ * лежат в корзинах по строке кэша, ключ 0 означает пустую запись. */
+class CTranspositionTable {
+public:
+	/* Статистика состояния */
+	struct SEntry {
+		std::uint64_t s_Key;
+		std::uint64_t s_Visits;
+		double s_Y;
+		double s_Time;
+	};
+private:
+	/* Записей в корзине */
+	static const std::size_t BucketSize = 2;
+
+	/* Записи */
+	std::vector<SEntry> m_Entries;
+	/* Маска номера корзины */
+	std::size_t m_Mask;
+
+	/* Ключ 0 занят пустыми записями */
+	static inline std::uint64_t ValidKey(std::uint64_t Key) {
+		return Key == 0 ? 1 : Key;
+	}
+
+	CTranspositionTable(const CTranspositionTable &Table) = default;
+public:
+	CTranspositionTable();
+	~CTranspositionTable();
+
+	/* Задать размер (округляется до степени двойки, 0 - таблица выключена) */
+	void Resize(std::size_t Size);
+	/* Очистить таблицу */
+	void Clear();
+	/* Таблица используется */
+	inline bool IsEnabled() const {
+		return !m_Entries.empty();
+	}
+	/* Найти запись (NULL, если состояние не встречалось или вытеснено) */
+	const SEntry *Find(std::uint64_t Key) const;
+	/* Учесть семпл для состояния */
+	void Add(std::uint64_t Key, double Y, double Time);
+
+	/* Ключ по квантованным значениям */
+	static inline std::uint64_t Mix(std::uint64_t Hash, std::int64_t Value) {
+		std::uint64_t z = Hash + static_cast<std::uint64_t>(Value)
+				+ 0x9E3779B97F4A7C15ULL;
+
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+};
+
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,78 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "bitgrid.h"
+
+using namespace ::std;
+
+/* CBitGrid */
+
+vprobot::bitgrid::CBitGrid::CBitGrid() :
+		m_Width(0), m_Height(0), m_RowWords(0), m_Words() {
+}
+
+vprobot::bitgrid::CBitGrid::CBitGrid(size_t Width, size_t Height) :
+		CBitGrid() {
+	Resize(Width, Height);
+}
+
+/* Изменить размеры (все клетки свободны) */
+void vprobot::bitgrid::CBitGrid::Resize(size_t Width, size_t Height) {
+	m_Width = Width;
+	m_Height = Height;
+	m_RowWords = (Width + 63) / 64;
+	m_Words.assign(m_RowWords * m_Height, 0);
+}
+
+/* Заполнить уменьшенной копией */
+void vprobot::bitgrid::CBitGrid::Downsample(const CBitGrid &Grid,
+		size_t Factor) {
+	size_t x, y, w;
+
+	Resize((Grid.m_Width + Factor - 1) / Factor,
+			(Grid.m_Height + Factor - 1) / Factor);
+	/* Пустые слова пропускаются целиком */
+	for (y = 0; y < Grid.m_Height; y++) {
+		const uint64_t *r = Grid.Row(y);
+
+		for (w = 0; w < Grid.m_RowWords; w++) {
+			uint64_t Word = r[w];
+
+			while (Word != 0) {
+				x = w * 64 + __builtin_ctzll(Word);
+				Set(x / Factor, y / Factor);
+				/* Остаток блока в этом слове уже учтен */
+				size_t Next = (x / Factor + 1) * Factor;
+
+				if (Next >= (w + 1) * 64)
+					break;
+				Word &= ~static_cast<uint64_t>(0) << (Next - w * 64);
+			}
+		}
+	}
+}
+
+/* Количество занятых клеток */
+size_t vprobot::bitgrid::CBitGrid::Count() const {
+	size_t Result = 0;
+
+	for (auto w : m_Words)
+		Result += __builtin_popcountll(w);
+	return Result;
+}
@@ -0,0 +1,93 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __BITGRID_H_
+#define __BITGRID_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vprobot {
+
+namespace bitgrid {
+
+/* Сетка занятости по биту на клетку. Строки (нулевая - снизу) выровнены
+ * на 64-битные слова, бит x % 64 слова x / 64 - клетка x */
+class CBitGrid {
+private:
+	/* Размеры */
+	std::size_t m_Width;
+	std::size_t m_Height;
+	/* Слов на строку */
+	std::size_t m_RowWords;
+	/* Слова по строкам */
+	std::vector<std::uint64_t> m_Words;
+public:
+	CBitGrid();
+	CBitGrid(std::size_t Width, std::size_t Height);
+
+	/* Изменить размеры (все клетки свободны) */
+	void Resize(std::size_t Width, std::size_t Height);
+	/* Заполнить уменьшенной в Factor раз копией Grid: клетка занята,
+	 * если занята хотя бы одна клетка ее блока Factor x Factor */
+	void Downsample(const CBitGrid &Grid, std::size_t Factor);
+	/* Количество занятых клеток */
+	std::size_t Count() const;
+
+	/* Клетка занята */
+	inline bool Get(std::size_t x, std::size_t y) const {
+		return (m_Words[y * m_RowWords + (x >> 6)] >> (x & 63)) & 1;
+	}
+	/* Отметить клетку */
+	inline void Set(std::size_t x, std::size_t y, bool Value = true) {
+		std::uint64_t &Word = m_Words[y * m_RowWords + (x >> 6)];
+		std::uint64_t Bit = static_cast<std::uint64_t>(1) << (x & 63);
+
+		Word = Value ? Word | Bit : Word & ~Bit;
+	}
+	/* Слова строки */
+	inline const std::uint64_t *Row(std::size_t y) const {
+		return m_Words.data() + y * m_RowWords;
+	}
+	inline std::uint64_t *Row(std::size_t y) {
+		return m_Words.data() + y * m_RowWords;
+	}
+
+	/* Размеры */
+	inline std::size_t GetWidth() const {
+		return m_Width;
+	}
+	inline std::size_t GetHeight() const {
+		return m_Height;
+	}
+	inline std::size_t GetRowWords() const {
+		return m_RowWords;
+	}
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,129 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "checkpoint.h"
+
+#include <cstdio>
+#include <fstream>
+
+using namespace ::std;
+using namespace ::vprobot::checkpoint;
+
+namespace {
+
+const char CheckpointMagic[8] = {'V', 'P', 'R', 'C', 'K', 'P', 'T', 0};
+const uint32_t CheckpointVersion = 1;
+
+/* Заголовок файла контрольной точки */
+struct SCheckpointHeader {
+	char s_Magic[8];
+	uint32_t s_Version;
+	uint32_t s_Reserved;
+	uint64_t s_Size;
+};
+
+}
+
+/* CWriter */
+
+vprobot::checkpoint::CWriter::CWriter() :
+		m_Data() {
+}
+
+vprobot::checkpoint::CWriter::~CWriter() {
+}
+
+/* Записать строку */
+void vprobot::checkpoint::CWriter::PutString(const string &Value) {
+	Put<uint32_t>(Value.size());
+	PutData(Value.data(), Value.size());
+}
+
+/* Записать в файл */
+bool vprobot::checkpoint::CWriter::Save(const string &Name) const {
+	string TempName = Name + ".tmp";
+	SCheckpointHeader Header;
+
+	{
+		ofstream File(TempName.c_str(), ios::out | ios::binary | ios::trunc);
+
+		if (!File)
+			return false;
+		memset(&Header, 0, sizeof(Header));
+		memcpy(Header.s_Magic, CheckpointMagic, sizeof(CheckpointMagic));
+		Header.s_Version = CheckpointVersion;
+		Header.s_Size = m_Data.size();
+		File.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+		File.write(m_Data.data(), m_Data.size());
+		if (!File.flush()) {
+			remove(TempName.c_str());
+			return false;
+		}
+	}
+	return rename(TempName.c_str(), Name.c_str()) == 0;
+}
+
+/* CReader */
+
+vprobot::checkpoint::CReader::CReader() :
+		m_File(), m_Pos(NULL), m_End(NULL) {
+}
+
+vprobot::checkpoint::CReader::~CReader() {
+}
+
+/* Открыть файл и проверить заголовок */
+bool vprobot::checkpoint::CReader::Open(const string &Name) {
+	SCheckpointHeader Header;
+
+	if (!m_File.Open(Name))
+		return false;
+	if (m_File.GetSize() < sizeof(Header)) {
+		m_File.Close();
+		return false;
+	}
+	memcpy(&Header, m_File.GetData(), sizeof(Header));
+	if (memcmp(Header.s_Magic, CheckpointMagic, sizeof(CheckpointMagic)) != 0
+			|| Header.s_Version != CheckpointVersion
+			|| Header.s_Size != m_File.GetSize() - sizeof(Header)) {
+		m_File.Close();
+		return false;
+	}
+	m_Pos = m_File.GetData() + sizeof(Header);
+	m_End = m_File.GetData() + m_File.GetSize();
+	return true;
+}
+
+/* Прочитать строку */
+bool vprobot::checkpoint::CReader::GetString(string &Value) {
+	uint32_t Size;
+
+	if (!Get(Size) || static_cast<size_t>(m_End - m_Pos) < Size)
+		return false;
+	Value.assign(m_Pos, Size);
+	m_Pos += Size;
+	return true;
+}
+
+/* Проверить метку компонента */
+bool vprobot::checkpoint::CReader::ExpectTag(const char *Tag) {
+	string Value;
+
+	return GetString(Value) && Value == Tag;
+}
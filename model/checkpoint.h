@@ -0,0 +1,163 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __CHECKPOINT_H_
+#define __CHECKPOINT_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <Eigen/Dense>
+#include "mapped.h"
+
+namespace vprobot {
+
+namespace checkpoint {
+
+/* Запись контрольной точки. Компоненты пишут свое состояние подряд,
+ * начиная с метки (PutTag), по которой при чтении проверяется тип */
+class CWriter {
+private:
+	/* Записанные данные */
+	std::vector<char> m_Data;
+
+	CWriter(const CWriter &Writer) = default;
+public:
+	CWriter();
+	~CWriter();
+
+	/* Записать значение */
+	template<typename T>
+	inline void Put(const T &Value) {
+		PutData(&Value, sizeof(T));
+	}
+	/* Записать массив */
+	inline void PutData(const void *Data, std::size_t Size) {
+		const char *p = static_cast<const char *>(Data);
+
+		m_Data.insert(m_Data.end(), p, p + Size);
+	}
+	/* Записать строку */
+	void PutString(const std::string &Value);
+	/* Записать метку компонента */
+	inline void PutTag(const char *Tag) {
+		PutString(Tag);
+	}
+	/* Записать матрицу или вектор Eigen (размеры и значения) */
+	template<typename T>
+	void PutMatrix(const Eigen::PlainObjectBase<T> &Value) {
+		Put<std::uint64_t>(Value.rows());
+		Put<std::uint64_t>(Value.cols());
+		PutData(Value.data(), Value.size() * sizeof(typename T::Scalar));
+	}
+	/* Записать состояние генератора случайных чисел */
+	template<typename T>
+	void PutEngine(const T &Engine) {
+		std::ostringstream s;
+
+		s << Engine;
+		PutString(s.str());
+	}
+
+	/* Записать в файл (через временный файл, чтобы прерванная запись
+	 * не испортила предыдущую точку) */
+	bool Save(const std::string &Name) const;
+};
+
+/* Чтение контрольной точки с проверкой границ */
+class CReader {
+private:
+	/* Отображенный файл */
+	mapped::CMappedFile m_File;
+	const char *m_Pos;
+	const char *m_End;
+
+	CReader(const CReader &Reader) = default;
+public:
+	CReader();
+	~CReader();
+
+	/* Открыть файл и проверить заголовок */
+	bool Open(const std::string &Name);
+	/* Данные закончились */
+	inline bool End() const {
+		return m_Pos >= m_End;
+	}
+
+	/* Прочитать значение */
+	template<typename T>
+	inline bool Get(T &Value) {
+		return GetData(&Value, sizeof(T));
+	}
+	/* Прочитать массив */
+	inline bool GetData(void *Data, std::size_t Size) {
+		if (static_cast<std::size_t>(m_End - m_Pos) < Size)
+			return false;
+		std::memcpy(Data, m_Pos, Size);
+		m_Pos += Size;
+		return true;
+	}
+	/* Прочитать строку */
+	bool GetString(std::string &Value);
+	/* Проверить метку компонента */
+	bool ExpectTag(const char *Tag);
+	/* Прочитать матрицу или вектор Eigen. Размеры должны совпадать
+	 * с текущими (то есть с параметрами модели), если не задан Resize */
+	template<typename T>
+	bool GetMatrix(Eigen::PlainObjectBase<T> &Value, bool Resize = false) {
+		std::uint64_t Rows, Cols;
+		std::size_t Left;
+
+		if (!Get(Rows) || !Get(Cols))
+			return false;
+		Left = (m_End - m_Pos) / sizeof(typename T::Scalar);
+		if (Resize && (Cols == 0 || Rows <= Left / Cols))
+			Value.resize(Rows, Cols);
+		if (Rows != static_cast<std::uint64_t>(Value.rows())
+				|| Cols != static_cast<std::uint64_t>(Value.cols()))
+			return false;
+		return GetData(Value.data(), Value.size() * sizeof(typename T::Scalar));
+	}
+	/* Прочитать состояние генератора случайных чисел */
+	template<typename T>
+	bool GetEngine(T &Engine) {
+		std::string Value;
+
+		if (!GetString(Value))
+			return false;
+
+		std::istringstream s(Value);
+
+		s >> Engine;
+		return !s.fail();
+	}
+};
+
+}
+
+}
+
+#endif
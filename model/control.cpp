@@ -17,6 +17,7 @@
  */
 
 #include "control.h"
+#include "profiler.h"
 
 #include <string>
 
@@ -28,13 +29,65 @@ using namespace ::vprobot::control;
 
 vprobot::control::CControlSystem::CControlSystem(
 		const Json::Value &ControlSystemObject) :
-		m_LastCommand(NULL) {
+		m_LastCommand(NULL), m_Pipelined(false), m_RestoredCommand() {
 	m_Count = ControlSystemObject["count"].asInt();
 }
 
 vprobot::control::CControlSystem::~CControlSystem() {
 }
 
+/* Включить режим конвейера */
+void vprobot::control::CControlSystem::SetPipelined(bool Pipelined) {
+	m_Pipelined = Pipelined;
+}
+
+/* Учесть команду и измерения в порядке, зависящем от режима */
+void vprobot::control::CControlSystem::Process(
+		const SMeasures * const *Measurements) {
+	vprobot::profiler::CScopedTimer Timer(vprobot::profiler::PhaseIntegration);
+
+	/* В режиме конвейера измерения сделаны до выполнения последней команды */
+	if (m_Pipelined) {
+		if (Measurements != NULL)
+			ProcessMeasurements(Measurements);
+		if (m_LastCommand != NULL)
+			ProcessCommands();
+	} else {
+		if (m_LastCommand != NULL)
+			ProcessCommands();
+		if (Measurements != NULL)
+			ProcessMeasurements(Measurements);
+	}
+}
+
+/* Записать состояние в контрольную точку */
+void vprobot::control::CControlSystem::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	Writer.PutTag("control");
+	Writer.Put<uint8_t>(m_LastCommand != NULL);
+	if (m_LastCommand != NULL)
+		Writer.PutData(m_LastCommand, m_Count * sizeof(ControlCommand));
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::control::CControlSystem::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	uint8_t HasCommand;
+
+	if (!Reader.ExpectTag("control") || !Reader.Get(HasCommand))
+		return false;
+	m_LastCommand = NULL;
+	if (HasCommand == 0)
+		return true;
+	/* Команда копируется, указатели на внутренние массивы не сохраняются */
+	m_RestoredCommand.resize(m_Count);
+	if (!Reader.GetData(m_RestoredCommand.data(),
+			m_Count * sizeof(ControlCommand)))
+		return false;
+	m_LastCommand = m_RestoredCommand.data();
+	return true;
+}
+
 /* CSequentialControlSystem */
 
 vprobot::control::CSequentialControlSystem::CSequentialControlSystem(
@@ -84,3 +137,22 @@ const ControlCommand * const vprobot::control::CSequentialControlSystem::GetComm
 	}
 	return m_LastCommand;
 }
+
+/* Записать состояние в контрольную точку */
+void vprobot::control::CSequentialControlSystem::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	CControlSystem::SaveState(Writer);
+	Writer.Put<uint64_t>(m_Pos - m_Set.begin());
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::control::CSequentialControlSystem::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	uint64_t Pos;
+
+	if (!CControlSystem::LoadState(Reader) || !Reader.Get(Pos)
+			|| Pos > m_Set.size())
+		return false;
+	m_Pos = m_Set.begin() + Pos;
+	return true;
+}
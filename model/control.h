@@ -28,6 +28,7 @@
 #include <json/json.h>
 #include "presentation.h"
 #include "robot.h"
+#include "checkpoint.h"
 
 namespace vprobot {
 
@@ -42,13 +43,36 @@ protected:
 	std::size_t m_Count;
 	/* Последняя команда */
 	const vprobot::robot::ControlCommand *m_LastCommand;
+	/* Режим конвейера (измерения запаздывают на шаг) */
+	bool m_Pipelined;
+	/* Последняя команда, восстановленная из контрольной точки */
+	std::vector<vprobot::robot::ControlCommand> m_RestoredCommand;
+
+	/* Учесть последнюю команду */
+	virtual void ProcessCommands() {
+	}
+	/* Учесть измерения */
+	virtual void ProcessMeasurements(
+			const vprobot::robot::SMeasures * const *Measurements) {
+	}
+	/* Учесть команду и измерения в порядке, зависящем от режима */
+	void Process(const vprobot::robot::SMeasures * const *Measurements);
 public:
 	CControlSystem(const Json::Value &ControlSystemObject);
 	virtual ~CControlSystem();
 
+	/* Включить режим конвейера */
+	void SetPipelined(bool Pipelined);
+
 	/* Получить команду */
 	virtual const vprobot::robot::ControlCommand * const GetCommands(
 			const vprobot::robot::SMeasures * const *Measurements) = 0;
+
+	/* Записать состояние в контрольную точку */
+	virtual void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки
+	 * (false, если точка не подходит к модели) */
+	virtual bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 /* Система управления, выполняющая заданную последовательность */
@@ -68,6 +92,11 @@ public:
 	/* Получить команду */
 	const vprobot::robot::ControlCommand * const GetCommands(
 			const vprobot::robot::SMeasures * const *Measurements);
+
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 }
@@ -0,0 +1,289 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "display-list.h"
+
+#include <string>
+#include <cstdint>
+
+using namespace ::std;
+using namespace ::vprobot::presentation;
+
+namespace {
+
+/* Чтение записанных данных с проверкой границ */
+class CReader {
+private:
+	const unsigned char *m_Pos;
+	const unsigned char *m_End;
+public:
+	CReader(const unsigned char *Data, size_t Size) :
+			m_Pos(Data), m_End(Data + Size) {
+	}
+
+	/* Данные закончились */
+	inline bool End() const {
+		return m_Pos >= m_End;
+	}
+	/* Оставшийся размер данных */
+	inline size_t Left() const {
+		return m_End - m_Pos;
+	}
+	/* Прочитать значение */
+	template<typename T>
+	inline bool Get(T &Value) {
+		if (static_cast<size_t>(m_End - m_Pos) < sizeof(T))
+			return false;
+		memcpy(&Value, m_Pos, sizeof(T));
+		m_Pos += sizeof(T);
+		return true;
+	}
+	/* Получить указатель на массив */
+	inline const unsigned char *GetData(size_t Size) {
+		const unsigned char *p = m_Pos;
+
+		if (static_cast<size_t>(m_End - m_Pos) < Size)
+			return NULL;
+		m_Pos += Size;
+		return p;
+	}
+	/* Прочитать несколько чисел */
+	inline bool GetDoubles(double *Values, size_t Count) {
+		size_t i;
+
+		for (i = 0; i < Count; i++)
+			if (!Get(Values[i]))
+				return false;
+		return true;
+	}
+	/* Прочитать цвет */
+	inline bool GetColor(int *Color) {
+		const unsigned char *c = GetData(4);
+		int i;
+
+		if (c == NULL)
+			return false;
+		for (i = 0; i < 4; i++)
+			Color[i] = c[i];
+		return true;
+	}
+};
+
+}
+
+/* CDisplayList */
+
+vprobot::presentation::CDisplayList::CDisplayList() :
+		CPresentationDriver(), m_Data() {
+}
+
+vprobot::presentation::CDisplayList::~CDisplayList() {
+}
+
+/* Нарисовать точку */
+void vprobot::presentation::CDisplayList::DrawCircle(double x, double y,
+		double r, int R, int G, int B, int A) {
+	Put<unsigned char>(CommandCircle);
+	Put(x);
+	Put(y);
+	Put(r);
+	PutColor(R, G, B, A);
+}
+
+/* Нарисовать угол */
+void vprobot::presentation::CDisplayList::DrawPie(double x, double y, double r,
+		double sa, double fa, int R, int G, int B, int A) {
+	Put<unsigned char>(CommandPie);
+	Put(x);
+	Put(y);
+	Put(r);
+	Put(sa);
+	Put(fa);
+	PutColor(R, G, B, A);
+}
+
+/* Нарисовать эллипс */
+void vprobot::presentation::CDisplayList::DrawEllipse(double x, double y,
+		double a, double b, double angle, int R, int G, int B, int A) {
+	Put<unsigned char>(CommandEllipse);
+	Put(x);
+	Put(y);
+	Put(a);
+	Put(b);
+	Put(angle);
+	PutColor(R, G, B, A);
+}
+
+/* Нарисовать фигуру */
+void vprobot::presentation::CDisplayList::DrawShape(double *x, double *y,
+		int count, int R, int G, int B, int A, int f_R, int f_G, int f_B,
+		int f_A) {
+	Put<unsigned char>(CommandShape);
+	Put<uint32_t>(count);
+	PutData(x, count * sizeof(double));
+	PutData(y, count * sizeof(double));
+	PutColor(R, G, B, A);
+	PutColor(f_R, f_G, f_B, f_A);
+}
+
+/* Нарисовать линию */
+void vprobot::presentation::CDisplayList::DrawLine(double x0, double y0,
+		double xf, double yf, int R, int G, int B, int A) {
+	Put<unsigned char>(CommandLine);
+	Put(x0);
+	Put(y0);
+	Put(xf);
+	Put(yf);
+	PutColor(R, G, B, A);
+}
+
+/* Нарисовать квадрат */
+void vprobot::presentation::CDisplayList::DrawRectangle(double x0, double y0,
+		double xf, double yf, int R, int G, int B, int A) {
+	Put<unsigned char>(CommandRectangle);
+	Put(x0);
+	Put(y0);
+	Put(xf);
+	Put(yf);
+	PutColor(R, G, B, A);
+}
+
+/* Написать текст */
+void vprobot::presentation::CDisplayList::PutText(double x, double y,
+		const char *Text, int R, int G, int B, int A) {
+	uint32_t Length = strlen(Text);
+
+	Put<unsigned char>(CommandText);
+	Put(x);
+	Put(y);
+	Put(Length);
+	PutData(Text, Length);
+	PutColor(R, G, B, A);
+}
+
+/* Нарисовать сетку */
+void vprobot::presentation::CDisplayList::DrawGrid(double x0, double y0,
+		double xf, double yf, size_t Width, size_t Height,
+		const unsigned char *Cells, const unsigned char *Palette) {
+	Put<unsigned char>(CommandGrid);
+	Put(x0);
+	Put(y0);
+	Put(xf);
+	Put(yf);
+	Put<uint32_t>(Width);
+	Put<uint32_t>(Height);
+	PutData(Palette, 256 * 4);
+	PutData(Cells, Width * Height);
+}
+
+/* Вывести записанные команды (false, если данные повреждены) */
+bool vprobot::presentation::CDisplayList::Replay(
+		CPresentationDriver &Driver) const {
+	return Replay(m_Data.data(), m_Data.size(), Driver);
+}
+
+/* Вывести команды из буфера (например, из файла записи) */
+bool vprobot::presentation::CDisplayList::Replay(const unsigned char *Data,
+		size_t Size, CPresentationDriver &Driver) {
+	CReader r(Data, Size);
+	vector<double> x, y;
+	double v[5];
+	int c[4], f[4];
+
+	while (!r.End()) {
+		unsigned char Command;
+
+		if (!r.Get(Command))
+			return false;
+		switch (Command) {
+			case CommandCircle:
+				if (!r.GetDoubles(v, 3) || !r.GetColor(c))
+					return false;
+				Driver.DrawCircle(v[0], v[1], v[2], c[0], c[1], c[2], c[3]);
+				break;
+			case CommandPie:
+				if (!r.GetDoubles(v, 5) || !r.GetColor(c))
+					return false;
+				Driver.DrawPie(v[0], v[1], v[2], v[3], v[4], c[0], c[1], c[2],
+						c[3]);
+				break;
+			case CommandEllipse:
+				if (!r.GetDoubles(v, 5) || !r.GetColor(c))
+					return false;
+				Driver.DrawEllipse(v[0], v[1], v[2], v[3], v[4], c[0], c[1],
+						c[2], c[3]);
+				break;
+			case CommandShape: {
+				uint32_t Count;
+
+				/* Размер проверяется до выделения памяти под координаты */
+				if (!r.Get(Count) || Count > r.Left() / (2 * sizeof(double)))
+					return false;
+				x.resize(Count);
+				y.resize(Count);
+				if (!r.GetDoubles(x.data(), Count)
+						|| !r.GetDoubles(y.data(), Count) || !r.GetColor(c)
+						|| !r.GetColor(f))
+					return false;
+				Driver.DrawShape(x.data(), y.data(), Count, c[0], c[1], c[2],
+						c[3], f[0], f[1], f[2], f[3]);
+				break;
+			}
+			case CommandLine:
+				if (!r.GetDoubles(v, 4) || !r.GetColor(c))
+					return false;
+				Driver.DrawLine(v[0], v[1], v[2], v[3], c[0], c[1], c[2], c[3]);
+				break;
+			case CommandRectangle:
+				if (!r.GetDoubles(v, 4) || !r.GetColor(c))
+					return false;
+				Driver.DrawRectangle(v[0], v[1], v[2], v[3], c[0], c[1], c[2],
+						c[3]);
+				break;
+			case CommandText: {
+				uint32_t Length;
+				const unsigned char *Text;
+
+				if (!r.GetDoubles(v, 2) || !r.Get(Length)
+						|| (Text = r.GetData(Length)) == NULL || !r.GetColor(c))
+					return false;
+
+				string s(reinterpret_cast<const char *>(Text), Length);
+
+				Driver.PutText(v[0], v[1], s.c_str(), c[0], c[1], c[2], c[3]);
+				break;
+			}
+			case CommandGrid: {
+				uint32_t Width, Height;
+				const unsigned char *Palette, *Cells;
+
+				if (!r.GetDoubles(v, 4) || !r.Get(Width) || !r.Get(Height)
+						|| (Palette = r.GetData(256 * 4)) == NULL
+						|| (Cells = r.GetData(
+								static_cast<size_t>(Width) * Height)) == NULL)
+					return false;
+				Driver.DrawGrid(v[0], v[1], v[2], v[3], Width, Height, Cells,
+						Palette);
+				break;
+			}
+			default:
+				return false;
+		}
+	}
+	return true;
+}
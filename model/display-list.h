@@ -0,0 +1,125 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DISPLAY_LIST_H_
+#define __DISPLAY_LIST_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "presentation.h"
+
+namespace vprobot {
+
+namespace presentation {
+
+/* Драйвер, записывающий команды рисования для последующего вывода */
+class CDisplayList: public CPresentationDriver {
+public:
+	/* Команды */
+	enum CommandType {
+		CommandCircle = 1,
+		CommandPie,
+		CommandEllipse,
+		CommandShape,
+		CommandLine,
+		CommandRectangle,
+		CommandText,
+		CommandGrid
+	};
+private:
+	/* Записанные команды (тип и аргументы подряд) */
+	std::vector<unsigned char> m_Data;
+
+	/* Записать значение */
+	template<typename T>
+	inline void Put(const T &Value) {
+		std::size_t Size = m_Data.size();
+
+		m_Data.resize(Size + sizeof(T));
+		std::memcpy(&m_Data[Size], &Value, sizeof(T));
+	}
+	/* Записать массив */
+	inline void PutData(const void *Data, std::size_t Size) {
+		const unsigned char *p = static_cast<const unsigned char *>(Data);
+
+		m_Data.insert(m_Data.end(), p, p + Size);
+	}
+	/* Записать цвет */
+	inline void PutColor(int R, int G, int B, int A) {
+		Put<unsigned char>(R);
+		Put<unsigned char>(G);
+		Put<unsigned char>(B);
+		Put<unsigned char>(A);
+	}
+public:
+	CDisplayList();
+	~CDisplayList();
+
+	/* Нарисовать точку */
+	void DrawCircle(double x, double y, double r, int R, int G, int B, int A);
+	/* Нарисовать угол */
+	void DrawPie(double x, double y, double r, double sa, double fa, int R,
+			int G, int B, int A);
+	/* Нарисовать эллипс */
+	void DrawEllipse(double x, double y, double a, double b, double angle,
+			int R, int G, int B, int A);
+	/* Нарисовать фигуру */
+	void DrawShape(double *x, double *y, int count, int R, int G, int B, int A,
+			int f_R, int f_G, int f_B, int f_A);
+	/* Нарисовать линию */
+	void DrawLine(double x0, double y0, double xf, double yf, int R, int G,
+			int B, int A);
+	/* Нарисовать квадрат */
+	void DrawRectangle(double x0, double y0, double xf, double yf, int R, int G,
+			int B, int A);
+	/* Написать текст */
+	void PutText(double x, double y, const char *Text, int R, int G, int B,
+			int A);
+	/* Нарисовать сетку */
+	void DrawGrid(double x0, double y0, double xf, double yf,
+			std::size_t Width, std::size_t Height, const unsigned char *Cells,
+			const unsigned char *Palette);
+
+	/* Очистить список (память сохраняется) */
+	inline void Clear() {
+		m_Data.clear();
+	}
+	/* Записанные данные */
+	inline const std::vector<unsigned char> &GetData() const {
+		return m_Data;
+	}
+	inline std::vector<unsigned char> &GetData() {
+		return m_Data;
+	}
+	/* Вывести записанные команды (false, если данные повреждены) */
+	bool Replay(CPresentationDriver &Driver) const;
+	/* Вывести команды из буфера (например, из файла записи) */
+	static bool Replay(const unsigned char *Data, std::size_t Size,
+			CPresentationDriver &Driver);
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,239 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "field.h"
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include "../types.h"
+
+using namespace ::std;
+using namespace ::Eigen;
+using namespace ::vprobot;
+using namespace ::vprobot::line;
+using namespace ::vprobot::map;
+
+namespace {
+
+const char FieldMagic[8] = {'V', 'P', 'R', 'D', 'F', 'L', 'D', '1'};
+
+/* Хэш FNV-1a для проверки кэша */
+void HashBytes(uint64_t &Hash, const void *Data, size_t Size) {
+	const unsigned char *p = static_cast<const unsigned char *>(Data);
+	size_t i;
+
+	for (i = 0; i < Size; i++) {
+		Hash ^= p[i];
+		Hash *= 1099511628211ULL;
+	}
+}
+
+/* Значение для свободных клеток (бесконечность ломает пересечения парабол) */
+const double FreeCell = 1e20;
+
+/* Одномерное преобразование расстояний (Felzenszwalb, Huttenlocher):
+ * d[q] = min_p ((q - p)^2 + f[p]), v и z - рабочие массивы */
+void DistanceTransform(const double *f, double *d, size_t n, size_t *v, double *z) {
+	size_t k = 0, q;
+
+	v[0] = 0;
+	z[0] = -HUGE_VAL;
+	z[1] = HUGE_VAL;
+	for (q = 1; q < n; q++) {
+		double s;
+
+		for (;;) {
+			double p = v[k];
+
+			s = ((f[q] + 1.0 * q * q) - (f[v[k]] + p * p)) / (2.0 * q - 2.0 * p);
+			/* z[0] = -inf, поэтому цикл останавливается не позже k = 0 */
+			if (s > z[k])
+				break;
+			k--;
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = HUGE_VAL;
+	}
+	k = 0;
+	for (q = 0; q < n; q++) {
+		while (z[k + 1] < q)
+			k++;
+
+		double p = v[k];
+
+		d[q] = (q - p) * (q - p) + f[v[k]];
+	}
+}
+
+}
+
+/* CDistanceField */
+
+vprobot::map::CDistanceField::CDistanceField(const CMap &Map,
+		const Json::Value &FieldObject) :
+		m_StartX(0), m_StartY(0), m_Width(0), m_Height(0), m_Data(NULL), m_Storage(),
+		m_File() {
+	m_Resolution = FieldObject.get("resolution", 0.1).asDouble();
+	if (!GreaterThanZero(m_Resolution)) {
+		clog << "Distance field resolution must be positive, using 0.1"
+				<< endl;
+		m_Resolution = 0.1;
+	}
+	m_InvResolution = 1 / m_Resolution;
+
+	double Margin = std::max(FieldObject.get("margin", 1.0).asDouble(), 0.0);
+	string Cache = FieldObject["cache"].asString();
+	uint64_t Hash = 14695981039346656037ULL;
+
+	/* Кэш действителен только для той же карты и тех же параметров */
+	HashBytes(Hash, &m_Resolution, sizeof(m_Resolution));
+	HashBytes(Hash, &Margin, sizeof(Margin));
+	Map.EnumerateObstacles([&](const Point &a, const Point &b) {
+		HashBytes(Hash, a.data(), 2 * sizeof(double));
+		HashBytes(Hash, b.data(), 2 * sizeof(double));
+	});
+
+	if (!Cache.empty() && Load(Cache, Hash))
+		return;
+	Build(Map, Margin);
+	if (!Cache.empty())
+		Save(Cache, Hash);
+}
+
+vprobot::map::CDistanceField::~CDistanceField() {
+}
+
+/* Построить сетку по карте */
+void vprobot::map::CDistanceField::Build(const CMap &Map, double Margin) {
+	double MinX = HUGE_VAL, MinY = HUGE_VAL, MaxX = -HUGE_VAL, MaxY = -HUGE_VAL;
+
+	Map.EnumerateObstacles([&](const Point &a, const Point &b) {
+		MinX = std::min(MinX, std::min(a[0], b[0]));
+		MinY = std::min(MinY, std::min(a[1], b[1]));
+		MaxX = std::max(MaxX, std::max(a[0], b[0]));
+		MaxY = std::max(MaxY, std::max(a[1], b[1]));
+	});
+	if (MinX > MaxX)
+		return;
+	m_StartX = MinX - Margin;
+	m_StartY = MinY - Margin;
+	m_Width = static_cast<size_t>(ceil(
+			(MaxX - MinX + 2 * Margin) * m_InvResolution)) + 1;
+	m_Height = static_cast<size_t>(ceil(
+			(MaxY - MinY + 2 * Margin) * m_InvResolution)) + 1;
+
+	/* Отмечаем клетки, через которые проходят препятствия */
+	vector<double> Grid(m_Width * m_Height, FreeCell);
+
+	Map.EnumerateObstacles([&](const Point &a, const Point &b) {
+		size_t n = static_cast<size_t>(ceil((b - a).norm() * 2 * m_InvResolution))
+				+ 1, i;
+
+		for (i = 0; i <= n; i++) {
+			Point p = a + (b - a) * (static_cast<double>(i) / n);
+			size_t cx = static_cast<size_t>((p[0] - m_StartX) * m_InvResolution);
+			size_t cy = static_cast<size_t>((p[1] - m_StartY) * m_InvResolution);
+
+			Grid[cy * m_Width + cx] = 0;
+		}
+	});
+
+	/* Квадраты расстояний сначала по столбцам, затем по строкам */
+	size_t n = std::max(m_Width, m_Height), i, j;
+	vector<double> f(n), d(n), z(n + 1);
+	vector<size_t> v(n);
+
+	for (i = 0; i < m_Width; i++) {
+		for (j = 0; j < m_Height; j++)
+			f[j] = Grid[j * m_Width + i];
+		DistanceTransform(f.data(), d.data(), m_Height, v.data(), z.data());
+		for (j = 0; j < m_Height; j++)
+			Grid[j * m_Width + i] = d[j];
+	}
+	m_Storage.resize(m_Width * m_Height);
+	for (j = 0; j < m_Height; j++) {
+		DistanceTransform(&Grid[j * m_Width], d.data(), m_Width, v.data(), z.data());
+		for (i = 0; i < m_Width; i++)
+			m_Storage[j * m_Width + i] = sqrt(d[i]) * m_Resolution;
+	}
+	m_Data = m_Storage.data();
+}
+
+/* Загрузить сетку из кэша */
+bool vprobot::map::CDistanceField::Load(const string &Name, uint64_t Hash) {
+	SFieldHeader Header;
+
+	if (!m_File.Open(Name))
+		return false;
+	if (m_File.GetSize() < sizeof(Header)) {
+		m_File.Close();
+		return false;
+	}
+	memcpy(&Header, m_File.GetData(), sizeof(Header));
+	if (memcmp(Header.s_Magic, FieldMagic, sizeof(FieldMagic)) != 0
+			|| Header.s_Hash != Hash || Header.s_Resolution != m_Resolution
+			|| m_File.GetSize()
+					!= sizeof(Header)
+							+ Header.s_Width * Header.s_Height * sizeof(float)) {
+		m_File.Close();
+		return false;
+	}
+	m_Width = Header.s_Width;
+	m_Height = Header.s_Height;
+	m_StartX = Header.s_StartX;
+	m_StartY = Header.s_StartY;
+	/* Данные используются прямо из отображенного файла */
+	m_Data = reinterpret_cast<const float *>(m_File.GetData() + sizeof(Header));
+	return true;
+}
+
+/* Сохранить сетку в кэш */
+void vprobot::map::CDistanceField::Save(const string &Name,
+		uint64_t Hash) const {
+	SFieldHeader Header;
+	ofstream File(Name.c_str(), ios::out | ios::binary | ios::trunc);
+
+	if (!File)
+		return;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.s_Magic, FieldMagic, sizeof(FieldMagic));
+	Header.s_Hash = Hash;
+	Header.s_Width = m_Width;
+	Header.s_Height = m_Height;
+	Header.s_StartX = m_StartX;
+	Header.s_StartY = m_StartY;
+	Header.s_Resolution = m_Resolution;
+	File.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char *>(m_Storage.data()),
+			m_Storage.size() * sizeof(float));
+}
+
+/* Расстояния для массива точек */
+void vprobot::map::CDistanceField::GetDistances(const ArrayXd &x,
+		const ArrayXd &y, ArrayXd &d) const {
+	Index i;
+
+	d.resize(x.size());
+	for (i = 0; i < x.size(); i++) {
+		d[i] = GetDistance(x[i], y[i]);
+	}
+}
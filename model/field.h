@@ -0,0 +1,125 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FIELD_H_
+#define __FIELD_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include <json/json.h>
+#include "line.h"
+#include "map.h"
+#include "mapped.h"
+
+namespace vprobot {
+
+namespace map {
+
+/* Сетка расстояний до ближайшего препятствия карты */
+class CDistanceField {
+private:
+	/* Заголовок файла кэша */
+	struct SFieldHeader {
+		char s_Magic[8];
+		std::uint64_t s_Hash;
+		std::uint64_t s_Width;
+		std::uint64_t s_Height;
+		double s_StartX;
+		double s_StartY;
+		double s_Resolution;
+	};
+
+	/* Левый нижний угол сетки */
+	double m_StartX;
+	double m_StartY;
+	/* Размер клетки */
+	double m_Resolution;
+	double m_InvResolution;
+	/* Размеры сетки */
+	std::size_t m_Width;
+	std::size_t m_Height;
+	/* Расстояния по строкам (m_Data указывает в m_Storage или в m_File) */
+	const float *m_Data;
+	std::vector<float> m_Storage;
+	mapped::CMappedFile m_File;
+
+	/* Построить сетку по карте */
+	void Build(const CMap &Map, double Margin);
+	/* Загрузить сетку из кэша */
+	bool Load(const std::string &Name, std::uint64_t Hash);
+	/* Сохранить сетку в кэш */
+	void Save(const std::string &Name, std::uint64_t Hash) const;
+
+	CDistanceField(const CDistanceField &Field) = default;
+public:
+	CDistanceField(const CMap &Map, const Json::Value &FieldObject);
+	~CDistanceField();
+
+	/* Расстояние от точки до ближайшего препятствия */
+	inline double GetDistance(double x, double y) const {
+		if (m_Data == NULL)
+			return HUGE_VAL;
+
+		double fx = (x - m_StartX) * m_InvResolution, fy = (y - m_StartY)
+				* m_InvResolution;
+		double cx = std::floor(fx), cy = std::floor(fy), Out = 0;
+
+		/* За пределами сетки добавляем расстояние до крайней клетки */
+		if (cx < 0 || cy < 0 || cx >= m_Width || cy >= m_Height) {
+			double ox = std::min(std::max(cx, 0.0), m_Width - 1.0);
+			double oy = std::min(std::max(cy, 0.0), m_Height - 1.0);
+
+			Out = std::hypot(fx - ox - 0.5, fy - oy - 0.5) * m_Resolution;
+			cx = ox;
+			cy = oy;
+		}
+		return m_Data[static_cast<std::size_t>(cy) * m_Width
+				+ static_cast<std::size_t>(cx)] + Out;
+	}
+	inline double GetDistance(const line::Point &p) const {
+		return GetDistance(p[0], p[1]);
+	}
+	/* Расстояния для массива точек */
+	void GetDistances(const Eigen::ArrayXd &x, const Eigen::ArrayXd &y,
+			Eigen::ArrayXd &d) const;
+
+	/* Размеры сетки */
+	inline std::size_t GetWidth() const {
+		return m_Width;
+	}
+	inline std::size_t GetHeight() const {
+		return m_Height;
+	}
+	inline double GetResolution() const {
+		return m_Resolution;
+	}
+};
+
+}
+
+}
+
+#endif
@@ -57,11 +57,17 @@ double vprobot::line::Measure(const Point &x1, const Point &x2, double angle) {
 
 /* Функция для замера расстояния от точки до линии по направлению */
 double vprobot::line::Measure(const Line &x, const Point &p, double angle) {
+	return Measure(x.data(), x.size(), p, angle);
+}
+
+/* То же для линии из Count точек, лежащих подряд */
+double vprobot::line::Measure(const Point *x, size_t Count, const Point &p,
+		double angle) {
 	double d = 0;
 
-	if (x.size() > 1) {
-		Line::const_iterator x1 = x.begin();
-		Line::const_iterator x2 = x1 + 1;
+	if (Count > 1) {
+		const Point *x1 = x, *End = x + Count;
+		const Point *x2 = x1 + 1;
 
 		for (;;) {
 			double cd = Measure(*x1 - p, *x2 - p, angle);
@@ -70,12 +76,12 @@ double vprobot::line::Measure(const Line &x, const Point &p, double angle) {
 				d = cd;
 			}
 			x1++;
-			if (x1 == x.end()) {
+			if (x1 == End) {
 				break;
 			}
 			x2++;
-			if (x2 == x.end()) {
-				x2 = x.begin();
+			if (x2 == End) {
+				x2 = x;
 			}
 		}
 	}
@@ -23,6 +23,7 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
 #include <vector>
 #include <Eigen/Dense>
 #include <Eigen/StdVector>
@@ -42,6 +43,8 @@ Point Rotate(const Point &r, double angle);
 double Measure(const Point &x1, const Point &x2, double angle);
 /* Функция для замера расстояния от точки до линии по направлению */
 double Measure(const Line &x, const Point &p, double angle);
+/* То же для линии из Count точек, лежащих подряд */
+double Measure(const Point *x, std::size_t Count, const Point &p, double angle);
 
 }
 
@@ -0,0 +1,372 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "loader.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <iostream>
+
+using namespace ::std;
+using namespace ::vprobot;
+using namespace ::vprobot::line;
+using namespace ::vprobot::map;
+
+namespace {
+
+/* Положение объекта в документе: нужны только scene.map.points и
+ * scene.map.lines, все остальное пропускается */
+enum Target {
+	TargetRoot,
+	TargetScene,
+	TargetMap,
+	TargetOther
+};
+
+/* Потоковый разбор модели */
+class CModelParser {
+private:
+	/* Документ */
+	const char *m_Pos;
+	const char *m_End;
+	/* Начало еще не скопированной в m_Rest части документа */
+	const char *m_Copied;
+	/* Документ без массивов геометрии */
+	string m_Rest;
+	/* Прочитанная геометрия */
+	SMapGeometry &m_Geometry;
+
+	/* Пропустить пробелы и комментарии */
+	void SkipSpace() {
+		while (m_Pos < m_End) {
+			if (*m_Pos == ' ' || *m_Pos == '\t' || *m_Pos == '\n'
+					|| *m_Pos == '\r')
+				m_Pos++;
+			else if (*m_Pos == '/' && m_End - m_Pos > 1 && m_Pos[1] == '/') {
+				while (m_Pos < m_End && *m_Pos != '\n')
+					m_Pos++;
+			} else if (*m_Pos == '/' && m_End - m_Pos > 1 && m_Pos[1] == '*') {
+				const char *p = m_Pos + 2;
+
+				while (p < m_End - 1 && !(p[0] == '*' && p[1] == '/'))
+					p++;
+				m_Pos = p < m_End - 1 ? p + 2 : m_End;
+			} else
+				break;
+		}
+	}
+	/* Проверить и пропустить символ */
+	bool Expect(char c) {
+		SkipSpace();
+		if (m_Pos >= m_End || *m_Pos != c)
+			return false;
+		m_Pos++;
+		return true;
+	}
+	/* Пропустить строку (m_Pos указывает на открывающую кавычку) */
+	bool SkipString() {
+		for (m_Pos++; m_Pos < m_End; m_Pos++) {
+			if (*m_Pos == '\\')
+				m_Pos++;
+			else if (*m_Pos == '"') {
+				m_Pos++;
+				return true;
+			}
+		}
+		return false;
+	}
+	/* Прочитать ключ (экранированные символы не раскрываются) */
+	bool ReadKey(const char *&Key, size_t &Length) {
+		SkipSpace();
+		if (m_Pos >= m_End || *m_Pos != '"')
+			return false;
+		Key = m_Pos + 1;
+		if (!SkipString())
+			return false;
+		Length = m_Pos - 1 - Key;
+		return Expect(':');
+	}
+	/* Пропустить значение. Структура проверяется только грубо:
+	 * весь остальной документ затем все равно разбирает jsoncpp */
+	bool SkipValue() {
+		size_t Depth = 0;
+
+		do {
+			SkipSpace();
+			if (m_Pos >= m_End)
+				return false;
+			switch (*m_Pos) {
+				case '"':
+					if (!SkipString())
+						return false;
+					break;
+				case '{':
+				case '[':
+					Depth++;
+					m_Pos++;
+					break;
+				case '}':
+				case ']':
+					if (Depth == 0)
+						return false;
+					Depth--;
+					m_Pos++;
+					break;
+				case ',':
+				case ':':
+					if (Depth == 0)
+						return false;
+					m_Pos++;
+					break;
+				default: {
+					const char *Start = m_Pos;
+
+					while (m_Pos < m_End && strchr("+-.0123456789eEalnrstuf", *m_Pos)
+							!= NULL)
+						m_Pos++;
+					if (m_Pos == Start)
+						return false;
+					break;
+				}
+			}
+		} while (Depth > 0);
+		return true;
+	}
+	/* Посчитать объекты массива (m_Pos указывает на '[') на глубине 1 и 2,
+	 * чтобы сразу выделить память под всю геометрию */
+	void CountItems(size_t &Level1, size_t &Level2) {
+		const char *Start = m_Pos;
+		size_t Depth = 0;
+
+		Level1 = Level2 = 0;
+		while (m_Pos < m_End) {
+			if (*m_Pos == '"') {
+				if (!SkipString())
+					break;
+				continue;
+			}
+			if (*m_Pos == '{' || *m_Pos == '[') {
+				Depth++;
+				if (Depth == 2)
+					Level1++;
+				else if (Depth == 3)
+					Level2++;
+			} else if (*m_Pos == '}' || *m_Pos == ']') {
+				if (--Depth == 0)
+					break;
+			}
+			m_Pos++;
+		}
+		m_Pos = Start;
+	}
+	/* Прочитать число */
+	bool ReadNumber(double &Value) {
+		char Buffer[64];
+		size_t Length = 0;
+		char *NumberEnd;
+
+		SkipSpace();
+		while (m_Pos < m_End && Length < sizeof(Buffer) - 1
+				&& strchr("+-.0123456789eE", *m_Pos) != NULL)
+			Buffer[Length++] = *m_Pos++;
+		if (Length == 0)
+			return false;
+		Buffer[Length] = 0;
+		Value = strtod(Buffer, &NumberEnd);
+		return NumberEnd == Buffer + Length;
+	}
+	/* Прочитать точку {"x": ..., "y": ...} */
+	bool ParsePoint(Line &Points) {
+		double x = 0, y = 0;
+		const char *Key;
+		size_t Length;
+
+		if (!Expect('{'))
+			return false;
+		SkipSpace();
+		if (m_Pos < m_End && *m_Pos == '}') {
+			m_Pos++;
+			Points.emplace_back(x, y);
+			return true;
+		}
+		do {
+			if (!ReadKey(Key, Length))
+				return false;
+			if (Length == 1 && *Key == 'x') {
+				if (!ReadNumber(x))
+					return false;
+			} else if (Length == 1 && *Key == 'y') {
+				if (!ReadNumber(y))
+					return false;
+			} else if (!SkipValue())
+				return false;
+		} while (Expect(','));
+		if (!Expect('}'))
+			return false;
+		Points.emplace_back(x, y);
+		return true;
+	}
+	/* Прочитать массив точек */
+	bool ParsePoints(Line &Points) {
+		if (!Expect('['))
+			return false;
+		SkipSpace();
+		if (m_Pos < m_End && *m_Pos == ']') {
+			m_Pos++;
+			return true;
+		}
+		do {
+			if (!ParsePoint(Points))
+				return false;
+		} while (Expect(','));
+		return Expect(']');
+	}
+	/* Прочитать массив линий */
+	bool ParseLines() {
+		Line &Points = m_Geometry.s_LinePoints;
+		vector<uint64_t> &Offsets = m_Geometry.s_Offsets;
+
+		if (!Expect('['))
+			return false;
+		SkipSpace();
+		if (m_Pos < m_End && *m_Pos == ']') {
+			m_Pos++;
+			return true;
+		}
+		do {
+			if (!ParsePoints(Points))
+				return false;
+			Offsets.push_back(Points.size());
+		} while (Expect(','));
+		return Expect(']');
+	}
+	/* Заменить прочитанный массив геометрии, начатый в Start, на [] */
+	void Cut(const char *Start) {
+		m_Rest.append(m_Copied, Start);
+		m_Rest += "[]";
+		m_Copied = m_Pos;
+	}
+	/* Разобрать значение с ключом Key в объекте Parent */
+	bool ParseMember(Target Parent, const char *Key, size_t Length) {
+		size_t Level1, Level2;
+
+		SkipSpace();
+
+		const char *Start = m_Pos;
+		bool IsArray = m_Pos < m_End && *m_Pos == '[';
+
+		if (Parent == TargetMap && IsArray && Length == 6
+				&& memcmp(Key, "points", 6) == 0) {
+			CountItems(Level1, Level2);
+			m_Geometry.s_Points.clear();
+			m_Geometry.s_Points.reserve(Level1);
+			if (!ParsePoints(m_Geometry.s_Points))
+				return false;
+			m_Geometry.s_HasPoints = true;
+			Cut(Start);
+			return true;
+		}
+		if (Parent == TargetMap && IsArray && Length == 5
+				&& memcmp(Key, "lines", 5) == 0) {
+			CountItems(Level1, Level2);
+			m_Geometry.s_LinePoints.clear();
+			m_Geometry.s_LinePoints.reserve(Level2);
+			m_Geometry.s_Offsets.clear();
+			m_Geometry.s_Offsets.reserve(Level1 + 1);
+			m_Geometry.s_Offsets.push_back(0);
+			if (!ParseLines())
+				return false;
+			m_Geometry.s_HasLines = true;
+			Cut(Start);
+			return true;
+		}
+		if (Parent == TargetRoot && Length == 5 && memcmp(Key, "scene", 5) == 0)
+			return ParseValue(TargetScene);
+		if (Parent == TargetScene && Length == 3 && memcmp(Key, "map", 3) == 0)
+			return ParseValue(TargetMap);
+		return SkipValue();
+	}
+	/* Разобрать значение */
+	bool ParseValue(Target Kind) {
+		const char *Key;
+		size_t Length;
+
+		SkipSpace();
+		if (Kind == TargetOther || m_Pos >= m_End || *m_Pos != '{')
+			return SkipValue();
+		m_Pos++;
+		SkipSpace();
+		if (m_Pos < m_End && *m_Pos == '}') {
+			m_Pos++;
+			return true;
+		}
+		do {
+			if (!ReadKey(Key, Length) || !ParseMember(Kind, Key, Length))
+				return false;
+		} while (Expect(','));
+		return Expect('}');
+	}
+public:
+	CModelParser(const char *Begin, const char *End, SMapGeometry &Geometry) :
+			m_Pos(Begin), m_End(End), m_Copied(Begin), m_Rest(), m_Geometry(
+					Geometry) {
+	}
+
+	/* Прочитать геометрию, в Rest - оставшийся документ */
+	bool Parse(const char *&RestBegin, const char *&RestEnd) {
+		if (!ParseValue(TargetRoot))
+			return false;
+		/* Ничего не вырезано - разбираем документ на месте */
+		if (m_Rest.empty()) {
+			RestBegin = m_Copied;
+			RestEnd = m_End;
+			return true;
+		}
+		m_Rest.append(m_Copied, m_End);
+		RestBegin = m_Rest.data();
+		RestEnd = m_Rest.data() + m_Rest.size();
+		return true;
+	}
+};
+
+}
+
+/* Разобрать файл модели */
+bool vprobot::loader::ParseModel(const char *Begin, const char *End,
+		Json::Value &Root, SMapGeometry &Geometry) {
+	CModelParser Parser(Begin, End, Geometry);
+	const char *RestBegin, *RestEnd;
+	Json::Reader Reader;
+
+	if (!Parser.Parse(RestBegin, RestEnd)) {
+		/* Ошибку покажет jsoncpp, геометрия берется из дерева */
+		Geometry = SMapGeometry();
+		RestBegin = Begin;
+		RestEnd = End;
+	}
+	if (Reader.parse(RestBegin, RestEnd, Root))
+		return true;
+	/* Номера строк в сообщении должны соответствовать исходному файлу */
+	if (RestBegin != Begin)
+		Reader.parse(Begin, End, Root);
+	clog << Reader.getFormattedErrorMessages();
+	return false;
+}
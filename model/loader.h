@@ -0,0 +1,45 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __LOADER_H_
+#define __LOADER_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <json/json.h>
+#include "map.h"
+
+namespace vprobot {
+
+namespace loader {
+
+/* Разобрать файл модели. Массивы scene.map.points и scene.map.lines читаются
+ * потоково прямо в Geometry, без дерева Json::Value, остальной документ
+ * (с пустыми массивами на их месте) разбирается jsoncpp в Root.
+ * Если потоковый разбор не удался, весь документ разбирается jsoncpp */
+bool ParseModel(const char *Begin, const char *End, Json::Value &Root,
+		vprobot::map::SMapGeometry &Geometry);
+
+}
+
+}
+
+#endif
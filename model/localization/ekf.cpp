@@ -36,9 +36,9 @@ using namespace ::vprobot::control::localization;
 vprobot::control::localization::CEKFLocalization::CEKFLocalization(
 		const Json::Value &ControlSystemObject) :
 		CSequentialControlSystem(ControlSystemObject), m_States() {
-	m_Radius = 1 / ControlSystemObject["radius"].asDouble();
 	m_DRadius = ControlSystemObject["dradius"].asDouble() / 3;
-	m_Len = ControlSystemObject["len"].asDouble();
+	m_Motion.SetParameters(ControlSystemObject["len"].asDouble(),
+			1 / ControlSystemObject["radius"].asDouble());
 	m_DLen = ControlSystemObject["dlen"].asDouble() / 3;
 	m_DDist = ControlSystemObject["ddist"].asDouble() / 3;
 
@@ -97,100 +97,82 @@ void vprobot::control::localization::CEKFLocalization::DrawPresentation(
 	}
 }
 
-/* Обработка */
-void vprobot::control::localization::CEKFLocalization::Process(
-		const SMeasures * const *Measurements) {
+/* Учесть последнюю команду */
+void vprobot::control::localization::CEKFLocalization::ProcessCommands() {
 	size_t i;
 
-	if (m_LastCommand != NULL) {
-		for (i = 0; i < m_Count; i++) {
-			if (m_LastCommand[i] == Nothing)
-				continue;
-
-			Vector2d u;
-			Matrix2d CovControl;
-			Matrix3d G;
-			Matrix<double, 3, 2> V;
-
-			switch (m_LastCommand[i]) {
-				case Forward:
-					u << m_Len, 0;
-					break;
-				case ForwardLeft:
-					u << m_Len, m_Radius;
-					break;
-				case ForwardRight:
-					u << m_Len, -m_Radius;
-					break;
-				case Backward:
-					u << -m_Len, 0;
-					break;
-				case BackwardLeft:
-					u << -m_Len, m_Radius;
-					break;
-				case BackwardRight:
-					u << -m_Len, -m_Radius;
-					break;
-				default:
-					break;
-			}
-			double nangle = m_States[i].s_MeanState[2];
-			double dx, dy;
-
-			if (EqualsZero(u[1])) {
-				dx = u[0] * cos(nangle);
-				dy = u[0] * sin(nangle);
-				V << cos(nangle), -u[0] * dy / 2, sin(nangle), u[0] * dx / 2, 0, u[0];
-			} else {
-				nangle = CorrectAngle(nangle + u[0] * u[1]);
-				dx = (sin(nangle) - sin(m_States[i].s_MeanState[2])) / u[1];
-				dy = (cos(m_States[i].s_MeanState[2]) - cos(nangle)) / u[1];
-				V << cos(nangle), (u[0] * cos(nangle) - dx) / u[1], sin(nangle), (u[0]
-						* sin(nangle) - dy) / u[1], u[1], u[0];
-			}
-			G << 1, 0, -dy, 0, 1, dx, 0, 0, 1;
-			CovControl << m_DLen * m_DLen, 0, 0, m_DRadius * m_DRadius;
-
-			Matrix3d OldCov = m_States[i].s_CovState;
-			Vector3d OldMean = m_States[i].s_MeanState;
-
-			m_States[i].s_CovState = G * OldCov * G.transpose()
-					+ V * CovControl * V.transpose();
-			m_States[i].s_MeanState << OldMean[0] + dx, OldMean[1] + dy, nangle;
+	for (i = 0; i < m_Count; i++) {
+		if (m_LastCommand[i] == Nothing)
+			continue;
+
+		Matrix2d CovControl;
+		Matrix3d G;
+		Matrix<double, 3, 2> V;
+		const CMotionModel::SMotion &Motion = m_Motion.GetMotion(
+				m_LastCommand[i]);
+		double Len = m_Motion.GetLen(m_LastCommand[i]);
+		double Curv = m_Motion.GetCurvature(m_LastCommand[i]);
+		double nangle = CorrectAngle(m_States[i].s_MeanState[2] + Motion.s_Angle);
+		double dx, dy;
+
+		CMotionModel::Displacement(Motion, m_States[i].s_MeanState[2], dx, dy);
+		if (EqualsZero(Curv)) {
+			V << cos(nangle), -Len * dy / 2, sin(nangle), Len * dx / 2, 0, Len;
+		} else {
+			V << cos(nangle), (Len * cos(nangle) - dx) / Curv, sin(nangle), (Len
+					* sin(nangle) - dy) / Curv, Curv, Len;
 		}
+		G << 1, 0, -dy, 0, 1, dx, 0, 0, 1;
+		CovControl << m_DLen * m_DLen, 0, 0, m_DRadius * m_DRadius;
+
+		Matrix3d OldCov = m_States[i].s_CovState;
+		Vector3d OldMean = m_States[i].s_MeanState;
+
+		m_States[i].s_CovState = G * OldCov * G.transpose()
+				+ V * CovControl * V.transpose();
+		m_States[i].s_MeanState << OldMean[0] + dx, OldMean[1] + dy, nangle;
 	}
-	if (Measurements != NULL) {
-		for (i = 0; i < m_Count; i++) {
-			const SMeasuresPointsPosition *i_Measurement =
-					dynamic_cast<const SMeasuresPointsPosition *>(Measurements[i]);
-
-			if (i_Measurement == NULL)
-				continue;
-
-			MatrixXd H(i_Measurement->Value.rows(), 3);
-			MatrixXd K(3, i_Measurement->Value.rows());
-			VectorXd h(i_Measurement->Value.rows());
-			Matrix3d OldCov = m_States[i].s_CovState;
-			int j;
-
-			for (j = 0; j < i_Measurement->Value.rows(); j++) {
-				H.row(j)
-						<< (m_States[i].s_MeanState[0] - m_List[j][0])
-								/ i_Measurement->Value[j], (m_States[i].s_MeanState[1]
-						- m_List[j][1]) / i_Measurement->Value[j], 0;
-				h[j] = sqrt(
-						pow(m_States[i].s_MeanState[0] - m_List[j][0], 2)
-								+ pow(m_States[i].s_MeanState[1] - m_List[j][1],
-										2));
-			}
-			K = OldCov * H.transpose()
-					* (H * OldCov * H.transpose()
-							+ MatrixXd::Identity(H.rows(), H.rows())
-									* (m_DDist * m_DDist)).inverse();
-
-			m_States[i].s_MeanState += K * (i_Measurement->Value - h);
-			m_States[i].s_CovState = (Matrix3d::Identity() - K * H) * OldCov;
+}
+
+/* Учесть измерения */
+void vprobot::control::localization::CEKFLocalization::ProcessMeasurements(
+		const SMeasures * const *Measurements) {
+	size_t i;
+
+	for (i = 0; i < m_Count; i++) {
+		const SMeasuresPointsPosition *i_Measurement =
+				dynamic_cast<const SMeasuresPointsPosition *>(Measurements[i]);
+
+		if (i_Measurement == NULL)
+			continue;
+
+		/* Так как R = r I, то K = P H^T (H P H^T + r I)^-1 =
+		 * (P H^T H + r I)^-1 P H^T, и обращать нужно только матрицу 3x3.
+		 * H^T H и H^T (z - h) накапливаются за один проход по маякам. */
+		Matrix3d HtH = Matrix3d::Zero();
+		Vector3d HtInnovation = Vector3d::Zero();
+		const Matrix3d &OldCov = m_States[i].s_CovState;
+		const Vector3d &Mean = m_States[i].s_MeanState;
+		int j;
+
+		for (j = 0; j < i_Measurement->Value.rows(); j++) {
+			double dx = Mean[0] - m_List[j][0];
+			double dy = Mean[1] - m_List[j][1];
+			Vector3d Hj(dx / i_Measurement->Value[j],
+					dy / i_Measurement->Value[j], 0);
+
+			HtH.noalias() += Hj * Hj.transpose();
+			HtInnovation += Hj
+					* (i_Measurement->Value[j] - sqrt(dx * dx + dy * dy));
 		}
+
+		Matrix3d PHtH = OldCov * HtH;
+		Matrix3d AInv = (PHtH
+				+ Matrix3d::Identity() * (m_DDist * m_DDist)).inverse();
+		Matrix3d KH = AInv * PHtH;
+
+		m_States[i].s_MeanState += AInv * (OldCov * HtInnovation);
+		m_States[i].s_CovState = (Matrix3d::Identity() - KH) * OldCov;
 	}
 }
 
@@ -200,3 +182,30 @@ const ControlCommand * const vprobot::control::localization::CEKFLocalization::G
 	Process(Measurements);
 	return CSequentialControlSystem::GetCommands(Measurements);
 }
+
+/* Записать состояние в контрольную точку */
+void vprobot::control::localization::CEKFLocalization::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	CSequentialControlSystem::SaveState(Writer);
+	Writer.PutTag("ekf");
+	Writer.Put<uint64_t>(m_States.size());
+	for (auto &s : m_States) {
+		Writer.PutMatrix(s.s_MeanState);
+		Writer.PutMatrix(s.s_CovState);
+	}
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::control::localization::CEKFLocalization::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	uint64_t Count;
+
+	if (!CSequentialControlSystem::LoadState(Reader)
+			|| !Reader.ExpectTag("ekf") || !Reader.Get(Count)
+			|| Count != m_States.size())
+		return false;
+	for (auto &s : m_States)
+		if (!Reader.GetMatrix(s.s_MeanState) || !Reader.GetMatrix(s.s_CovState))
+			return false;
+	return true;
+}
@@ -46,12 +46,10 @@ private:
 	MapList m_List;
 
 	/* Параметры робота */
-	/* Обратный радус поворота */
-	double m_Radius;
 	/* Погрешность радиуса */
 	double m_DRadius;
-	/* Длина перемещения */
-	double m_Len;
+	/* Модель движения */
+	vprobot::robot::CMotionModel m_Motion;
 	/* Погрешность перемещения */
 	double m_DLen;
 	/* Погрешность по дистанции */
@@ -69,11 +67,13 @@ private:
 	typedef std::vector<SState> StateSet;
 	StateSet m_States;
 
-	/* Функция обработки */
-	void Process(const vprobot::robot::SMeasures * const *Measurements);
-
 	CEKFLocalization(const CEKFLocalization &ControlSystem) = default;
 protected:
+	/* Учесть последнюю команду */
+	void ProcessCommands();
+	/* Учесть измерения */
+	void ProcessMeasurements(
+			const vprobot::robot::SMeasures * const *Measurements);
 	/* Отображаем данные */
 	void DrawPresentation(
 			const vprobot::presentation::SPresentationParameters *Params,
@@ -86,6 +86,11 @@ public:
 	/* Получить команду */
 	const vprobot::robot::ControlCommand * const GetCommands(
 			const vprobot::robot::SMeasures * const *Measurements);
+
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 }
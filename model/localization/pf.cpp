@@ -0,0 +1,377 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pf.h"
+
+#include <cstddef>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#include "../../types.h"
+
+using namespace ::std;
+using namespace ::Eigen;
+using namespace ::vprobot;
+using namespace ::vprobot::line;
+using namespace ::vprobot::map;
+using namespace ::vprobot::robot;
+using namespace ::vprobot::presentation;
+using namespace ::vprobot::control;
+using namespace ::vprobot::control::localization;
+
+/* CParticleLocalization */
+
+vprobot::control::localization::CParticleLocalization::CParticleLocalization(
+		const Json::Value &ControlSystemObject) :
+		CSequentialControlSystem(ControlSystemObject), m_Map(NULL), m_Field(NULL), m_Generator(), m_Particles() {
+	m_DRadius = ControlSystemObject["dradius"].asDouble() / 3;
+	m_Len = ControlSystemObject["len"].asDouble();
+	m_Motion.SetParameters(m_Len, 1 / ControlSystemObject["radius"].asDouble());
+	m_DLen = ControlSystemObject["dlen"].asDouble() / 3;
+	m_DDist = ControlSystemObject["ddist"].asDouble() / 3;
+	m_MaxAngle = ControlSystemObject["max_angle"].asDouble();
+	m_MaxLength = ControlSystemObject["max_length"].asDouble();
+	m_NumBeams = ControlSystemObject["measures_count"].asUInt();
+
+	m_NumParticles = ControlSystemObject.get("robot_particles", 1000).asUInt();
+	m_BeamStep = ControlSystemObject.get("beam_step", 1).asUInt();
+	if (m_BeamStep == 0)
+		m_BeamStep = 1;
+	m_RandomMeasure = ControlSystemObject.get("random_measure", 0.05).asDouble();
+	/* Без случайной составляющей логарифм веса может стать -inf */
+	if (!GreaterThanZero(m_RandomMeasure)) {
+		clog << "random_measure must be positive, using 0.05" << endl;
+		m_RandomMeasure = 0.05;
+	}
+	m_ResampleThreshold =
+			ControlSystemObject.get("resample_threshold", 0.5).asDouble();
+
+	if (ControlSystemObject.isMember("seed"))
+		m_Generator.seed(ControlSystemObject["seed"].asUInt());
+	else {
+		random_device rd;
+
+		m_Generator.seed(rd());
+	}
+
+	Json::ArrayIndex i;
+	const Json::Value Params = ControlSystemObject["robot_params"];
+
+	/* Начальное распределение частиц нормальное, как у EKF */
+	for (i = 0; i < Params.size(); i++) {
+		const Json::Value i_Param = Params[i];
+		normal_distribution<double> nd_x(i_Param["x"].asDouble(),
+				i_Param["dx"].asDouble() / 3);
+		normal_distribution<double> nd_y(i_Param["y"].asDouble(),
+				i_Param["dy"].asDouble() / 3);
+		normal_distribution<double> nd_angle(i_Param["angle"].asDouble(),
+				i_Param["dangle"].asDouble() / 3);
+		size_t j;
+
+		m_Particles.emplace_back();
+
+		SParticles &p = m_Particles.back();
+
+		p.s_X.resize(m_NumParticles);
+		p.s_Y.resize(m_NumParticles);
+		p.s_Angle.resize(m_NumParticles);
+		for (j = 0; j < m_NumParticles; j++) {
+			p.s_X[j] = nd_x(m_Generator);
+			p.s_Y[j] = nd_y(m_Generator);
+			p.s_Angle[j] = CorrectAngle(nd_angle(m_Generator));
+		}
+		p.s_LogWeight = ArrayXd::Constant(m_NumParticles,
+				-log(static_cast<double>(m_NumParticles)));
+	}
+
+	const Json::Value MapArray = ControlSystemObject["points"];
+
+	for (i = 0; i < MapArray.size(); i++) {
+		const Json::Value &p = MapArray[i];
+
+		m_List.emplace_back(p["x"].asDouble(), p["y"].asDouble());
+	}
+	if (ControlSystemObject.isMember("lines")) {
+		m_Map = new CLineMap(ControlSystemObject);
+		if (ControlSystemObject.isMember("likelihood_field"))
+			m_Field = new CDistanceField(*m_Map,
+					ControlSystemObject["likelihood_field"]);
+	}
+
+	m_Len0.resize(m_NumParticles);
+	m_Curv.resize(m_NumParticles);
+	m_Cos.resize(m_NumParticles);
+	m_Sin.resize(m_NumParticles);
+	m_Weight.resize(m_NumParticles);
+	m_EndX.resize(m_NumParticles);
+	m_EndY.resize(m_NumParticles);
+	m_Resampled.s_X.resize(m_NumParticles);
+	m_Resampled.s_Y.resize(m_NumParticles);
+	m_Resampled.s_Angle.resize(m_NumParticles);
+}
+
+vprobot::control::localization::CParticleLocalization::~CParticleLocalization() {
+	delete m_Field;
+	delete m_Map;
+}
+
+/* Сдвинуть частицы по команде */
+void vprobot::control::localization::CParticleLocalization::Move(
+		SParticles &Particles, ControlCommand Command) {
+	if (Command == Nothing)
+		return;
+
+	/* Шум генерируется последовательно, остальное считается над массивами */
+	normal_distribution<double> nd_len(m_Len, m_DLen);
+	normal_distribution<double> nd_rad(m_Motion.GetCurvature(Command),
+			m_DRadius);
+	double Sign = m_Motion.GetLen(Command) < 0 ? -1 : 1;
+	size_t j;
+
+	for (j = 0; j < m_NumParticles; j++) {
+		m_Len0[j] = Sign * nd_len(m_Generator);
+		m_Curv[j] = nd_rad(m_Generator);
+	}
+	CMotionModel::Apply(Particles.s_X, Particles.s_Y, Particles.s_Angle, m_Len0,
+			m_Curv);
+}
+
+/* Учесть расстояния до маяков */
+void vprobot::control::localization::CParticleLocalization::WeightPoints(
+		SParticles &Particles, const VectorXd &Value) {
+	double k = 1 / (2 * m_DDist * m_DDist);
+	size_t j;
+
+	for (j = 0; j < m_List.size() && j < static_cast<size_t>(Value.rows());
+			j++) {
+		m_Weight = ((Particles.s_X - m_List[j][0]).square()
+				+ (Particles.s_Y - m_List[j][1]).square()).sqrt();
+		Particles.s_LogWeight -= (m_Weight - Value[j]).square() * k;
+	}
+}
+
+/* Учесть расстояния до препятствий по полю расстояний */
+void vprobot::control::localization::CParticleLocalization::WeightField(
+		SParticles &Particles, const VectorXd &Value) {
+	double k = 1 / (2 * m_DDist * m_DDist), da = m_MaxAngle * 2 / m_NumBeams;
+	size_t b;
+
+	/* Синусы и косинусы считаются один раз на скан, луч - поворот на Offset */
+	m_Cos = Particles.s_Angle.cos();
+	m_Sin = Particles.s_Angle.sin();
+	/* Оценивается только конец луча, трассировка не нужна */
+	for (b = 0; b < m_NumBeams && b < static_cast<size_t>(Value.rows()); b +=
+			m_BeamStep) {
+		double z = Value[b], Offset = b * da - m_MaxAngle;
+		double zc = z * cos(Offset), zs = z * sin(Offset);
+
+		/* Нулевое измерение - луч ушел за пределы дальности */
+		if (EqualsZero(z))
+			continue;
+		m_EndX = Particles.s_X + zc * m_Cos - zs * m_Sin;
+		m_EndY = Particles.s_Y + zs * m_Cos + zc * m_Sin;
+		m_Field->GetDistances(m_EndX, m_EndY, m_Weight);
+		Particles.s_LogWeight += ((m_Weight.square() * -k).exp()
+				+ m_RandomMeasure).log();
+	}
+}
+
+/* Учесть расстояния до препятствий */
+void vprobot::control::localization::CParticleLocalization::WeightDistances(
+		SParticles &Particles, const VectorXd &Value) {
+	if (m_Map == NULL)
+		return;
+	if (m_Field != NULL) {
+		WeightField(Particles, Value);
+		return;
+	}
+
+	double k = 1 / (2 * m_DDist * m_DDist), da = m_MaxAngle * 2 / m_NumBeams;
+	size_t b, j;
+
+	for (b = 0; b < m_NumBeams && b < static_cast<size_t>(Value.rows()); b +=
+			m_BeamStep) {
+		double z = Value[b], Offset = b * da - m_MaxAngle;
+
+		/* Нулевое измерение - луч ушел за пределы дальности, оно
+		 * пропускается так же, как в WeightField */
+		if (EqualsZero(z))
+			continue;
+		for (j = 0; j < m_NumParticles; j++) {
+			double d = m_Map->GetDistance(
+					Point(Particles.s_X[j], Particles.s_Y[j]),
+					Particles.s_Angle[j] + Offset);
+
+			if (EqualsZero(d) || GreaterThan(d, m_MaxLength))
+				d = m_MaxLength;
+			m_Weight[j] = d;
+		}
+		Particles.s_LogWeight += (((m_Weight - z).square() * -k).exp()
+				+ m_RandomMeasure).log();
+	}
+}
+
+/* Нормировать веса и при необходимости произвести выборку */
+void vprobot::control::localization::CParticleLocalization::Resample(
+		SParticles &Particles) {
+	m_Weight = (Particles.s_LogWeight - Particles.s_LogWeight.maxCoeff()).exp();
+
+	double Sum = m_Weight.sum();
+
+	m_Weight /= Sum;
+
+	double Effective = 1 / m_Weight.square().sum();
+
+	if (Effective >= m_ResampleThreshold * m_NumParticles) {
+		Particles.s_LogWeight = m_Weight.log();
+		return;
+	}
+
+	/* Систематическая выборка: одно случайное число на всю выборку */
+	uniform_real_distribution<double> ud(0, 1.0 / m_NumParticles);
+	double u = ud(m_Generator), c = m_Weight[0];
+	size_t i = 0, j;
+
+	for (j = 0; j < m_NumParticles; j++, u += 1.0 / m_NumParticles) {
+		while (u > c && i + 1 < m_NumParticles)
+			c += m_Weight[++i];
+		m_Resampled.s_X[j] = Particles.s_X[i];
+		m_Resampled.s_Y[j] = Particles.s_Y[i];
+		m_Resampled.s_Angle[j] = Particles.s_Angle[i];
+	}
+	Particles.s_X.swap(m_Resampled.s_X);
+	Particles.s_Y.swap(m_Resampled.s_Y);
+	Particles.s_Angle.swap(m_Resampled.s_Angle);
+	Particles.s_LogWeight.setConstant(-log(static_cast<double>(m_NumParticles)));
+}
+
+/* Учесть последнюю команду */
+void vprobot::control::localization::CParticleLocalization::ProcessCommands() {
+	size_t i;
+
+	for (i = 0; i < m_Count && i < m_Particles.size(); i++) {
+		Move(m_Particles[i], m_LastCommand[i]);
+	}
+}
+
+/* Учесть измерения */
+void vprobot::control::localization::CParticleLocalization::ProcessMeasurements(
+		const SMeasures * const *Measurements) {
+	size_t i;
+
+	for (i = 0; i < m_Count && i < m_Particles.size(); i++) {
+		const SMeasuresPointsPosition *i_Points =
+				dynamic_cast<const SMeasuresPointsPosition *>(Measurements[i]);
+		const SMeasuresDistances *i_Distances =
+				dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
+
+		if (i_Points != NULL)
+			WeightPoints(m_Particles[i], i_Points->Value);
+		else if (i_Distances != NULL)
+			WeightDistances(m_Particles[i], i_Distances->Value);
+		else
+			continue;
+		Resample(m_Particles[i]);
+	}
+}
+
+/* Парсинг параметров для экрана */
+SPresentationParameters *vprobot::control::localization::CParticleLocalization::ParsePresentation(
+		const Json::Value &PresentationObject) {
+	return new SParticlesPresentationPrameters(
+			PresentationObject.get("particles", 0).asUInt());
+}
+
+/* Отображаем данные */
+void vprobot::control::localization::CParticleLocalization::DrawPresentation(
+		const SPresentationParameters *Params, double IndicatorZoom,
+		CPresentationDriver &Driver) {
+	const SParticlesPresentationPrameters *i_Params =
+			dynamic_cast<const SParticlesPresentationPrameters *>(Params);
+	size_t Count = i_Params != NULL ? i_Params->m_Count : 0;
+
+	for (const auto &p : m_Particles) {
+		ArrayXd w = p.s_LogWeight.exp();
+		double Sum = w.sum();
+
+		w /= Sum;
+
+		Vector2d x((w * p.s_X).sum(), (w * p.s_Y).sum());
+		double angle = atan2((w * p.s_Angle.sin()).sum(),
+				(w * p.s_Angle.cos()).sum());
+		ArrayXd cx = p.s_X - x[0], cy = p.s_Y - x[1];
+		Matrix2d cov;
+
+		cov << (w * cx * cx).sum(), (w * cx * cy).sum(), (w * cx * cy).sum(), (w
+				* cy * cy).sum();
+
+		/* Часть частиц, равномерно по массиву */
+		if (Count > 0) {
+			size_t j, Step = std::max<size_t>(1, m_NumParticles / Count);
+
+			for (j = 0; j < m_NumParticles; j += Step) {
+				Driver.DrawCircle(p.s_X[j], p.s_Y[j], 0.1 * IndicatorZoom, 0,
+						128, 0, 128);
+			}
+		}
+		Driver.DrawEllipse(x, cov, 255, 0, 0, 64);
+		Driver.DrawLine(x[0], x[1], x[0] + cos(angle) * 0.8 * IndicatorZoom,
+				x[1] + sin(angle) * 0.8 * IndicatorZoom, 0, 0, 255, 255);
+		Driver.DrawCircle(x[0], x[1], 0.3 * IndicatorZoom, 255, 0, 0, 255);
+	}
+}
+
+/* Получить команду */
+const ControlCommand * const vprobot::control::localization::CParticleLocalization::GetCommands(
+		const SMeasures * const *Measurements) {
+	Process(Measurements);
+	return CSequentialControlSystem::GetCommands(Measurements);
+}
+
+/* Записать состояние в контрольную точку */
+void vprobot::control::localization::CParticleLocalization::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	CSequentialControlSystem::SaveState(Writer);
+	Writer.PutTag("pf");
+	Writer.PutEngine(m_Generator);
+	Writer.Put<uint64_t>(m_Particles.size());
+	for (auto &p : m_Particles) {
+		Writer.PutMatrix(p.s_X);
+		Writer.PutMatrix(p.s_Y);
+		Writer.PutMatrix(p.s_Angle);
+		Writer.PutMatrix(p.s_LogWeight);
+	}
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::control::localization::CParticleLocalization::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	uint64_t Count;
+
+	if (!CSequentialControlSystem::LoadState(Reader)
+			|| !Reader.ExpectTag("pf") || !Reader.GetEngine(m_Generator)
+			|| !Reader.Get(Count) || Count != m_Particles.size())
+		return false;
+	for (auto &p : m_Particles)
+		if (!Reader.GetMatrix(p.s_X) || !Reader.GetMatrix(p.s_Y)
+				|| !Reader.GetMatrix(p.s_Angle)
+				|| !Reader.GetMatrix(p.s_LogWeight))
+			return false;
+	return true;
+}
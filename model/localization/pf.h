@@ -0,0 +1,163 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOC_PF_H_
+#define __LOC_PF_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <vector>
+#include <random>
+#include <Eigen/Dense>
+#include <json/json.h>
+#include "../presentation.h"
+#include "../line.h"
+#include "../map.h"
+#include "../field.h"
+#include "../robot.h"
+#include "../control.h"
+
+namespace vprobot {
+
+namespace control {
+
+namespace localization {
+
+/* СУ с фильтром частиц */
+class CParticleLocalization: public CSequentialControlSystem {
+private:
+	typedef std::vector<line::Point, Eigen::aligned_allocator<line::Point>> MapList;
+
+	/* Маяки */
+	MapList m_List;
+	/* Карта препятствий для сканера (NULL, если не задана) */
+	vprobot::map::CLineMap *m_Map;
+	/* Поле расстояний по карте (NULL, если лучи трассируются) */
+	vprobot::map::CDistanceField *m_Field;
+
+	/* Параметры робота */
+	/* Модель движения */
+	vprobot::robot::CMotionModel m_Motion;
+	/* Погрешность радиуса */
+	double m_DRadius;
+	/* Длина перемещения */
+	double m_Len;
+	/* Погрешность перемещения */
+	double m_DLen;
+	/* Погрешность по дистанции */
+	double m_DDist;
+	/* Угол отклонения сканера */
+	double m_MaxAngle;
+	/* Дальность сканера */
+	double m_MaxLength;
+	/* Количество лучей сканера */
+	std::size_t m_NumBeams;
+
+	/* Параметры фильтра */
+	/* Количество частиц на робота */
+	std::size_t m_NumParticles;
+	/* Используется каждый m_BeamStep луч */
+	std::size_t m_BeamStep;
+	/* Вероятность случайного измерения (больше нуля) */
+	double m_RandomMeasure;
+	/* Доля эффективных частиц, при которой производится выборка */
+	double m_ResampleThreshold;
+
+	/* Генератор случайных чисел */
+	std::default_random_engine m_Generator;
+
+	/* Частицы робота (по массиву на координату) */
+	struct SParticles {
+		Eigen::ArrayXd s_X;
+		Eigen::ArrayXd s_Y;
+		Eigen::ArrayXd s_Angle;
+		/* Логарифмы весов */
+		Eigen::ArrayXd s_LogWeight;
+	};
+	typedef std::vector<SParticles> ParticleSet;
+	ParticleSet m_Particles;
+
+	/* Буферы для промежуточных значений */
+	Eigen::ArrayXd m_Len0;
+	Eigen::ArrayXd m_Curv;
+	Eigen::ArrayXd m_Cos;
+	Eigen::ArrayXd m_Sin;
+	Eigen::ArrayXd m_Weight;
+	Eigen::ArrayXd m_EndX;
+	Eigen::ArrayXd m_EndY;
+	SParticles m_Resampled;
+
+	/* Вывод данных */
+	struct SParticlesPresentationPrameters: public vprobot::presentation::SPresentationParameters {
+		std::size_t m_Count;
+
+		SParticlesPresentationPrameters(const std::size_t Count) :
+				m_Count(Count) {
+		}
+	};
+
+	/* Сдвинуть частицы по команде */
+	void Move(SParticles &Particles, vprobot::robot::ControlCommand Command);
+	/* Учесть расстояния до маяков */
+	void WeightPoints(SParticles &Particles, const Eigen::VectorXd &Value);
+	/* Учесть расстояния до препятствий по полю расстояний */
+	void WeightField(SParticles &Particles, const Eigen::VectorXd &Value);
+	/* Учесть расстояния до препятствий */
+	void WeightDistances(SParticles &Particles, const Eigen::VectorXd &Value);
+	/* Нормировать веса и при необходимости произвести выборку */
+	void Resample(SParticles &Particles);
+
+	CParticleLocalization(const CParticleLocalization &ControlSystem) = default;
+protected:
+	/* Учесть последнюю команду */
+	void ProcessCommands();
+	/* Учесть измерения */
+	void ProcessMeasurements(
+			const vprobot::robot::SMeasures * const *Measurements);
+	/* Парсинг параметров для экрана */
+	vprobot::presentation::SPresentationParameters *ParsePresentation(
+			const Json::Value &PresentationObject);
+	/* Отображаем данные */
+	void DrawPresentation(
+			const vprobot::presentation::SPresentationParameters *Params,
+			double IndicatorZoom,
+			vprobot::presentation::CPresentationDriver &Driver);
+public:
+	CParticleLocalization(const Json::Value &ControlSystemObject);
+	~CParticleLocalization();
+
+	/* Получить команду */
+	const vprobot::robot::ControlCommand * const GetCommands(
+			const vprobot::robot::SMeasures * const *Measurements);
+
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
+};
+
+}
+
+}
+
+}
+
+#endif
@@ -17,6 +17,13 @@
  */
 
 #include "map.h"
+
+#include <cstring>
+#include <cctype>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
 #include "../types.h"
 
 using namespace ::std;
@@ -26,78 +33,403 @@ using namespace ::vprobot::presentation;
 using namespace ::vprobot::line;
 using namespace ::vprobot::map;
 
+namespace {
+
+const char MapMagic[8] = {'V', 'P', 'R', 'M', 'A', 'P', 0, 0};
+const uint32_t MapVersion = 1;
+
+/* Тип карты в файле */
+enum MapFileType {
+	MapFilePoints = 0,
+	MapFileLines = 1,
+	MapFileGrid = 2
+};
+
+/* Заголовок двоичного файла карты. За ним идут номера первых точек линий
+ * (s_LineCount + 1 чисел uint64, только для линий), выравнивание до 16 байт
+ * и координаты точек (по два double). У сетки s_PointCount и s_LineCount -
+ * ширина и высота, за заголовком идут SGridInfo и строки CBitGrid */
+struct SMapHeader {
+	char s_Magic[8];
+	uint32_t s_Version;
+	uint32_t s_Type;
+	uint64_t s_PointCount;
+	uint64_t s_LineCount;
+};
+
+/* Параметры сетки в файле */
+struct SGridInfo {
+	double s_StartX;
+	double s_StartY;
+	double s_Resolution;
+	uint64_t s_Reserved;
+};
+
+/* Смещение массива точек от начала файла */
+inline size_t PointsOffset(uint64_t LineCount) {
+	size_t Offset = sizeof(SMapHeader)
+			+ (LineCount == 0 ? 0 : (LineCount + 1) * sizeof(uint64_t));
+
+	return (Offset + 15) & ~static_cast<size_t>(15);
+}
+
+/* Открыть файл карты и проверить заголовок и размеры */
+bool OpenMap(mapped::CMappedFile &File, const string &Name, uint32_t Type,
+		SMapHeader &Header) {
+	if (!File.Open(Name))
+		return false;
+	if (File.GetSize() >= sizeof(Header)) {
+		memcpy(&Header, File.GetData(), sizeof(Header));
+
+		/* Размеры проверяются до умножения, чтобы не было переполнения */
+		if (memcmp(Header.s_Magic, MapMagic, sizeof(MapMagic)) == 0
+				&& Header.s_Version == MapVersion && Header.s_Type == Type) {
+			uint64_t RowBytes = (Header.s_PointCount + 63) / 64
+					* sizeof(uint64_t);
+
+			if (Type == MapFileGrid) {
+				if (Header.s_PointCount <= File.GetSize() * 8
+						&& (RowBytes == 0
+								|| Header.s_LineCount <= File.GetSize() / RowBytes)
+						&& File.GetSize()
+								== sizeof(Header) + sizeof(SGridInfo)
+										+ Header.s_LineCount * RowBytes)
+					return true;
+			} else if (Header.s_PointCount <= File.GetSize() / sizeof(Point)
+					&& Header.s_LineCount <= File.GetSize() / sizeof(uint64_t)
+					&& File.GetSize()
+							== PointsOffset(Header.s_LineCount)
+									+ Header.s_PointCount * sizeof(Point))
+				return true;
+		}
+	}
+	File.Close();
+	return false;
+}
+
+/* Записать файл карты */
+bool SaveMap(const string &Name, uint32_t Type, const Point *Points,
+		size_t PointCount, const uint64_t *Offsets, size_t LineCount) {
+	ofstream File(Name.c_str(), ios::out | ios::binary | ios::trunc);
+	SMapHeader Header;
+	static const char Padding[16] = {0};
+	size_t i;
+
+	if (!File)
+		return false;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.s_Magic, MapMagic, sizeof(MapMagic));
+	Header.s_Version = MapVersion;
+	Header.s_Type = Type;
+	Header.s_PointCount = PointCount;
+	Header.s_LineCount = LineCount;
+	File.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+	if (LineCount != 0)
+		File.write(reinterpret_cast<const char *>(Offsets),
+				(LineCount + 1) * sizeof(uint64_t));
+	File.write(Padding,
+			PointsOffset(LineCount) - sizeof(Header)
+					- (LineCount == 0 ? 0 : (LineCount + 1) * sizeof(uint64_t)));
+	/* Точки пишутся по координатам, без возможного выравнивания Eigen */
+	for (i = 0; i < PointCount; i++)
+		File.write(reinterpret_cast<const char *>(Points[i].data()),
+				2 * sizeof(double));
+	return static_cast<bool>(File);
+}
+
+/* Пройти клетки сетки Width x Height со стороной Size, которые пересекает
+ * луч (x, y) + t * (dx, dy) при t в [t0, t1] (Amanatides, Woo). Visit(cx, cy,
+ * вход, выход) возвращает true, чтобы остановить обход */
+template<typename VisitFunction>
+bool Traverse(size_t Width, size_t Height, double Size, double x, double y,
+		double dx, double dy, double t0, double t1, VisitFunction Visit) {
+	/* Отсекаем луч по границам сетки */
+	double Bounds[2] = {Width * Size, Height * Size}, o[2] = {x, y}, d[2] = {
+			dx, dy};
+	int a;
+
+	for (a = 0; a < 2; a++) {
+		if (d[a] == 0) {
+			if (o[a] < 0 || o[a] >= Bounds[a])
+				return false;
+			continue;
+		}
+
+		double ta = -o[a] / d[a], tb = (Bounds[a] - o[a]) / d[a];
+
+		t0 = std::max(t0, std::min(ta, tb));
+		t1 = std::min(t1, std::max(ta, tb));
+	}
+	if (t0 >= t1)
+		return false;
+
+	/* Клетка входа (с поправкой на погрешность на границе) */
+	ptrdiff_t cx = std::min(std::max(floor((x + dx * t0) / Size), 0.0),
+			Width - 1.0), cy = std::min(
+			std::max(floor((y + dy * t0) / Size), 0.0), Height - 1.0);
+	ptrdiff_t StepX = dx > 0 ? 1 : -1, StepY = dy > 0 ? 1 : -1;
+	double DeltaX = dx != 0 ? Size / fabs(dx) : HUGE_VAL, DeltaY =
+			dy != 0 ? Size / fabs(dy) : HUGE_VAL;
+	double MaxX = dx != 0 ? ((cx + (dx > 0)) * Size - x) / dx : HUGE_VAL,
+			MaxY = dy != 0 ? ((cy + (dy > 0)) * Size - y) / dy : HUGE_VAL;
+
+	for (;;) {
+		double Exit = std::min(std::min(MaxX, MaxY), t1);
+
+		if (Visit(cx, cy, t0, Exit))
+			return true;
+		if (Exit >= t1)
+			return false;
+		t0 = Exit;
+		if (MaxX < MaxY) {
+			cx += StepX;
+			MaxX += DeltaX;
+		} else {
+			cy += StepY;
+			MaxY += DeltaY;
+		}
+		if (cx < 0 || cy < 0 || cx >= static_cast<ptrdiff_t>(Width)
+				|| cy >= static_cast<ptrdiff_t>(Height))
+			return false;
+	}
+}
+
+/* Палитра изображения сетки: 0 - свободно (прозрачно), 1 - занято */
+const unsigned char *GridPalette() {
+	static struct SGridPalette {
+		unsigned char Colors[256 * 4];
+
+		SGridPalette() {
+			memset(Colors, 0, sizeof(Colors));
+			Colors[4 + 3] = 255;
+		}
+	} Palette;
+
+	return Palette.Colors;
+}
+
+/* Прочитать число заголовка PGM (с пропуском комментариев) */
+bool PGMNumber(const char *&p, const char *End, unsigned long &Value) {
+	for (;;) {
+		while (p < End && isspace(static_cast<unsigned char>(*p)))
+			p++;
+		if (p < End && *p == '#') {
+			while (p < End && *p != '\n')
+				p++;
+			continue;
+		}
+		break;
+	}
+	if (p == End || !isdigit(static_cast<unsigned char>(*p)))
+		return false;
+	for (Value = 0; p < End && isdigit(static_cast<unsigned char>(*p)); p++) {
+		Value = Value * 10 + (*p - '0');
+		if (Value > 0xffffff)
+			return false;
+	}
+	return true;
+}
+
+}
+
 /* CPointMap */
 
-vprobot::map::CPointMap::CPointMap(const Json::Value &MapObject) :
-		CMap() {
+vprobot::map::CPointMap::CPointMap(const Json::Value &MapObject,
+		SMapGeometry *Geometry) :
+		CMap(), m_Points(NULL), m_Count(0), m_Storage(), m_File() {
+	string Name = MapObject["file"].asString();
+
+	if (!Name.empty()) {
+		SMapHeader Header;
+
+		if (OpenMap(m_File, Name, MapFilePoints, Header)) {
+			/* Точки используются прямо из отображенного файла */
+			m_Points = reinterpret_cast<const Point *>(m_File.GetData()
+					+ PointsOffset(0));
+			m_Count = Header.s_PointCount;
+		} else {
+			clog << "Couldn't load map file " << Name << endl;
+			m_Loaded = false;
+		}
+		return;
+	}
+
+	/* Маяки уже разобраны, забираем их без копирования */
+	if (Geometry != NULL && Geometry->s_HasPoints) {
+		m_Storage.swap(Geometry->s_Points);
+		m_Points = m_Storage.data();
+		m_Count = m_Storage.size();
+		return;
+	}
+
 	const Json::Value MapArray = MapObject["points"];
 
 	/* Загружаем данные */
 	Json::ArrayIndex i;
 
+	m_Storage.reserve(MapArray.size());
 	for (i = 0; i < MapArray.size(); i++) {
 		const Json::Value &p = MapArray[i];
 
-		m_List.emplace_back(p["x"].asDouble(), p["y"].asDouble());
+		m_Storage.emplace_back(p["x"].asDouble(), p["y"].asDouble());
 	}
+	m_Points = m_Storage.data();
+	m_Count = m_Storage.size();
 }
 
 vprobot::map::CPointMap::~CPointMap() {
 }
 
+/* Сохранить карту в двоичный файл (false, если не удалось) */
+bool vprobot::map::CPointMap::Save(const string &Name) const {
+	return SaveMap(Name, MapFilePoints, m_Points, m_Count, NULL, 0);
+}
+
+/* Перебрать препятствия карты */
+void vprobot::map::CPointMap::EnumerateObstacles(
+		const ObstacleFunction &Function) const {
+	size_t i;
+
+	for (i = 0; i < m_Count; i++) {
+		Function(m_Points[i], m_Points[i]);
+	}
+}
+
 /* Произвести измерение из точки по направлению */
-double vprobot::map::CPointMap::GetDistance(const Point &p, double angle) {
+double vprobot::map::CPointMap::GetDistance(const Point &p,
+		double angle) const {
 	/* Только точки, нет пересечений с препятствиями */
 	return 0;
 }
 
 /* Произвести измерение из точки до нужного маяка */
-double vprobot::map::CPointMap::GetDistance(const Point &p, size_t index) {
-	return (p - m_List[index]).norm();
+double vprobot::map::CPointMap::GetDistance(const Point &p,
+		size_t index) const {
+	return (p - m_Points[index]).norm();
 }
 
 /* Отображаем данные */
 void vprobot::map::CPointMap::DrawPresentation(
 		const SPresentationParameters *Params, double IndicatorZoom,
 		CPresentationDriver &Driver) {
-	for (auto p : m_List) {
-		Driver.DrawCircle(p[0], p[1], 0.3 * IndicatorZoom, 0, 0, 255, 255);
+	size_t i;
+
+	for (i = 0; i < m_Count; i++) {
+		Driver.DrawCircle(m_Points[i][0], m_Points[i][1], 0.3 * IndicatorZoom,
+				0, 0, 255, 255);
 	}
 }
 
 /* CLineMap */
 
-vprobot::map::CLineMap::CLineMap(const Json::Value &MapObject) :
-		CMap() {
+vprobot::map::CLineMap::CLineMap(const Json::Value &MapObject,
+		SMapGeometry *Geometry) :
+		CMap(), m_Points(NULL), m_Offsets(NULL), m_LineCount(0), m_Storage(), m_OffsetStorage(), m_File() {
+	string Name = MapObject["file"].asString();
+
+	if (!Name.empty()) {
+		SMapHeader Header;
+
+		if (OpenMap(m_File, Name, MapFileLines, Header)) {
+			const uint64_t *Offsets = reinterpret_cast<const uint64_t *>(m_File.GetData()
+					+ sizeof(Header));
+			uint64_t i;
+
+			if (Header.s_LineCount == 0 && Header.s_PointCount == 0)
+				return;
+			/* Номера точек должны возрастать и не выходить за массив */
+			for (i = 0; i < Header.s_LineCount; i++)
+				if (Offsets[i] > Offsets[i + 1])
+					break;
+			if (Header.s_LineCount != 0 && i == Header.s_LineCount
+					&& Offsets[0] == 0
+					&& Offsets[Header.s_LineCount] == Header.s_PointCount) {
+				/* Точки используются прямо из отображенного файла */
+				m_Points = reinterpret_cast<const Point *>(m_File.GetData()
+						+ PointsOffset(Header.s_LineCount));
+				m_Offsets = Offsets;
+				m_LineCount = Header.s_LineCount;
+				return;
+			}
+			m_File.Close();
+		}
+		clog << "Couldn't load map file " << Name << endl;
+		m_Loaded = false;
+		return;
+	}
+
+	/* Линии уже разобраны, забираем их без копирования */
+	if (Geometry != NULL && Geometry->s_HasLines) {
+		m_Storage.swap(Geometry->s_LinePoints);
+		m_OffsetStorage.swap(Geometry->s_Offsets);
+		m_Points = m_Storage.data();
+		m_Offsets = m_OffsetStorage.data();
+		m_LineCount = m_OffsetStorage.size() - 1;
+		return;
+	}
+
 	const Json::Value MapArray = MapObject["lines"];
 
 	/* Загружаем данные */
 	Json::ArrayIndex i;
 
+	m_OffsetStorage.reserve(MapArray.size() + 1);
+	m_OffsetStorage.push_back(0);
 	for (i = 0; i < MapArray.size(); i++) {
 		const Json::Value &l = MapArray[i];
-		MapList::reverse_iterator rl;
 		Json::ArrayIndex j;
 
-		m_List.emplace_back();
-		rl = m_List.rbegin();
 		for (j = 0; j < l.size(); j++) {
 			const Json::Value &p = l[j];
 
-			rl->emplace_back(p["x"].asDouble(), p["y"].asDouble());
+			m_Storage.emplace_back(p["x"].asDouble(), p["y"].asDouble());
 		}
+		m_OffsetStorage.push_back(m_Storage.size());
 	}
+	m_Points = m_Storage.data();
+	m_Offsets = m_OffsetStorage.data();
+	m_LineCount = MapArray.size();
 }
 
 vprobot::map::CLineMap::~CLineMap() {
 }
 
+/* Сохранить карту в двоичный файл (false, если не удалось) */
+bool vprobot::map::CLineMap::Save(const string &Name) const {
+	/* Карта без линий пишется с пустой таблицей линий */
+	if (m_LineCount == 0)
+		return SaveMap(Name, MapFileLines, NULL, 0, NULL, 0);
+	return SaveMap(Name, MapFileLines, m_Points, m_Offsets[m_LineCount],
+			m_Offsets, m_LineCount);
+}
+
+/* Перебрать препятствия карты */
+void vprobot::map::CLineMap::EnumerateObstacles(
+		const ObstacleFunction &Function) const {
+	size_t l;
+
+	for (l = 0; l < m_LineCount; l++) {
+		const Point *p = m_Points + m_Offsets[l];
+		size_t Count = m_Offsets[l + 1] - m_Offsets[l], i;
+
+		/* Линии замкнуты так же, как в line::Measure */
+		for (i = 0; i + 1 < Count; i++) {
+			Function(p[i], p[i + 1]);
+		}
+		if (Count > 2)
+			Function(p[Count - 1], p[0]);
+	}
+}
+
 /* Произвести измерение из точки по направлению */
-double vprobot::map::CLineMap::GetDistance(const Point &p, double angle) {
+double vprobot::map::CLineMap::GetDistance(const Point &p,
+		double angle) const {
 	double d = 0;
+	size_t l;
 
-	for (auto l : m_List) {
-		double l_d = Measure(l, p, angle);
+	for (l = 0; l < m_LineCount; l++) {
+		double l_d = Measure(m_Points + m_Offsets[l],
+				m_Offsets[l + 1] - m_Offsets[l], p, angle);
 
 		if (LessOrEqualsZero(l_d)) {
 			continue;
@@ -110,7 +442,8 @@ double vprobot::map::CLineMap::GetDistance(const Point &p, double angle) {
 }
 
 /* Произвести измерение из точки до нужного маяка */
-double vprobot::map::CLineMap::GetDistance(const Point &p, size_t index) {
+double vprobot::map::CLineMap::GetDistance(const Point &p,
+		size_t index) const {
 	/* Нет маяков, невозможно измерить */
 	return 0;
 }
@@ -119,19 +452,233 @@ double vprobot::map::CLineMap::GetDistance(const Point &p, size_t index) {
 void vprobot::map::CLineMap::DrawPresentation(
 		const SPresentationParameters *Params, double IndicatorZoom,
 		CPresentationDriver &Driver) {
-	for (auto l : m_List) {
-		size_t i;
-		Line::const_iterator cl = l.begin();
-		double *mx, *my;
-
-		mx = new double[l.size()];
-		my = new double[l.size()];
-		for (i = 0; i < l.size(); i++, cl++) {
-			mx[i] = (*cl)[0];
-			my[i] = (*cl)[1];
+	vector<double> mx, my;
+	size_t l;
+
+	for (l = 0; l < m_LineCount; l++) {
+		const Point *p = m_Points + m_Offsets[l];
+		size_t Count = m_Offsets[l + 1] - m_Offsets[l], i;
+
+		mx.resize(Count);
+		my.resize(Count);
+		for (i = 0; i < Count; i++) {
+			mx[i] = p[i][0];
+			my[i] = p[i][1];
+		}
+		Driver.DrawShape(mx.data(), my.data(), Count, 0, 0, 0, 255, 0, 0, 0, 0);
+	}
+}
+
+/* CGridMap */
+
+vprobot::map::CGridMap::CGridMap(const Json::Value &MapObject) :
+		CMap(), m_StartX(MapObject["x"].asDouble()), m_StartY(
+				MapObject["y"].asDouble()), m_Grid(), m_Block(
+				MapObject.get("block", 8).asUInt()), m_Blocks(), m_Image() {
+	string Name = MapObject["file"].asString();
+
+	m_Resolution = MapObject.get("resolution", 0.1).asDouble();
+	if (!Name.empty()) {
+		mapped::CMappedFile File;
+		SMapHeader Header;
+
+		if (OpenMap(File, Name, MapFileGrid, Header)) {
+			SGridInfo Info;
+			size_t y;
+
+			memcpy(&Info, File.GetData() + sizeof(Header), sizeof(Info));
+			m_StartX = Info.s_StartX;
+			m_StartY = Info.s_StartY;
+			m_Resolution = Info.s_Resolution;
+			m_Grid.Resize(Header.s_PointCount, Header.s_LineCount);
+			for (y = 0; y < m_Grid.GetHeight(); y++)
+				memcpy(m_Grid.Row(y),
+						File.GetData() + sizeof(Header) + sizeof(Info)
+								+ y * m_Grid.GetRowWords() * sizeof(uint64_t),
+						m_Grid.GetRowWords() * sizeof(uint64_t));
+		} else if (!File.Open(Name)
+				|| !LoadPGM(File.GetData(), File.GetSize(),
+						MapObject.get("threshold", 128).asUInt())) {
+			clog << "Couldn't load map file " << Name << endl;
+			m_Loaded = false;
+		}
+	} else
+		LoadRows(MapObject["rows"]);
+	/* Координаты клеток делятся на разрешение */
+	if (!GreaterThanZero(m_Resolution)) {
+		clog << "Grid map resolution must be positive" << endl;
+		m_Resolution = 0.1;
+		m_Loaded = false;
+	}
+	m_InvResolution = 1 / m_Resolution;
+	if (m_Block > 1)
+		m_Blocks.Downsample(m_Grid, m_Block);
+}
+
+vprobot::map::CGridMap::~CGridMap() {
+}
+
+/* Загрузить PGM */
+bool vprobot::map::CGridMap::LoadPGM(const char *Data, size_t Size,
+		unsigned int Threshold) {
+	const char *p = Data, *End = Data + Size;
+	unsigned long Width, Height, MaxValue, Value;
+	bool Binary;
+	size_t x, y;
+
+	if (Size < 2 || p[0] != 'P' || (p[1] != '5' && p[1] != '2'))
+		return false;
+	Binary = p[1] == '5';
+	p += 2;
+	if (!PGMNumber(p, End, Width) || !PGMNumber(p, End, Height)
+			|| !PGMNumber(p, End, MaxValue) || MaxValue == 0
+			|| MaxValue > 255 || p == End)
+		return false;
+	/* После заголовка двоичного PGM ровно один пробельный символ */
+	p++;
+	/* Размеры проверяются по остатку файла до выделения сетки: в двоичном
+	 * PGM байт на клетку, в текстовом - хотя бы цифра и разделитель
+	 * (деление вместо Width * Height, которое может переполниться) */
+	size_t Left = End - p;
+
+	if (!Binary)
+		Left = (Left + 1) / 2;
+	if (Width == 0 || Height > Left / Width)
+		return false;
+	m_Grid.Resize(Width, Height);
+	/* Строки PGM идут сверху вниз */
+	for (y = 0; y < Height; y++)
+		for (x = 0; x < Width; x++) {
+			if (Binary)
+				Value = static_cast<unsigned char>(*p++);
+			else if (!PGMNumber(p, End, Value))
+				return false;
+			if (Value * 255 < Threshold * MaxValue)
+				m_Grid.Set(x, Height - 1 - y);
 		}
-		Driver.DrawShape(mx, my, l.size(), 0, 0, 0, 255, 0, 0, 0, 0);
-		delete[] mx;
-		delete[] my;
+	return true;
+}
+
+/* Загрузить строки сетки */
+void vprobot::map::CGridMap::LoadRows(const Json::Value &Rows) {
+	Json::ArrayIndex i;
+	size_t Width = 0, x;
+
+	for (i = 0; i < Rows.size(); i++)
+		Width = std::max(Width, Rows[i].asString().size());
+	m_Grid.Resize(Width, Rows.size());
+	/* Строки идут сверху вниз, как на картинке */
+	for (i = 0; i < Rows.size(); i++) {
+		string Row = Rows[i].asString();
+
+		for (x = 0; x < Row.size(); x++)
+			if (Row[x] == '#')
+				m_Grid.Set(x, Rows.size() - 1 - i);
+	}
+}
+
+/* Сохранить карту в двоичный файл (false, если не удалось) */
+bool vprobot::map::CGridMap::Save(const string &Name) const {
+	ofstream File(Name.c_str(), ios::out | ios::binary | ios::trunc);
+	SMapHeader Header;
+	SGridInfo Info;
+	size_t y;
+
+	if (!File)
+		return false;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.s_Magic, MapMagic, sizeof(MapMagic));
+	Header.s_Version = MapVersion;
+	Header.s_Type = MapFileGrid;
+	Header.s_PointCount = m_Grid.GetWidth();
+	Header.s_LineCount = m_Grid.GetHeight();
+	memset(&Info, 0, sizeof(Info));
+	Info.s_StartX = m_StartX;
+	Info.s_StartY = m_StartY;
+	Info.s_Resolution = m_Resolution;
+	File.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char *>(&Info), sizeof(Info));
+	for (y = 0; y < m_Grid.GetHeight(); y++)
+		File.write(reinterpret_cast<const char *>(m_Grid.Row(y)),
+				m_Grid.GetRowWords() * sizeof(uint64_t));
+	return static_cast<bool>(File);
+}
+
+/* Перебрать препятствия карты (центры занятых клеток) */
+void vprobot::map::CGridMap::EnumerateObstacles(
+		const ObstacleFunction &Function) const {
+	size_t x, y, w;
+
+	for (y = 0; y < m_Grid.GetHeight(); y++) {
+		const uint64_t *r = m_Grid.Row(y);
+
+		for (w = 0; w < m_Grid.GetRowWords(); w++)
+			for (uint64_t Word = r[w]; Word != 0; Word &= Word - 1) {
+				x = w * 64 + __builtin_ctzll(Word);
+
+				Point p(m_StartX + (x + 0.5) * m_Resolution,
+						m_StartY + (y + 0.5) * m_Resolution);
+
+				Function(p, p);
+			}
+	}
+}
+
+/* Трассировать луч по клеткам */
+bool vprobot::map::CGridMap::Trace(double x, double y, double dx, double dy,
+		double &t) const {
+	size_t Width = m_Grid.GetWidth(), Height = m_Grid.GetHeight();
+	auto VisitCell = [&](ptrdiff_t cx, ptrdiff_t cy, double Enter, double) {
+		if (!m_Grid.Get(cx, cy))
+			return false;
+		t = Enter;
+		return true;
+	};
+
+	if (m_Block <= 1)
+		return Traverse(Width, Height, 1, x, y, dx, dy, 0, HUGE_VAL, VisitCell);
+	/* Пустые блоки проходятся за один шаг, в остальных - обход по клеткам */
+	return Traverse(m_Blocks.GetWidth(), m_Blocks.GetHeight(), m_Block, x, y,
+			dx, dy, 0, HUGE_VAL,
+			[&](ptrdiff_t bx, ptrdiff_t by, double Enter, double Exit) {
+				return m_Blocks.Get(bx, by)
+						&& Traverse(Width, Height, 1, x, y, dx, dy, Enter, Exit,
+								VisitCell);
+			});
+}
+
+/* Произвести измерение из точки по направлению */
+double vprobot::map::CGridMap::GetDistance(const Point &p,
+		double angle) const {
+	double t;
+
+	/* Луч трассируется в единицах клеток */
+	if (!Trace((p[0] - m_StartX) * m_InvResolution,
+			(p[1] - m_StartY) * m_InvResolution, cos(angle), sin(angle), t))
+		return 0;
+	return t * m_Resolution;
+}
+
+/* Произвести измерение из точки до нужного маяка */
+double vprobot::map::CGridMap::GetDistance(const Point &p,
+		size_t index) const {
+	/* Нет маяков, невозможно измерить */
+	return 0;
+}
+
+/* Отображаем данные */
+void vprobot::map::CGridMap::DrawPresentation(
+		const SPresentationParameters *Params, double IndicatorZoom,
+		CPresentationDriver &Driver) {
+	size_t Width = m_Grid.GetWidth(), Height = m_Grid.GetHeight(), x, y;
+
+	if (m_Image.size() != Width * Height) {
+		m_Image.resize(Width * Height);
+		for (y = 0; y < Height; y++)
+			for (x = 0; x < Width; x++)
+				m_Image[y * Width + x] = m_Grid.Get(x, y);
 	}
+	Driver.DrawGrid(m_StartX, m_StartY, m_StartX + Width * m_Resolution,
+			m_StartY + Height * m_Resolution, Width, Height, m_Image.data(),
+			GridPalette());
 }
@@ -24,37 +24,80 @@
 #endif
 
 #include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <string>
 #include <vector>
+#include <functional>
 #include <Eigen/Dense>
 #include <json/json.h>
 #include "presentation.h"
 #include "line.h"
+#include "mapped.h"
+#include "bitgrid.h"
 
 namespace vprobot {
 
 namespace map {
 
+/* Геометрия карты, прочитанная потоковым разбором JSON (см. loader.h) */
+struct SMapGeometry {
+	/* Найдены массивы "points" и "lines" */
+	bool s_HasPoints;
+	bool s_HasLines;
+	/* Маяки */
+	line::Line s_Points;
+	/* Точки всех линий подряд и номера первых точек линий */
+	line::Line s_LinePoints;
+	std::vector<std::uint64_t> s_Offsets;
+
+	SMapGeometry() :
+			s_HasPoints(false), s_HasLines(false), s_Points(), s_LinePoints(), s_Offsets() {
+	}
+};
+
 /* Класс карты */
 class CMap: public vprobot::presentation::CPresentationProvider {
 private:
 	CMap(const CMap &Map) = default;
+protected:
+	/* Карта загружена (false, если не удалось прочитать "file") */
+	bool m_Loaded;
 public:
-	CMap() = default;
+	/* Функция перебора препятствий (у точки концы отрезка совпадают) */
+	typedef std::function<void(const line::Point &, const line::Point &)> ObstacleFunction;
+
+	CMap() :
+			m_Loaded(true) {
+	}
 	virtual ~CMap() = default;
 
+	/* Карта загружена */
+	inline bool IsLoaded() const {
+		return m_Loaded;
+	}
+
+	/* Перебрать препятствия карты */
+	virtual void EnumerateObstacles(const ObstacleFunction &Function) const = 0;
+
 	/* Произвести измерение из точки по направлению */
-	virtual double GetDistance(const line::Point &p, double angle) = 0;
+	virtual double GetDistance(const line::Point &p, double angle) const = 0;
 	/* Произвести измерение из точки до нужного маяка */
-	virtual double GetDistance(const line::Point &p, std::size_t index) = 0;
+	virtual double GetDistance(const line::Point &p, std::size_t index) const = 0;
 };
 
-/* Карта, содержащая маяки */
+/* Карта, содержащая маяки
+ * ("file" - двоичный файл карты, иначе маяки берутся из "points"
+ * или из уже разобранной геометрии Geometry) */
 class CPointMap: public CMap {
 private:
 	typedef std::vector<line::Point, Eigen::aligned_allocator<line::Point>> MapList;
 
-	/* Содержание карты */
-	MapList m_List;
+	/* Маяки (m_Points указывает в m_Storage или в m_File) */
+	const line::Point *m_Points;
+	std::size_t m_Count;
+	MapList m_Storage;
+	mapped::CMappedFile m_File;
 
 	CPointMap(const CPointMap &Map) = default;
 protected:
@@ -64,22 +107,35 @@ protected:
 			double IndicatorZoom,
 			vprobot::presentation::CPresentationDriver &Driver);
 public:
-	CPointMap(const Json::Value &MapObject);
+	CPointMap(const Json::Value &MapObject, SMapGeometry *Geometry = NULL);
 	~CPointMap();
 
+	/* Сохранить карту в двоичный файл (false, если не удалось) */
+	bool Save(const std::string &Name) const;
+
+	/* Перебрать препятствия карты */
+	void EnumerateObstacles(const ObstacleFunction &Function) const;
+
 	/* Произвести измерение из точки по направлению */
-	double GetDistance(const line::Point &p, double angle);
+	double GetDistance(const line::Point &p, double angle) const;
 	/* Произвести измерение из точки до нужного маяка */
-	double GetDistance(const line::Point &p, std::size_t index);
+	double GetDistance(const line::Point &p, std::size_t index) const;
 };
 
-/* Карта, содержащая линии */
+/* Карта, содержащая линии
+ * ("file" - двоичный файл карты, иначе линии берутся из "lines"
+ * или из уже разобранной геометрии Geometry) */
 class CLineMap: public CMap {
 private:
-	typedef std::vector<line::Line> MapList;
-
-	/* Содержание карты */
-	MapList m_List;
+	/* Точки всех линий подряд и номера первых точек линий
+	 * (m_Offsets[m_LineCount] - общее число точек). Указатели ссылаются
+	 * в m_Storage и m_OffsetStorage или в отображенный файл m_File */
+	const line::Point *m_Points;
+	const std::uint64_t *m_Offsets;
+	std::size_t m_LineCount;
+	line::Line m_Storage;
+	std::vector<std::uint64_t> m_OffsetStorage;
+	mapped::CMappedFile m_File;
 
 	CLineMap(const CLineMap &Map) = default;
 protected:
@@ -89,13 +145,90 @@ protected:
 			double IndicatorZoom,
 			vprobot::presentation::CPresentationDriver &Driver);
 public:
-	CLineMap(const Json::Value &MapObject);
+	CLineMap(const Json::Value &MapObject, SMapGeometry *Geometry = NULL);
 	~CLineMap();
 
+	/* Сохранить карту в двоичный файл (false, если не удалось) */
+	bool Save(const std::string &Name) const;
+
+	/* Перебрать препятствия карты */
+	void EnumerateObstacles(const ObstacleFunction &Function) const;
+
+	/* Произвести измерение из точки по направлению */
+	double GetDistance(const line::Point &p, double angle) const;
+	/* Произвести измерение из точки до нужного маяка */
+	double GetDistance(const line::Point &p, std::size_t index) const;
+};
+
+/* Карта-растр занятости
+ * ("file" - PGM (P5/P2) или двоичный файл карты, иначе строки "rows" сверху
+ * вниз, '#' - занятая клетка; для PGM и "rows": "resolution" - размер
+ * клетки, "x", "y" - левый нижний угол, "threshold" - клетки PGM темнее
+ * порога заняты; "block" - размер блока для пропуска пустых областей
+ * при трассировке, 0 - без пропуска) */
+class CGridMap: public CMap {
+private:
+	/* Левый нижний угол */
+	double m_StartX;
+	double m_StartY;
+	/* Размер клетки */
+	double m_Resolution;
+	double m_InvResolution;
+	/* Занятые клетки */
+	vprobot::bitgrid::CBitGrid m_Grid;
+	/* Блоки m_Block x m_Block клеток, в которых есть занятые клетки */
+	std::size_t m_Block;
+	vprobot::bitgrid::CBitGrid m_Blocks;
+	/* Изображение для вывода (строится при первом выводе) */
+	std::vector<unsigned char> m_Image;
+
+	/* Загрузить PGM */
+	bool LoadPGM(const char *Data, std::size_t Size, unsigned int Threshold);
+	/* Загрузить строки сетки */
+	void LoadRows(const Json::Value &Rows);
+	/* Трассировать луч в координатах клеток (false - препятствий нет) */
+	bool Trace(double x, double y, double dx, double dy, double &t) const;
+
+	CGridMap(const CGridMap &Map) = default;
+protected:
+	/* Отображаем данные */
+	void DrawPresentation(
+			const vprobot::presentation::SPresentationParameters *Params,
+			double IndicatorZoom,
+			vprobot::presentation::CPresentationDriver &Driver);
+public:
+	CGridMap(const Json::Value &MapObject);
+	~CGridMap();
+
+	/* Сохранить карту в двоичный файл (false, если не удалось) */
+	bool Save(const std::string &Name) const;
+
+	/* Перебрать препятствия карты (центры занятых клеток) */
+	void EnumerateObstacles(const ObstacleFunction &Function) const;
+
 	/* Произвести измерение из точки по направлению */
-	double GetDistance(const line::Point &p, double angle);
+	double GetDistance(const line::Point &p, double angle) const;
 	/* Произвести измерение из точки до нужного маяка */
-	double GetDistance(const line::Point &p, std::size_t index);
+	double GetDistance(const line::Point &p, std::size_t index) const;
+
+	/* Клетка с точкой занята (за пределами сетки - свободно) */
+	inline bool IsOccupied(double x, double y) const {
+		double cx = std::floor((x - m_StartX) * m_InvResolution), cy =
+				std::floor((y - m_StartY) * m_InvResolution);
+
+		if (cx < 0 || cy < 0 || cx >= m_Grid.GetWidth()
+				|| cy >= m_Grid.GetHeight())
+			return false;
+		return m_Grid.Get(static_cast<std::size_t>(cx),
+				static_cast<std::size_t>(cy));
+	}
+	/* Сетка занятости */
+	inline const vprobot::bitgrid::CBitGrid &GetGrid() const {
+		return m_Grid;
+	}
+	inline double GetResolution() const {
+		return m_Resolution;
+	}
 };
 
 }
@@ -0,0 +1,139 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "mapped.h"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#define USE_MMAP 1
+#endif
+
+using namespace ::std;
+using namespace ::vprobot::mapped;
+
+#ifdef USE_MMAP
+namespace {
+
+/* Прочитать все данные из дескриптора (каналы, пустые файлы) */
+bool ReadAll(int fd, vector<char> &Buffer) {
+	const size_t Block = 65536;
+	size_t Size = 0;
+
+	for (;;) {
+		Buffer.resize(Size + Block);
+
+		ssize_t Count = read(fd, Buffer.data() + Size, Block);
+
+		if (Count < 0) {
+			if (errno == EINTR)
+				continue;
+			Buffer.clear();
+			return false;
+		}
+		if (Count == 0)
+			break;
+		Size += Count;
+	}
+	Buffer.resize(Size);
+	return true;
+}
+
+}
+#endif
+
+/* CMappedFile */
+
+vprobot::mapped::CMappedFile::CMappedFile() :
+		m_Data(NULL), m_Size(0), m_Mapped(false), m_Buffer() {
+}
+
+vprobot::mapped::CMappedFile::~CMappedFile() {
+	Close();
+}
+
+/* Открыть файл (false, если не удалось) */
+bool vprobot::mapped::CMappedFile::Open(const string &Name) {
+	Close();
+#ifdef USE_MMAP
+	int fd = open(Name.c_str(), O_RDONLY);
+	struct stat st;
+
+	if (fd < 0)
+		return false;
+	if (fstat(fd, &st) < 0) {
+		int Error = errno;
+
+		close(fd);
+		errno = Error;
+		return false;
+	}
+	/* Каналы и пустые файлы не отображаются, а читаются в буфер */
+	if (!S_ISREG(st.st_mode) || st.st_size == 0) {
+		bool Result = ReadAll(fd, m_Buffer);
+		int Error = errno;
+
+		close(fd);
+		errno = Error;
+		m_Data = m_Buffer.data();
+		m_Size = m_Buffer.size();
+		return Result;
+	}
+
+	void *Data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	int Error = errno;
+
+	close(fd);
+	if (Data == MAP_FAILED) {
+		errno = Error;
+		return false;
+	}
+	m_Data = static_cast<const char *>(Data);
+	m_Size = st.st_size;
+	m_Mapped = true;
+	return true;
+#else
+	ifstream File(Name.c_str(), ios::in | ios::binary);
+
+	if (!File)
+		return false;
+	m_Buffer.assign(istreambuf_iterator<char>(File),
+			istreambuf_iterator<char>());
+	m_Data = m_Buffer.data();
+	m_Size = m_Buffer.size();
+	return true;
+#endif
+}
+
+/* Закрыть файл */
+void vprobot::mapped::CMappedFile::Close() {
+#ifdef USE_MMAP
+	if (m_Mapped)
+		munmap(const_cast<char *>(m_Data), m_Size);
+#endif
+	m_Buffer.clear();
+	m_Data = NULL;
+	m_Size = 0;
+	m_Mapped = false;
+}
@@ -0,0 +1,71 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MAPPED_H_
+#define __MAPPED_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace vprobot {
+
+namespace mapped {
+
+/* Файл, отображенный в память только для чтения (без mmap, а также
+ * для каналов и пустых файлов содержимое читается в буфер) */
+class CMappedFile {
+private:
+	/* Начало данных */
+	const char *m_Data;
+	/* Размер данных */
+	std::size_t m_Size;
+	/* Данные отображены через mmap */
+	bool m_Mapped;
+	/* Буфер для систем без mmap */
+	std::vector<char> m_Buffer;
+
+	CMappedFile(const CMappedFile &File) = default;
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	/* Открыть файл (false, если не удалось, причина - в errno) */
+	bool Open(const std::string &Name);
+	/* Закрыть файл */
+	void Close();
+
+	/* Данные файла */
+	inline const char *GetData() const {
+		return m_Data;
+	}
+	/* Размер файла */
+	inline std::size_t GetSize() const {
+		return m_Size;
+	}
+};
+
+}
+
+}
+
+#endif
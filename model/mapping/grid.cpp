@@ -37,8 +37,8 @@ vprobot::control::mapping::CGridMapper::CGridMapper(
 		CSequentialControlSystem(ControlSystemObject), m_MapSet(), m_States() {
 	double i_Occ, i_Free;
 
-	m_Radius = 1 / ControlSystemObject["radius"].asDouble();
-	m_Len = ControlSystemObject["len"].asDouble();
+	m_Motion.SetParameters(ControlSystemObject["len"].asDouble(),
+			1 / ControlSystemObject["radius"].asDouble());
 	m_MaxAngle = ControlSystemObject["max_angle"].asDouble();
 	m_MaxLength = ControlSystemObject["max_length"].asDouble();
 	i_Occ = ControlSystemObject["prob_occ"].asDouble();
@@ -62,103 +62,79 @@ vprobot::control::mapping::CGridMapper::CGridMapper(
 		m_States.emplace_back();
 		m_States[i].s_MeanState << RobotParams["x"].asDouble(), RobotParams["y"].asDouble(), RobotParams["angle"].asDouble();
 	}
+
+	const SGridArea Area = {m_StartX, m_StartY, m_MapWidth, m_MapHeight};
+
+	m_SaveMap = ControlSystemObject["save_map"].asString();
+	if (!m_MapSet.empty())
+		LoadPrior(ControlSystemObject, m_MapSet[0], Area);
 }
 
 vprobot::control::mapping::CGridMapper::~CGridMapper() {
+	SavePrior(m_SaveMap, m_MapSet,
+			{m_StartX, m_StartY, m_MapWidth, m_MapHeight});
 }
 
-/* Получить команду */
-const ControlCommand * const vprobot::control::mapping::CGridMapper::GetCommands(
+/* Учесть последнюю команду */
+void vprobot::control::mapping::CGridMapper::ProcessCommands() {
+	size_t i;
+
+	for (i = 0; i < m_Count; i++)
+		m_Motion.Apply(m_States[i].s_MeanState, m_LastCommand[i]);
+}
+
+/* Учесть измерения */
+void vprobot::control::mapping::CGridMapper::ProcessMeasurements(
 		const SMeasures * const *Measurements) {
 	size_t i;
 
-	if (m_LastCommand != NULL) {
-		for (i = 0; i < m_Count; i++) {
-			if (m_LastCommand[i] == Nothing)
-				continue;
-
-			Vector2d u;
-
-			switch (m_LastCommand[i]) {
-				case Forward:
-					u << m_Len, 0;
-					break;
-				case ForwardLeft:
-					u << m_Len, m_Radius;
-					break;
-				case ForwardRight:
-					u << m_Len, -m_Radius;
-					break;
-				case Backward:
-					u << -m_Len, 0;
-					break;
-				case BackwardLeft:
-					u << -m_Len, m_Radius;
-					break;
-				case BackwardRight:
-					u << -m_Len, -m_Radius;
-					break;
-				default:
-					break;
-			}
-			double nangle = m_States[i].s_MeanState[2];
-			double dx, dy;
-
-			if (EqualsZero(u[1])) {
-				dx = u[0] * cos(nangle);
-				dy = u[0] * sin(nangle);
-			} else {
-				nangle = CorrectAngle(nangle + u[0] * u[1]);
-				dx = (sin(nangle) - sin(m_States[i].s_MeanState[2])) / u[1];
-				dy = (cos(m_States[i].s_MeanState[2]) - cos(nangle)) / u[1];
-			}
-			Vector3d OldMean = m_States[i].s_MeanState;
-			m_States[i].s_MeanState << OldMean[0] + dx, OldMean[1] + dy, nangle;
-		}
-	}
-	if (Measurements != NULL) {
-		for (i = 0; i < m_Count; i++) {
-			const SMeasuresDistances *i_Measurement =
-					dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
-
-			if (i_Measurement == NULL)
-				continue;
-
-			double da = m_MaxAngle * 2 / i_Measurement->Value.rows(), dx =
-					m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight,
-					dd = sqrt(dx * dx + dy * dy);
-			size_t x, y;
-
-			for (x = 0; x < m_NumWidth; x++)
-				for (y = 0; y < m_NumHeight; y++) {
-					double cx = dx * (x + 0.5) + m_StartX
-							- m_States[i].s_MeanState[0], cy = dy * (y + 0.5)
-							+ m_StartY - m_States[i].s_MeanState[1], nangle;
-					int nx;
-
-					nangle = atan2(cy, cx);
-					nx = static_cast<int>((CorrectAngle(
-							nangle - m_States[i].s_MeanState[2]) + m_MaxAngle)
-							/ da);
-					if (nx >= 0 && nx < i_Measurement->Value.rows()) {
-						double md, d = i_Measurement->Value[nx], cd = sqrt(
-								cx * cx + cy * cy);
-
-						if (EqualsZero(d)) {
-							md = 0;
-							d = m_MaxLength;
-						} else
-							md = d + dd;
-						if (LessOrEquals(cd, d)) {
-							m_MapSet[i].row(x)[y] += m_Free;
-						} else if (LessOrEquals(cd, md)) {
-							m_MapSet[i].row(x)[y] += m_Occ;
-						}
+	for (i = 0; i < m_Count; i++) {
+		const SMeasuresDistances *i_Measurement =
+				dynamic_cast<const SMeasuresDistances *>(Measurements[i]);
+
+		if (i_Measurement == NULL)
+			continue;
+
+		double da = m_MaxAngle * 2 / i_Measurement->Value.rows(), dx =
+				m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight,
+				dd = sqrt(dx * dx + dy * dy);
+		size_t x, y;
+
+		for (x = 0; x < m_NumWidth; x++)
+			for (y = 0; y < m_NumHeight; y++) {
+				double cx = dx * (x + 0.5) + m_StartX
+						- m_States[i].s_MeanState[0], cy = dy * (y + 0.5)
+						+ m_StartY - m_States[i].s_MeanState[1], nangle;
+				int nx;
+
+				nangle = atan2(cy, cx);
+				nx = static_cast<int>((CorrectAngle(
+						nangle - m_States[i].s_MeanState[2]) + m_MaxAngle)
+						/ da);
+				if (nx >= 0 && nx < i_Measurement->Value.rows()) {
+					double md, d = i_Measurement->Value[nx], cd = sqrt(
+							cx * cx + cy * cy);
+
+					if (EqualsZero(d)) {
+						md = 0;
+						d = m_MaxLength;
+					} else
+						md = d + dd;
+					if (LessOrEquals(cd, d)) {
+						m_MapSet[i].row(x)[y] += m_Free;
+					} else if (LessOrEquals(cd, md)) {
+						m_MapSet[i].row(x)[y] += m_Occ;
 					}
-
 				}
-		}
+
+			}
 	}
+}
+
+/* Получить команду */
+const ControlCommand * const vprobot::control::mapping::CGridMapper::GetCommands(
+		const SMeasures * const *Measurements) {
+	Process(Measurements);
 	return CSequentialControlSystem::GetCommands(Measurements);
 }
 
@@ -183,18 +159,39 @@ void vprobot::control::mapping::CGridMapper::DrawPresentation(
 			for (auto m : m_MapSet)
 				OutMap += m;
 		}
+		m_Image.FromLogOdds(OutMap);
+		m_Image.Draw(Driver, m_StartX, m_StartY, m_StartX + m_MapWidth,
+				m_StartY + m_MapHeight);
+	}
+}
 
-		size_t i, j;
-		double dx = m_MapWidth / m_NumWidth, dy = m_MapHeight / m_NumHeight, cx,
-				cy;
-
-		for (i = 0, cx = 0; i < m_NumWidth; i++, cx += dx)
-			for (j = 0, cy = 0; j < m_NumHeight; j++, cy += dy) {
-				double l = exp(OutMap.row(i)[j]);
-				int val = 255 - static_cast<int>(255 * l / (1 + l));
+/* Записать состояние в контрольную точку */
+void vprobot::control::mapping::CGridMapper::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	size_t i;
 
-				Driver.DrawRectangle(cx, cy, cx + dx, cy + dy, val, val, val,
-						255);
-			}
+	CSequentialControlSystem::SaveState(Writer);
+	Writer.PutTag("grid");
+	Writer.Put<uint64_t>(m_States.size());
+	for (i = 0; i < m_States.size(); i++) {
+		Writer.PutMatrix(m_States[i].s_MeanState);
+		Writer.PutMatrix(m_MapSet[i]);
 	}
 }
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::control::mapping::CGridMapper::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	uint64_t Count;
+	size_t i;
+
+	if (!CSequentialControlSystem::LoadState(Reader)
+			|| !Reader.ExpectTag("grid") || !Reader.Get(Count)
+			|| Count != m_States.size())
+		return false;
+	for (i = 0; i < m_States.size(); i++)
+		if (!Reader.GetMatrix(m_States[i].s_MeanState)
+				|| !Reader.GetMatrix(m_MapSet[i]))
+			return false;
+	return true;
+}
@@ -31,6 +31,7 @@
 #include "../presentation.h"
 #include "../robot.h"
 #include "../control.h"
+#include "prior.h"
 
 namespace vprobot {
 
@@ -46,10 +47,8 @@ public:
 	/* Набор карт */
 	typedef std::vector<GridMap> MapSet;
 private:
-	/* Обратный радус поворота */
-	double m_Radius;
-	/* Длина перемещения */
-	double m_Len;
+	/* Модель движения */
+	vprobot::robot::CMotionModel m_Motion;
 	/* Угол отклонения */
 	double m_MaxAngle;
 	/* Дальность */
@@ -64,8 +63,12 @@ private:
 	std::size_t m_NumHeight;
 	double m_StartX;
 	double m_StartY;
+	/* Файл, в который карта сохраняется в конце работы */
+	std::string m_SaveMap;
 	/* Набор карт */
 	MapSet m_MapSet;
+	/* Изображение карты для вывода */
+	vprobot::presentation::CGridImage m_Image;
 
 	/* Состояния роботов */
 	struct SState {
@@ -87,6 +90,11 @@ private:
 
 	CGridMapper(const CGridMapper &GridMapper) = default;
 protected:
+	/* Учесть последнюю команду */
+	void ProcessCommands();
+	/* Учесть измерения */
+	void ProcessMeasurements(
+			const vprobot::robot::SMeasures * const *Measurements);
 	/* Парсинг параметров для экрана */
 	vprobot::presentation::SPresentationParameters *ParsePresentation(
 			const Json::Value &PresentationObject);
@@ -102,6 +110,11 @@ public:
 	/* Получить команду */
 	const vprobot::robot::ControlCommand * const GetCommands(
 			const vprobot::robot::SMeasures * const *Measurements);
+
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 }
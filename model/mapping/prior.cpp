@@ -0,0 +1,128 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "prior.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "../mapped.h"
+
+using namespace ::std;
+using namespace ::Eigen;
+using namespace ::vprobot;
+using namespace ::vprobot::control::mapping;
+
+namespace {
+
+const char LogOddsMagic[8] = {'V', 'P', 'R', 'L', 'O', 'D', 'D', '1'};
+
+/* Заголовок файла карты, за ним значения по столбцам */
+struct SLogOddsHeader {
+	char s_Magic[8];
+	uint64_t s_Rows;
+	uint64_t s_Cols;
+	double s_StartX;
+	double s_StartY;
+	double s_Width;
+	double s_Height;
+};
+
+}
+
+/* Сохранить карту логарифмов шансов в файл, пригодный для отображения
+ * в память */
+bool vprobot::control::mapping::SaveLogOdds(const string &Name,
+		const MatrixXd &Map, const SGridArea &Area) {
+	SLogOddsHeader Header;
+	ofstream File(Name.c_str(), ios::out | ios::binary | ios::trunc);
+
+	if (!File)
+		return false;
+	memset(&Header, 0, sizeof(Header));
+	memcpy(Header.s_Magic, LogOddsMagic, sizeof(LogOddsMagic));
+	Header.s_Rows = Map.rows();
+	Header.s_Cols = Map.cols();
+	Header.s_StartX = Area.s_StartX;
+	Header.s_StartY = Area.s_StartY;
+	Header.s_Width = Area.s_Width;
+	Header.s_Height = Area.s_Height;
+	File.write(reinterpret_cast<const char *>(&Header), sizeof(Header));
+	File.write(reinterpret_cast<const char *>(Map.data()),
+			Map.size() * sizeof(double));
+	return static_cast<bool>(File.flush());
+}
+
+/* Загрузить сохраненную карту как начальную (размеры Map и область
+ * должны совпадать с сохраненными) */
+bool vprobot::control::mapping::LoadLogOdds(const string &Name, MatrixXd &Map,
+		const SGridArea &Area) {
+	mapped::CMappedFile File;
+	SLogOddsHeader Header;
+
+	if (!File.Open(Name) || File.GetSize() < sizeof(Header))
+		return false;
+	memcpy(&Header, File.GetData(), sizeof(Header));
+	if (memcmp(Header.s_Magic, LogOddsMagic, sizeof(LogOddsMagic)) != 0
+			|| Header.s_Rows != static_cast<uint64_t>(Map.rows())
+			|| Header.s_Cols != static_cast<uint64_t>(Map.cols())
+			|| Header.s_StartX != Area.s_StartX
+			|| Header.s_StartY != Area.s_StartY
+			|| Header.s_Width != Area.s_Width
+			|| Header.s_Height != Area.s_Height
+			|| File.GetSize() != sizeof(Header) + Map.size() * sizeof(double))
+		return false;
+	/* Формат совпадает с хранением Eigen, данные копируются целиком */
+	memcpy(Map.data(), File.GetData() + sizeof(Header),
+			Map.size() * sizeof(double));
+	return true;
+}
+
+/* Загрузить начальную карту из параметров СУ */
+void vprobot::control::mapping::LoadPrior(const Json::Value &ControlSystemObject,
+		MatrixXd &Map, const SGridArea &Area) {
+	/* Карта, сохраненная предыдущим запуском, используется как начальная */
+	if (ControlSystemObject.isMember("initial_map")
+			&& !LoadLogOdds(ControlSystemObject["initial_map"].asString(), Map,
+					Area))
+		clog << "Cannot load initial map "
+				<< ControlSystemObject["initial_map"].asString() << endl;
+}
+
+/* Сохранить карту */
+void vprobot::control::mapping::SavePrior(const string &Name,
+		const MatrixXd &Map, const SGridArea &Area) {
+	if (!Name.empty() && !SaveLogOdds(Name, Map, Area))
+		clog << "Cannot save map " << Name << endl;
+}
+
+/* Сохранить сумму карт роботов */
+void vprobot::control::mapping::SavePrior(const string &Name,
+		const vector<MatrixXd> &Maps, const SGridArea &Area) {
+	if (Name.empty() || Maps.empty())
+		return;
+
+	MatrixXd Map = MatrixXd::Zero(Maps[0].rows(), Maps[0].cols());
+
+	for (auto &m : Maps)
+		Map += m;
+	SavePrior(Name, Map, Area);
+}
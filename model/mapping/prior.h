@@ -0,0 +1,71 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __MAP_PRIOR_H_
+#define __MAP_PRIOR_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include <json/json.h>
+
+namespace vprobot {
+
+namespace control {
+
+namespace mapping {
+
+/* Область, покрываемая сеткой */
+struct SGridArea {
+	double s_StartX;
+	double s_StartY;
+	double s_Width;
+	double s_Height;
+};
+
+/* Сохранить карту логарифмов шансов в файл, пригодный для отображения
+ * в память */
+bool SaveLogOdds(const std::string &Name, const Eigen::MatrixXd &Map,
+		const SGridArea &Area);
+/* Загрузить сохраненную карту как начальную (размеры Map и область
+ * должны совпадать с сохраненными) */
+bool LoadLogOdds(const std::string &Name, Eigen::MatrixXd &Map,
+		const SGridArea &Area);
+
+/* Загрузить в Map карту из параметра initial_map СУ, если он задан */
+void LoadPrior(const Json::Value &ControlSystemObject, Eigen::MatrixXd &Map,
+		const SGridArea &Area);
+/* Сохранить карту в файл Name, если он задан */
+void SavePrior(const std::string &Name, const Eigen::MatrixXd &Map,
+		const SGridArea &Area);
+/* Сохранить сумму карт роботов (как при выводе) */
+void SavePrior(const std::string &Name, const std::vector<Eigen::MatrixXd> &Maps,
+		const SGridArea &Area);
+
+}
+
+}
+
+}
+
+#endif
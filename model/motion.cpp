@@ -0,0 +1,102 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "motion.h"
+
+using namespace ::std;
+using namespace ::Eigen;
+using namespace ::vprobot;
+
+/* CMotionModel */
+
+vprobot::robot::CMotionModel::CMotionModel() {
+	SetParameters(0, 0);
+}
+
+vprobot::robot::CMotionModel::CMotionModel(double Len, double Curvature) {
+	SetParameters(Len, Curvature);
+}
+
+/* Задать длину перемещения и обратный радиус поворота */
+void vprobot::robot::CMotionModel::SetParameters(double Len,
+		double Curvature) {
+	int i;
+
+	m_Len[Nothing] = 0;
+	m_Curv[Nothing] = 0;
+	m_Len[Forward] = Len;
+	m_Curv[Forward] = 0;
+	m_Len[ForwardRight] = Len;
+	m_Curv[ForwardRight] = -Curvature;
+	m_Len[ForwardLeft] = Len;
+	m_Curv[ForwardLeft] = Curvature;
+	m_Len[Backward] = -Len;
+	m_Curv[Backward] = 0;
+	m_Len[BackwardRight] = -Len;
+	m_Curv[BackwardRight] = -Curvature;
+	m_Len[BackwardLeft] = -Len;
+	m_Curv[BackwardLeft] = Curvature;
+	for (i = 0; i < MaxCommand; i++)
+		GetMotion(m_Len[i], m_Curv[i], m_Motions[i]);
+}
+
+/* Смещение для произвольного управления */
+void vprobot::robot::CMotionModel::GetMotion(double Len, double Curvature,
+		SMotion &Motion) {
+	Motion.s_Angle = Len * Curvature;
+	if (EqualsZero(Curvature)) { /* Бесконечный радиус поворота */
+		Motion.s_X = Len;
+		Motion.s_Y = 0;
+	} else {
+		Motion.s_X = sin(Motion.s_Angle) / Curvature;
+		Motion.s_Y = (1 - cos(Motion.s_Angle)) / Curvature;
+	}
+}
+
+/* Позиции после каждой из команд (States - массив из MaxCommand) */
+void vprobot::robot::CMotionModel::ApplyAll(const Vector3d &State,
+		Vector3d *States) const {
+	double c = cos(State[2]), s = sin(State[2]);
+	int i;
+
+	States[Nothing] = State;
+	for (i = Nothing + 1; i < MaxCommand; i++) {
+		const SMotion &Motion = m_Motions[i];
+
+		/* Порядок операций как в Apply, чтобы позиции совпадали точно */
+		States[i] << State[0] + (Motion.s_X * c - Motion.s_Y * s), State[1]
+				+ (Motion.s_X * s + Motion.s_Y * c), CorrectAngle(
+				State[2] + Motion.s_Angle);
+	}
+}
+
+/* Сдвинуть массив позиций, у каждой свое управление */
+void vprobot::robot::CMotionModel::Apply(ArrayXd &X, ArrayXd &Y,
+		ArrayXd &Angle, const ArrayXd &Len, const ArrayXd &Curvature) {
+	ArrayXd Turn = Len * Curvature;
+	auto Straight = Curvature.abs() < ErrorDomain;
+	ArrayXd dx = Straight.select(Len, Turn.sin() / Curvature);
+	ArrayXd dy = Straight.select(0.0, (1 - Turn.cos()) / Curvature);
+	ArrayXd c = Angle.cos(), s = Angle.sin();
+
+	X += dx * c - dy * s;
+	Y += dx * s + dy * c;
+	/* Шум может дать большой поворот, поэтому угол приводится полностью */
+	Angle += Turn;
+	Angle -= 2 * PI * ((Angle + PI) / (2 * PI)).floor();
+}
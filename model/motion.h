@@ -0,0 +1,121 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MOTION_H_
+#define __MOTION_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cmath>
+#include <Eigen/Dense>
+#include "../types.h"
+
+namespace vprobot {
+
+namespace robot {
+
+/* Тип для управления */
+typedef Eigen::Vector2d Control;
+/* Команды */
+enum ControlCommand {
+	Nothing = 0,
+	Forward,
+	ForwardRight,
+	ForwardLeft,
+	Backward,
+	BackwardRight,
+	BackwardLeft,
+	MaxCommand
+};
+
+/* Модель движения по дуге. Смещение и поворот для каждой команды считаются
+ * заранее в системе координат робота, и сдвиг позиции требует только
+ * поворота смещения на курс робота */
+class CMotionModel {
+public:
+	/* Смещение в системе координат робота и изменение курса */
+	struct SMotion {
+		double s_X;
+		double s_Y;
+		double s_Angle;
+	};
+private:
+	/* Перемещение и кривизна для каждой команды */
+	double m_Len[MaxCommand];
+	double m_Curv[MaxCommand];
+	/* Смещения для каждой команды */
+	SMotion m_Motions[MaxCommand];
+public:
+	CMotionModel();
+	CMotionModel(double Len, double Curvature);
+
+	/* Задать длину перемещения и обратный радиус поворота */
+	void SetParameters(double Len, double Curvature);
+
+	/* Перемещение по команде (отрицательное при движении назад) */
+	inline double GetLen(ControlCommand Command) const {
+		return m_Len[Command];
+	}
+	/* Кривизна по команде */
+	inline double GetCurvature(ControlCommand Command) const {
+		return m_Curv[Command];
+	}
+	/* Смещение по команде */
+	inline const SMotion &GetMotion(ControlCommand Command) const {
+		return m_Motions[Command];
+	}
+
+	/* Смещение для произвольного управления */
+	static void GetMotion(double Len, double Curvature, SMotion &Motion);
+	/* Смещение в глобальной системе координат при курсе Angle */
+	static inline void Displacement(const SMotion &Motion, double Angle,
+			double &dx, double &dy) {
+		double c = std::cos(Angle), s = std::sin(Angle);
+
+		dx = Motion.s_X * c - Motion.s_Y * s;
+		dy = Motion.s_X * s + Motion.s_Y * c;
+	}
+	/* Сдвинуть позицию */
+	static inline void Apply(Eigen::Vector3d &State, const SMotion &Motion) {
+		double dx, dy;
+
+		Displacement(Motion, State[2], dx, dy);
+		State[0] += dx;
+		State[1] += dy;
+		State[2] = CorrectAngle(State[2] + Motion.s_Angle);
+	}
+	/* Сдвинуть позицию по команде */
+	inline void Apply(Eigen::Vector3d &State, ControlCommand Command) const {
+		if (Command != Nothing)
+			Apply(State, m_Motions[Command]);
+	}
+	/* Позиции после каждой из команд (States - массив из MaxCommand) */
+	void ApplyAll(const Eigen::Vector3d &State, Eigen::Vector3d *States) const;
+	/* Сдвинуть массив позиций, у каждой свое управление */
+	static void Apply(Eigen::ArrayXd &X, Eigen::ArrayXd &Y,
+			Eigen::ArrayXd &Angle, const Eigen::ArrayXd &Len,
+			const Eigen::ArrayXd &Curvature);
+};
+
+}
+
+}
+
+#endif
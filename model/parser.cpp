@@ -19,15 +19,24 @@
 #include "parser.h"
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <iostream>
 #include <sstream>
 #include <functional>
+#include <random>
+#include <thread>
+#include <future>
+#include <algorithm>
 
 #include "localization/ekf.h"
+#include "localization/pf.h"
 #include "mapping/grid.h"
 #include "ai/ai.h"
 #include "ai/simple-ai.h"
 #include "ai/mcts-ai.h"
+#include "profiler.h"
+#include "checkpoint.h"
 
 using namespace ::std;
 using namespace ::vprobot;
@@ -42,7 +51,8 @@ using namespace ::vprobot::control::simple_ai;
 using namespace ::vprobot::control::mcts_ai;
 using namespace ::vprobot::scene;
 
-CScene *vprobot::Scene(const Json::Value &SceneObject) {
+CScene *vprobot::Scene(const Json::Value &SceneObject,
+		SMapGeometry *Geometry) {
 	CMap *Map = NULL;
 	CNormalScene::RobotSet Robots;
 	CControlSystem *ControlSystem = NULL;
@@ -52,12 +62,13 @@ CScene *vprobot::Scene(const Json::Value &SceneObject) {
 	string ControlSystemType(SceneObject["control_system_type"].asString());
 	size_t RobotsCount = SceneObject["robots_count"].asInt();
 
-	const int cMapTypes = 2;
-	static const char *MapAliases[cMapTypes] = {"Point", "Line"};
+	const int cMapTypes = 3;
+	static const char *MapAliases[cMapTypes] = {"Point", "Line", "Grid"};
 
 	function<CMap *()> MapConstructers[cMapTypes] = {
-			[&]() {return new CPointMap(SceneObject["map"]);},
-			[&]() {return new CLineMap(SceneObject["map"]);}};
+			[&]() {return new CPointMap(SceneObject["map"], Geometry);},
+			[&]() {return new CLineMap(SceneObject["map"], Geometry);},
+			[&]() {return new CGridMap(SceneObject["map"]);}};
 
 	const int cRobotTypes = 3;
 	static const char *RobotAliases[cRobotTypes] = {"WithExactPosition",
@@ -69,10 +80,10 @@ CScene *vprobot::Scene(const Json::Value &SceneObject) {
 					[&]() {return new CRobotWithPointsPosition(SceneObject["robot"], *Map);},
 					[&]() {return new CRobotWithScanner(SceneObject["robot"], *Map);}};
 
-	const int cControlSystemsTypes = 6;
+	const int cControlSystemsTypes = 7;
 	static const char *ControlSystemAliases[cControlSystemsTypes] = {
 			"Sequential", "EKF Localization", "Grid Mapper", "AI", "Simple AI",
-			"MCTS AI"};
+			"MCTS AI", "Particle Localization"};
 
 	function<CControlSystem *()> ControlSystemConstructors[cControlSystemsTypes] =
 			{
@@ -81,7 +92,8 @@ CScene *vprobot::Scene(const Json::Value &SceneObject) {
 					[&]() {return new CGridMapper(SceneObject["control_system"]);},
 					[&]() {return new CAIControlSystem(SceneObject["control_system"]);},
 					[&]() {return new CSimpleAI(SceneObject["control_system"]);},
-					[&]() {return new CMCTSAI(SceneObject["control_system"]);}};
+					[&]() {return new CMCTSAI(SceneObject["control_system"]);},
+					[&]() {return new CParticleLocalization(SceneObject["control_system"]);}};
 
 	size_t i;
 
@@ -94,6 +106,11 @@ CScene *vprobot::Scene(const Json::Value &SceneObject) {
 	}
 	if (Map == NULL)
 		return NULL;
+	/* Сцена без препятствий из-за ошибки в имени файла не создается */
+	if (!Map->IsLoaded()) {
+		delete Map;
+		return NULL;
+	}
 	for (i = 0; i < cRobotTypes; i++) {
 		if (RobotType == RobotAliases[i]) {
 			for (size_t j = 0; j < RobotsCount; j++) {
@@ -101,6 +118,15 @@ CScene *vprobot::Scene(const Json::Value &SceneObject) {
 
 				r->SetState(
 						SceneObject["robot_states"][static_cast<Json::ArrayIndex>(j)]);
+				/* Каждому роботу свой поток случайных чисел */
+				if (SceneObject.isMember("seed")) {
+					seed_seq Seq = {SceneObject["seed"].asUInt(),
+							static_cast<unsigned int>(j)};
+					unsigned int Seed;
+
+					Seq.generate(&Seed, &Seed + 1);
+					r->Seed(Seed);
+				}
 				r->InitPresentations(SceneObject["robot"]["presentations"]);
 				r->InitPresentations(
 						SceneObject["robot_presentations"][static_cast<Json::ArrayIndex>(j)]);
@@ -127,17 +153,28 @@ CScene *vprobot::Scene(const Json::Value &SceneObject) {
 		delete Map;
 		return NULL;
 	}
+
+	/* По умолчанию используем все ядра, но не больше числа роботов */
+	size_t Threads = SceneObject["threads"].asUInt();
+
+	if (Threads == 0)
+		Threads = thread::hardware_concurrency();
 	return new CNormalScene(Map, Robots, ControlSystem,
-			SceneObject["presentations"]);
+			SceneObject["presentations"], std::min(Threads, Robots.size()),
+			SceneObject["pipeline"].asBool());
 }
 
 /* CNormalScene */
 
 vprobot::scene::CNormalScene::CNormalScene(CMap *Map, RobotSet Robots,
-		CControlSystem *ControlSystem, const Json::Value &PresentationObject) :
-		m_Map(Map), m_Robots(Robots), m_ControlSystem(ControlSystem), m_Commands(
-		NULL), m_Time(0), m_Info(*this) {
+		CControlSystem *ControlSystem, const Json::Value &PresentationObject,
+		size_t Threads, bool Pipelined) :
+		m_Map(Map), m_Robots(Robots), m_ControlSystem(ControlSystem), m_Pipelined(
+				Pipelined), m_HasMeasures(false), m_Commands(NULL), m_Time(0), m_CheckpointName(), m_CheckpointInterval(
+				0), m_Pool(Threads), m_Info(*this) {
 	m_Measures = new const SMeasures *[m_Robots.size()];
+	m_NextMeasures = new const SMeasures *[m_Robots.size()];
+	m_ControlSystem->SetPipelined(m_Pipelined);
 	m_Info.InitPresentations(PresentationObject);
 }
 
@@ -147,25 +184,77 @@ vprobot::scene::CNormalScene::~CNormalScene() {
 		delete r;
 	delete m_Map;
 	delete[] m_Measures;
+	delete[] m_NextMeasures;
+}
+
+/* Выполнить команды и произвести измерения */
+void vprobot::scene::CNormalScene::Step(const ControlCommand *Commands,
+		const SMeasures **Measures) {
+	/* Роботы независимы, карта используется только для чтения */
+	m_Pool.Run(m_Robots.size(), [&](size_t i) {
+		if (Commands != NULL) {
+			profiler::CScopedTimer Timer(profiler::PhaseMotion);
+
+			m_Robots[i]->ExecuteCommand(Commands[i]);
+		}
+		Measures[i] = &(m_Robots[i]->Measure());
+	});
+}
+
+/* Выполнить шаг симуляции одновременно с планированием */
+void vprobot::scene::CNormalScene::SimulatePipelined() {
+	if (m_Time == 0) {
+		Step(NULL, m_Measures);
+
+		profiler::CScopedTimer Timer(profiler::PhasePlanning);
+
+		m_Commands = m_ControlSystem->GetCommands(m_Measures);
+	} else {
+		/* Система управления планирует следующий шаг по предсказанию,
+		 * пока роботы выполняют текущую команду. Робот хранит два буфера
+		 * измерений, поэтому предыдущие измерения не перезаписываются. */
+		const ControlCommand *Commands = m_Commands;
+		future<void> World = async(launch::async,
+				[&] {Step(Commands, m_NextMeasures);});
+
+		{
+			profiler::CScopedTimer Timer(profiler::PhasePlanning);
+
+			m_Commands = m_ControlSystem->GetCommands(
+					m_HasMeasures ? m_Measures : NULL);
+		}
+		World.wait();
+		swap(m_Measures, m_NextMeasures);
+		m_HasMeasures = true;
+	}
+	m_Time++;
+	if (m_Commands == NULL)
+		m_sState = SimulationEnd;
+	else
+		m_sState = SimulationWait;
 }
 
 /* Выполнить симуляцию */
 void vprobot::scene::CNormalScene::Simulate() {
-	size_t i;
+	profiler::Poll();
 
+	profiler::CScopedTimer Timer(profiler::PhaseStep);
+
+	if (m_Pipelined) {
+		SimulatePipelined();
+		return;
+	}
 	if (m_Commands != NULL || m_Time == 0) {
-		if (m_Commands != NULL) {
-			for (i = 0; i < m_Robots.size(); i++) {
-				m_Robots[i]->ExecuteCommand(m_Commands[i]);
-			}
-		}
-		for (i = 0; i < m_Robots.size(); i++) {
-			m_Measures[i] = &(m_Robots[i]->Measure());
-		}
+		Step(m_Commands, m_Measures);
 		m_Time++;
 		m_Commands = NULL;
 		m_sState = SimulationWorking;
+		if (m_CheckpointInterval != 0 && m_Time % m_CheckpointInterval == 0
+				&& !SaveCheckpoint(m_CheckpointName))
+			clog << "Cannot save checkpoint " << m_CheckpointName << endl;
 	} else {
+		profiler::CScopedTimer Timer(profiler::PhasePlanning);
+
 		m_Commands = m_ControlSystem->GetCommands(m_Measures);
 		if (m_Commands == NULL)
 			m_sState = SimulationEnd;
@@ -174,15 +263,82 @@ void vprobot::scene::CNormalScene::Simulate() {
 	}
 }
 
+/* Сохранить контрольную точку (только между шагами без конвейера) */
+bool vprobot::scene::CNormalScene::SaveCheckpoint(const string &Name) {
+	checkpoint::CWriter Writer;
+
+	/* В режиме конвейера планирование идет одновременно с шагом,
+	 * согласованного состояния между шагами нет */
+	if (m_Pipelined || m_Commands != NULL) {
+		clog << "Checkpoint is supported only between steps "
+				"without pipelining" << endl;
+		return false;
+	}
+	Writer.PutTag("scene");
+	Writer.Put<int32_t>(m_Time);
+	Writer.Put<uint64_t>(m_Robots.size());
+	for (auto r : m_Robots)
+		r->SaveState(Writer);
+	m_ControlSystem->SaveState(Writer);
+	return Writer.Save(Name);
+}
+
+/* Продолжить симуляцию с контрольной точки */
+bool vprobot::scene::CNormalScene::LoadCheckpoint(const string &Name) {
+	checkpoint::CReader Reader;
+	int32_t Time;
+	uint64_t Count;
+	size_t i;
+
+	if (m_Pipelined) {
+		clog << "Checkpoint is supported only without pipelining" << endl;
+		return false;
+	}
+	if (!Reader.Open(Name)) {
+		clog << "Cannot open checkpoint " << Name << endl;
+		return false;
+	}
+	if (!Reader.ExpectTag("scene") || !Reader.Get(Time) || !Reader.Get(Count)
+			|| Count != m_Robots.size()) {
+		clog << "Checkpoint " << Name << " does not match the scene" << endl;
+		return false;
+	}
+	for (i = 0; i < m_Robots.size(); i++) {
+		if (!m_Robots[i]->LoadState(Reader)) {
+			clog << "Checkpoint " << Name << ": invalid state of robot " << i
+					<< endl;
+			return false;
+		}
+		m_Measures[i] = &m_Robots[i]->LastMeasure();
+	}
+	if (!m_ControlSystem->LoadState(Reader) || !Reader.End()) {
+		clog << "Checkpoint " << Name << ": invalid control system state"
+				<< endl;
+		return false;
+	}
+	m_Time = Time;
+	m_Commands = NULL;
+	if (m_Time != 0)
+		m_sState = SimulationWorking;
+	return true;
+}
+
+/* Сохранять контрольную точку каждые Interval шагов */
+void vprobot::scene::CNormalScene::SetCheckpoint(const string &Name,
+		size_t Interval) {
+	m_CheckpointName = Name;
+	m_CheckpointInterval = Name.empty() ? 0 : Interval;
+}
+
 /* Нарисовать презентацию */
 void vprobot::scene::CNormalScene::DrawPresentation(
 		vprobot::presentation::CPresentationDriver &Driver,
-		const string &Name) {
-	m_Map->UpdatePresentation(Driver, Name);
-	m_Info.UpdatePresentation(Driver, Name);
-	m_ControlSystem->UpdatePresentation(Driver, Name);
+		vprobot::presentation::PresentationId Id) {
+	m_Map->UpdatePresentation(Driver, Id);
+	m_Info.UpdatePresentation(Driver, Id);
+	m_ControlSystem->UpdatePresentation(Driver, Id);
 	for (auto r : m_Robots) {
-		r->UpdatePresentation(Driver, Name);
+		r->UpdatePresentation(Driver, Id);
 	}
 }
 
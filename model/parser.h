@@ -23,6 +23,8 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
+#include <string>
 #include <vector>
 #include <json/json.h>
 #include "presentation.h"
@@ -30,6 +32,7 @@
 #include "map.h"
 #include "robot.h"
 #include "control.h"
+#include "pool.h"
 
 namespace vprobot {
 
@@ -47,10 +50,21 @@ private:
 	vprobot::control::CControlSystem *m_ControlSystem;
 	/* Измерения */
 	const vprobot::robot::SMeasures **m_Measures;
+	/* Измерения, получаемые во время планирования (режим конвейера) */
+	const vprobot::robot::SMeasures **m_NextMeasures;
+	/* Режим конвейера */
+	bool m_Pipelined;
+	/* Есть измерения, не переданные системе управления */
+	bool m_HasMeasures;
 	/* Команды */
 	const vprobot::robot::ControlCommand *m_Commands;
 	/* Текущий шаг */
 	int m_Time;
+	/* Файл и период автоматических контрольных точек */
+	std::string m_CheckpointName;
+	std::size_t m_CheckpointInterval;
+	/* Пул потоков для роботов */
+	vprobot::pool::CThreadPool m_Pool;
 	/* Класс для вывода информации */
 	class CInfo: public vprobot::presentation::CPresentationProvider {
 	private:
@@ -84,23 +98,39 @@ private:
 		~CInfo();
 	} m_Info;
 
+	/* Выполнить команды и произвести измерения */
+	void Step(const vprobot::robot::ControlCommand *Commands,
+			const vprobot::robot::SMeasures **Measures);
+	/* Выполнить шаг симуляции одновременно с планированием */
+	void SimulatePipelined();
+
 	CNormalScene(const CNormalScene &Scene) = default;
 public:
 	CNormalScene(vprobot::map::CMap *Map, RobotSet Robots,
 			vprobot::control::CControlSystem *ControlSystem,
-			const Json::Value &PresentationObject);
+			const Json::Value &PresentationObject, std::size_t Threads,
+			bool Pipelined);
 	~CNormalScene();
 
 	/* Выполнить симуляцию */
 	void Simulate();
+	/* Сохранить контрольную точку (только между шагами без конвейера) */
+	bool SaveCheckpoint(const std::string &Name);
+	/* Продолжить симуляцию с контрольной точки */
+	bool LoadCheckpoint(const std::string &Name);
+	/* Сохранять контрольную точку каждые Interval шагов */
+	void SetCheckpoint(const std::string &Name, std::size_t Interval);
 	/* Нарисовать презентацию */
 	void DrawPresentation(vprobot::presentation::CPresentationDriver &Driver,
-			const std::string &Name);
+			vprobot::presentation::PresentationId Id);
 };
 
 }
 
-vprobot::scene::CScene *Scene(const Json::Value &SceneObject);
+/* Создать сцену (Geometry - карта, заранее прочитанная loader::ParseModel;
+ * NULL при неизвестном типе или если файл карты не загрузился) */
+vprobot::scene::CScene *Scene(const Json::Value &SceneObject,
+		vprobot::map::SMapGeometry *Geometry = NULL);
 
 }
 
@@ -0,0 +1,112 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "pool.h"
+
+using namespace ::std;
+using namespace ::vprobot::pool;
+
+/* CThreadPool */
+
+vprobot::pool::CThreadPool::CThreadPool(size_t Threads) :
+		m_Threads(), m_Task(NULL), m_Count(0), m_Next(0), m_Busy(0), m_Generation(
+				0), m_Quit(false) {
+	size_t i;
+
+	if (Threads == 0)
+		Threads = thread::hardware_concurrency();
+	for (i = 1; i < Threads; i++) {
+		m_Threads.emplace_back(&CThreadPool::ThreadProcess, this);
+	}
+}
+
+vprobot::pool::CThreadPool::~CThreadPool() {
+	{
+		lock_guard<mutex> Lock(m_Mutex);
+
+		m_Quit = true;
+	}
+	m_CondWork.notify_all();
+	for (auto &t : m_Threads) {
+		t.join();
+	}
+}
+
+/* Обработать элементы текущей задачи */
+void vprobot::pool::CThreadPool::Work() {
+	for (;;) {
+		size_t i = m_Next.fetch_add(1, memory_order_relaxed);
+
+		if (i >= m_Count)
+			break;
+		(*m_Task)(i);
+	}
+}
+
+/* Функция рабочего потока */
+void vprobot::pool::CThreadPool::ThreadProcess() {
+	size_t Generation = 0;
+
+	for (;;) {
+		{
+			unique_lock<mutex> Lock(m_Mutex);
+
+			m_CondWork.wait(Lock,
+					[&] {return m_Quit || m_Generation != Generation;});
+			if (m_Quit)
+				break;
+			Generation = m_Generation;
+		}
+		Work();
+		{
+			lock_guard<mutex> Lock(m_Mutex);
+
+			if (--m_Busy == 0)
+				m_CondDone.notify_one();
+		}
+	}
+}
+
+/* Выполнить задачу для элементов [0, Count) и дождаться окончания */
+void vprobot::pool::CThreadPool::Run(size_t Count, const TaskFunction &Task) {
+	size_t i;
+
+	/* Не будим потоки, если работы на один поток */
+	if (m_Threads.empty() || Count < 2) {
+		for (i = 0; i < Count; i++) {
+			Task(i);
+		}
+		return;
+	}
+	{
+		lock_guard<mutex> Lock(m_Mutex);
+
+		m_Task = &Task;
+		m_Count = Count;
+		m_Next.store(0, memory_order_relaxed);
+		m_Busy = m_Threads.size();
+		m_Generation++;
+	}
+	m_CondWork.notify_all();
+	Work();
+
+	unique_lock<mutex> Lock(m_Mutex);
+
+	m_CondDone.wait(Lock, [&] {return m_Busy == 0;});
+	m_Task = NULL;
+}
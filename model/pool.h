@@ -0,0 +1,87 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __POOL_H_
+#define __POOL_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace vprobot {
+
+namespace pool {
+
+/* Пул потоков для независимых задач */
+class CThreadPool {
+public:
+	/* Тип для задачи (получает номер элемента) */
+	typedef std::function<void(std::size_t)> TaskFunction;
+private:
+	/* Рабочие потоки */
+	std::vector<std::thread> m_Threads;
+	/* Мьютекс для синхронизации */
+	std::mutex m_Mutex;
+	/* Условие появления работы */
+	std::condition_variable m_CondWork;
+	/* Условие завершения работы */
+	std::condition_variable m_CondDone;
+	/* Текущая задача */
+	const TaskFunction *m_Task;
+	/* Количество элементов */
+	std::size_t m_Count;
+	/* Следующий необработанный элемент */
+	std::atomic<std::size_t> m_Next;
+	/* Количество потоков, не закончивших работу */
+	std::size_t m_Busy;
+	/* Номер текущей работы */
+	std::size_t m_Generation;
+	/* Условие завершения потоков */
+	bool m_Quit;
+
+	/* Обработать элементы текущей задачи */
+	void Work();
+	/* Функция рабочего потока */
+	void ThreadProcess();
+
+	CThreadPool(const CThreadPool &Pool) = default;
+public:
+	CThreadPool(std::size_t Threads);
+	~CThreadPool();
+
+	/* Количество потоков (с учетом вызывающего) */
+	inline std::size_t GetThreads() const {
+		return m_Threads.size() + 1;
+	}
+	/* Выполнить задачу для элементов [0, Count) и дождаться окончания */
+	void Run(std::size_t Count, const TaskFunction &Task);
+};
+
+}
+
+}
+
+#endif
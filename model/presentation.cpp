@@ -19,6 +19,9 @@
 #include "presentation.h"
 
 #include <cmath>
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
 #include <Eigen/Eigenvalues>
 
 #include "../types.h"
@@ -28,6 +31,16 @@ using namespace ::Eigen;
 using namespace ::vprobot;
 using namespace ::vprobot::presentation;
 
+/* Получить идентификатор имени экрана (новые имена нумеруются подряд) */
+PresentationId vprobot::presentation::InternPresentationName(
+		const string &Name) {
+	static mutex Lock;
+	static unordered_map<string, PresentationId> Names;
+	lock_guard<mutex> Guard(Lock);
+
+	return Names.emplace(Name, Names.size()).first->second;
+}
+
 /* CPresentationDriver */
 
 /* Написовать эллипс по матрице */
@@ -43,14 +56,116 @@ void vprobot::presentation::CPresentationDriver::DrawEllipse(const Vector2d &x,
 			CorrectAngle(atan2(ev1[1].real(), ev1[0].real())), R, G, B, A);
 }
 
+/* Нарисовать сетку (по прямоугольнику на отрезок одинаковых клеток строки) */
+void vprobot::presentation::CPresentationDriver::DrawGrid(double x0, double y0,
+		double xf, double yf, size_t Width, size_t Height,
+		const unsigned char *Cells, const unsigned char *Palette) {
+	double dx = (xf - x0) / Width, dy = (yf - y0) / Height;
+	size_t i, j, k;
+
+	for (j = 0; j < Height; j++) {
+		const unsigned char *Row = Cells + j * Width;
+
+		for (i = 0; i < Width; i = k) {
+			const unsigned char *c = Palette + 4 * Row[i];
+
+			for (k = i + 1; k < Width && Row[k] == Row[i]; k++)
+				;
+			DrawRectangle(x0 + i * dx, y0 + j * dy, x0 + k * dx,
+					y0 + (j + 1) * dy, c[0], c[1], c[2], c[3]);
+		}
+	}
+}
+
+/* CGridImage */
+
+namespace {
+
+/* Границы лог-шансов: floor(255 * p) >= k, если l >= Thresholds[k - 1] */
+struct SThresholds {
+	double Values[254];
+
+	SThresholds() {
+		int k;
+
+		for (k = 1; k < 255; k++)
+			Values[k - 1] = log(k / (255.0 - k));
+	}
+};
+
+}
+
+vprobot::presentation::CGridImage::CGridImage() :
+		m_Cells(), m_Width(0), m_Height(0) {
+}
+
+/* Заполнить по лог-шансам занятости (строки матрицы - по x) */
+void vprobot::presentation::CGridImage::FromLogOdds(const MatrixXd &Map) {
+	static const SThresholds t;
+	size_t i, j;
+
+	m_Width = Map.rows();
+	m_Height = Map.cols();
+	m_Cells.resize(m_Width * m_Height);
+	/* То же, что 255 - int(255 * p), но двоичным поиском вместо exp */
+	for (j = 0; j < m_Height; j++)
+		for (i = 0; i < m_Width; i++)
+			m_Cells[j * m_Width + i] = 255
+					- (upper_bound(t.Values, t.Values + 254, Map(i, j))
+							- t.Values);
+}
+
+/* Заполнить по средней занятости из Count карт */
+void vprobot::presentation::CGridImage::FromMean(const MatrixXd &Map,
+		double Count) {
+	size_t i, j;
+
+	m_Width = Map.rows();
+	m_Height = Map.cols();
+	m_Cells.resize(m_Width * m_Height);
+	for (j = 0; j < m_Height; j++)
+		for (i = 0; i < m_Width; i++) {
+			int val = 255 - static_cast<int>(Map(i, j) / Count * 255);
+
+			m_Cells[j * m_Width + i] = std::min(std::max(val, 0), 255);
+		}
+}
+
+/* Нарисовать оттенками серого */
+void vprobot::presentation::CGridImage::Draw(CPresentationDriver &Driver,
+		double x0, double y0, double xf, double yf) const {
+	if (m_Cells.empty())
+		return;
+	Driver.DrawGrid(x0, y0, xf, yf, m_Width, m_Height, m_Cells.data(),
+			GrayPalette());
+}
+
+/* Палитра оттенков серого */
+const unsigned char *vprobot::presentation::CGridImage::GrayPalette() {
+	static struct SGrayPalette {
+		unsigned char Colors[256 * 4];
+
+		SGrayPalette() {
+			int i;
+
+			for (i = 0; i < 256; i++) {
+				Colors[4 * i] = Colors[4 * i + 1] = Colors[4 * i + 2] = i;
+				Colors[4 * i + 3] = 255;
+			}
+		}
+	} Palette;
+
+	return Palette.Colors;
+}
+
 /* CPresentationProvider */
 
 vprobot::presentation::CPresentationProvider::CPresentationProvider() :
-		m_DataSet() {
+		m_DataSet(), m_Index() {
 }
 
 vprobot::presentation::CPresentationProvider::~CPresentationProvider() {
-	for (auto p : m_DataSet) {
+	for (auto &p : m_DataSet) {
 		delete p.Parameters;
 	}
 }
@@ -62,7 +177,13 @@ void vprobot::presentation::CPresentationProvider::InitPresentations(
 
 	for (i = 0; i < PresentationObject.size(); i++) {
 		const Json::Value po = PresentationObject[i];
+		PresentationId Id = InternPresentationName(po["name"].asString());
 
+		/* Для экрана используется первое описание с его именем */
+		if (Id >= m_Index.size())
+			m_Index.resize(Id + 1, NoPresentation);
+		if (m_Index[Id] == NoPresentation)
+			m_Index[Id] = m_DataSet.size();
 		m_DataSet.emplace_back(ParsePresentation(po), po["name"].asString(),
 				po["indicator_zoom"].asDouble());
 	}
@@ -70,11 +191,11 @@ void vprobot::presentation::CPresentationProvider::InitPresentations(
 
 /* Нарисовать */
 void vprobot::presentation::CPresentationProvider::UpdatePresentation(
-		CPresentationDriver &Driver, const string &Name) {
-	for (auto d : m_DataSet) {
-		if (Name == d.Name) {
-			DrawPresentation(d.Parameters, d.IndicatorZoom, Driver);
-			break;
-		}
-	}
+		CPresentationDriver &Driver, PresentationId Id) {
+	if (Id >= m_Index.size() || m_Index[Id] == NoPresentation)
+		return;
+
+	const SPresentationData &d = m_DataSet[m_Index[Id]];
+
+	DrawPresentation(d.Parameters, d.IndicatorZoom, Driver);
 }
@@ -23,6 +23,7 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <Eigen/Dense>
@@ -32,6 +33,14 @@ namespace vprobot {
 
 namespace presentation {
 
+/* Идентификатор имени экрана */
+typedef std::size_t PresentationId;
+/* Отсутствующий идентификатор */
+const PresentationId NoPresentation = static_cast<PresentationId>(-1);
+
+/* Получить идентификатор имени экрана (новые имена нумеруются подряд) */
+PresentationId InternPresentationName(const std::string &Name);
+
 /* Интерфейс для отрисовки данных */
 class CPresentationDriver {
 private:
@@ -64,7 +73,34 @@ public:
 	/* Написать текст */
 	virtual void PutText(double x, double y, const char *Text, int R, int G,
 			int B, int A) = 0;
+	/* Нарисовать сетку Width x Height в прямоугольнике (x0, y0) - (xf, yf)
+	 * (Cells - по строкам, нулевая строка снизу; Palette - 256 цветов RGBA) */
+	virtual void DrawGrid(double x0, double y0, double xf, double yf,
+			std::size_t Width, std::size_t Height, const unsigned char *Cells,
+			const unsigned char *Palette);
+};
 
+/* Изображение сетки для вывода через DrawGrid */
+class CGridImage {
+private:
+	/* Значения клеток */
+	std::vector<unsigned char> m_Cells;
+	/* Размеры */
+	std::size_t m_Width;
+	std::size_t m_Height;
+public:
+	CGridImage();
+
+	/* Заполнить по лог-шансам занятости (строки матрицы - по x) */
+	void FromLogOdds(const Eigen::MatrixXd &Map);
+	/* Заполнить по средней занятости из Count карт */
+	void FromMean(const Eigen::MatrixXd &Map, double Count);
+	/* Нарисовать оттенками серого */
+	void Draw(CPresentationDriver &Driver, double x0, double y0, double xf,
+			double yf) const;
+
+	/* Палитра оттенков серого */
+	static const unsigned char *GrayPalette();
 };
 
 /* Интерфейс для классов с данными */
@@ -91,6 +127,8 @@ private:
 	typedef std::vector<SPresentationData> DataSet;
 
 	DataSet m_DataSet;
+	/* Индекс в m_DataSet по идентификатору имени (или NoPresentation) */
+	std::vector<std::size_t> m_Index;
 
 	CPresentationProvider(const CPresentationProvider &Provider) = default;
 protected:
@@ -109,8 +147,11 @@ public:
 	/* Инициализация дополнительных данных */
 	void InitPresentations(const Json::Value &PresentationObject);
 	/* Нарисовать */
-	void UpdatePresentation(CPresentationDriver &Driver,
-			const std::string &Name);
+	void UpdatePresentation(CPresentationDriver &Driver, PresentationId Id);
+	inline void UpdatePresentation(CPresentationDriver &Driver,
+			const std::string &Name) {
+		UpdatePresentation(Driver, InternPresentationName(Name));
+	}
 };
 
 /* Обработчик презентаций */
@@ -132,7 +173,7 @@ public:
 
 	/* Нарисовать */
 	virtual void DrawPresentation(CPresentationDriver &Driver,
-			const std::string &Name) = 0;
+			PresentationId Id) = 0;
 	/* Статус */
 	inline const SimulationState GetSimlationState() const {
 		return m_sState;
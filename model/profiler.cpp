@@ -0,0 +1,391 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "profiler.h"
+
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <set>
+#include <vector>
+#include <string>
+#include <sstream>
+
+using namespace ::std;
+using namespace ::vprobot::profiler;
+
+std::atomic<bool> vprobot::profiler::Active(false);
+
+namespace {
+
+/* Гистограмма по степеням двойки наносекунд */
+const size_t Buckets = 48;
+
+const char *PhaseNames[PhaseCount] = {"step", "motion", "measure", "planning",
+		"integration", "selection", "playout", "backprop", "record", "render",
+		"wait"};
+
+/* Событие трассировки */
+struct SEvent {
+	Phase s_Phase;
+	/* Начало от запуска трассировки и длительность в наносекундах */
+	int64_t s_Start;
+	uint64_t s_Duration;
+};
+
+/* Счетчики одного потока (пишет только владелец, читает отчет) */
+struct SCounters {
+	atomic<uint64_t> s_Count[PhaseCount];
+	atomic<uint64_t> s_Total[PhaseCount];
+	atomic<uint64_t> s_Histogram[PhaseCount][Buckets];
+	/* Номер потока в трассировке */
+	unsigned s_Thread;
+	/* Накопленные события (забираются потоком записи) */
+	mutex s_Lock;
+	vector<SEvent> s_Events;
+
+	SCounters(unsigned Thread) :
+			s_Thread(Thread), s_Lock(), s_Events() {
+		size_t i, j;
+
+		for (i = 0; i < PhaseCount; i++) {
+			s_Count[i] = 0;
+			s_Total[i] = 0;
+			for (j = 0; j < Buckets; j++)
+				s_Histogram[i][j] = 0;
+		}
+	}
+};
+
+/* События завершившегося потока */
+struct SFinishedEvents {
+	unsigned s_Thread;
+	vector<SEvent> s_Events;
+};
+
+/* Счетчики всех потоков */
+struct SRegistry {
+	mutex s_Lock;
+	set<SCounters *> s_Threads;
+	unsigned s_NextThread;
+	/* Данные завершившихся потоков */
+	SCounters s_Finished;
+	vector<SFinishedEvents> s_FinishedEvents;
+
+	/* Профилирование и трассировка */
+	atomic<bool> s_Profiling;
+	atomic<bool> s_Tracing;
+	/* Начало отсчета времени для трассировки */
+	chrono::steady_clock::time_point s_Epoch;
+	/* Файл трассировки и поток записи */
+	ofstream s_File;
+	bool s_FirstEvent;
+	thread s_Writer;
+	mutex s_WriterLock;
+	condition_variable s_WriterCond;
+	bool s_Stop;
+
+	SRegistry() :
+			s_Lock(), s_Threads(), s_NextThread(0), s_Finished(0), s_FinishedEvents(), s_Profiling(
+					false), s_Tracing(false), s_Epoch(), s_File(), s_FirstEvent(
+					true), s_Writer(), s_WriterLock(), s_WriterCond(), s_Stop(
+					false) {
+	}
+};
+
+/* Реестр не удаляется, чтобы пережить потоки, завершающиеся при выходе */
+SRegistry &Registry() {
+	static SRegistry *r = new SRegistry();
+
+	return *r;
+}
+
+/* Прибавить значение без атомарного сложения (писатель один) */
+inline void Increase(atomic<uint64_t> &Value, uint64_t Delta) {
+	Value.store(Value.load(memory_order_relaxed) + Delta,
+			memory_order_relaxed);
+}
+
+/* Счетчики текущего потока */
+class CThreadCounters {
+private:
+	SCounters *m_Counters;
+public:
+	CThreadCounters() :
+			m_Counters(NULL) {
+		SRegistry &r = Registry();
+		lock_guard<mutex> Guard(r.s_Lock);
+
+		m_Counters = new SCounters(r.s_NextThread++);
+		r.s_Threads.insert(m_Counters);
+	}
+	/* При завершении потока данные переносятся в общие счетчики */
+	~CThreadCounters() {
+		SRegistry &r = Registry();
+		lock_guard<mutex> Guard(r.s_Lock);
+		size_t i, j;
+
+		for (i = 0; i < PhaseCount; i++) {
+			Increase(r.s_Finished.s_Count[i], m_Counters->s_Count[i]);
+			Increase(r.s_Finished.s_Total[i], m_Counters->s_Total[i]);
+			for (j = 0; j < Buckets; j++)
+				Increase(r.s_Finished.s_Histogram[i][j],
+						m_Counters->s_Histogram[i][j]);
+		}
+		if (!m_Counters->s_Events.empty())
+			r.s_FinishedEvents.push_back(SFinishedEvents { m_Counters->s_Thread,
+					move(m_Counters->s_Events) });
+		r.s_Threads.erase(m_Counters);
+		delete m_Counters;
+	}
+
+	inline SCounters &Get() {
+		return *m_Counters;
+	}
+};
+
+volatile sig_atomic_t ReportRequested = 0;
+
+void SignalHandler(int) {
+	ReportRequested = 1;
+}
+
+void ReportAtExit() {
+	Report(clog);
+}
+
+/* Подпись интервала гистограммы */
+string FormatTime(uint64_t Nanoseconds) {
+	static const char *Units[] = {"ns", "us", "ms", "s"};
+	ostringstream s;
+	size_t i = 0;
+
+	while (Nanoseconds >= 1000 && i < 3) {
+		Nanoseconds /= 1000;
+		i++;
+	}
+	s << Nanoseconds << Units[i];
+	return s.str();
+}
+
+/* Записать накопленные события в файл (вызывается только потоком записи
+ * или после его остановки) */
+void WriteEvents() {
+	SRegistry &r = Registry();
+	vector<SFinishedEvents> Batch;
+	ostringstream Out;
+
+	{
+		lock_guard<mutex> Guard(r.s_Lock);
+
+		Batch.swap(r.s_FinishedEvents);
+		for (auto c : r.s_Threads) {
+			lock_guard<mutex> ThreadGuard(c->s_Lock);
+
+			if (c->s_Events.empty())
+				continue;
+			Batch.push_back(SFinishedEvents { c->s_Thread, vector<SEvent>() });
+			Batch.back().s_Events.swap(c->s_Events);
+		}
+	}
+	Out << fixed << setprecision(3);
+	for (auto &b : Batch) {
+		for (auto &e : b.s_Events) {
+			if (!r.s_FirstEvent)
+				Out << ",\n";
+			r.s_FirstEvent = false;
+			Out << "{\"name\":\"" << PhaseNames[e.s_Phase]
+					<< "\",\"cat\":\"vprobot\",\"ph\":\"X\",\"ts\":"
+					<< e.s_Start / 1e3 << ",\"dur\":" << e.s_Duration / 1e3
+					<< ",\"pid\":1,\"tid\":" << b.s_Thread << "}";
+		}
+	}
+	r.s_File << Out.str();
+	r.s_File.flush();
+}
+
+/* Поток записи трассировки */
+void WriterThread() {
+	SRegistry &r = Registry();
+	unique_lock<mutex> Lock(r.s_WriterLock);
+
+	while (!r.s_Stop) {
+		r.s_WriterCond.wait_for(Lock, chrono::milliseconds(100));
+		Lock.unlock();
+		WriteEvents();
+		Lock.lock();
+	}
+}
+
+/* Обновить общий флаг */
+void UpdateActive() {
+	SRegistry &r = Registry();
+
+	Active.store(r.s_Profiling.load() || r.s_Tracing.load());
+}
+
+}
+
+/* Включить профилировщик (отчет выводится при выходе и по SIGUSR1) */
+void vprobot::profiler::Enable(bool Enabled) {
+	static bool Installed = false;
+	SRegistry &r = Registry();
+
+	if (Enabled && !Installed) {
+		atexit(ReportAtExit);
+#ifdef SIGUSR1
+		signal(SIGUSR1, SignalHandler);
+#endif
+		Installed = true;
+	}
+	r.s_Profiling.store(Enabled);
+	UpdateActive();
+}
+
+/* Включить запись событий в формате Chrome trace (пустое имя - не писать) */
+void vprobot::profiler::EnableTrace(const string &Name) {
+	SRegistry &r = Registry();
+
+	FinishTrace();
+	if (Name.empty())
+		return;
+	r.s_File.open(Name.c_str(), ios::out | ios::trunc);
+	if (!r.s_File) {
+		clog << "Couldn't open trace file " << Name << endl;
+		return;
+	}
+	r.s_File << "{\"traceEvents\":[\n";
+	r.s_FirstEvent = true;
+	r.s_Epoch = chrono::steady_clock::now();
+	r.s_Stop = false;
+	r.s_Writer = thread(WriterThread);
+	r.s_Tracing.store(true);
+	UpdateActive();
+
+	static bool Installed = false;
+
+	if (!Installed) {
+		atexit(FinishTrace);
+		Installed = true;
+	}
+}
+
+/* Дописать события и закрыть файл трассировки */
+void vprobot::profiler::FinishTrace() {
+	SRegistry &r = Registry();
+
+	if (!r.s_Tracing.load())
+		return;
+	r.s_Tracing.store(false);
+	UpdateActive();
+	{
+		lock_guard<mutex> Guard(r.s_WriterLock);
+
+		r.s_Stop = true;
+	}
+	r.s_WriterCond.notify_one();
+	r.s_Writer.join();
+	WriteEvents();
+	r.s_File << "\n]}\n";
+	r.s_File.close();
+}
+
+/* Учесть время этапа */
+void vprobot::profiler::Add(Phase Kind, chrono::steady_clock::time_point Start,
+		uint64_t Nanoseconds) {
+	static thread_local CThreadCounters Counters;
+	SRegistry &r = Registry();
+	SCounters &c = Counters.Get();
+
+	if (r.s_Profiling.load(memory_order_relaxed)) {
+		size_t Bucket = 0;
+
+		while (Bucket + 1 < Buckets && (Nanoseconds >> (Bucket + 1)) != 0)
+			Bucket++;
+		Increase(c.s_Count[Kind], 1);
+		Increase(c.s_Total[Kind], Nanoseconds);
+		Increase(c.s_Histogram[Kind][Bucket], 1);
+	}
+	if (r.s_Tracing.load(memory_order_relaxed)) {
+		/* Блокировку берет поток записи раз в 100 мс, ожидания почти нет */
+		lock_guard<mutex> Guard(c.s_Lock);
+
+		c.s_Events.push_back(SEvent { Kind,
+				chrono::duration_cast<chrono::nanoseconds>(Start - r.s_Epoch).count(),
+				Nanoseconds });
+	}
+}
+
+/* Вывести отчет */
+void vprobot::profiler::Report(ostream &Out) {
+	SRegistry &r = Registry();
+	lock_guard<mutex> Guard(r.s_Lock);
+	ios::fmtflags Flags = Out.flags();
+	streamsize Precision = Out.precision();
+	size_t i, j;
+
+	Out << "Profile:" << endl << setw(12) << left << "phase" << right
+			<< setw(12) << "count" << setw(14) << "total ms" << setw(14)
+			<< "mean us" << endl;
+	for (i = 0; i < PhaseCount; i++) {
+		uint64_t Count = r.s_Finished.s_Count[i], Total =
+				r.s_Finished.s_Total[i], Histogram[Buckets];
+
+		for (j = 0; j < Buckets; j++)
+			Histogram[j] = r.s_Finished.s_Histogram[i][j];
+		for (auto c : r.s_Threads) {
+			Count += c->s_Count[i].load(memory_order_relaxed);
+			Total += c->s_Total[i].load(memory_order_relaxed);
+			for (j = 0; j < Buckets; j++)
+				Histogram[j] += c->s_Histogram[i][j].load(memory_order_relaxed);
+		}
+		if (Count == 0)
+			continue;
+		Out << setw(12) << left << PhaseNames[i] << right << setw(12) << Count
+				<< setw(14) << fixed << setprecision(3) << Total / 1e6
+				<< setw(14) << Total / 1e3 / Count << endl;
+
+		uint64_t Max = 0;
+
+		for (j = 0; j < Buckets; j++)
+			Max = std::max(Max, Histogram[j]);
+		for (j = 0; j < Buckets; j++) {
+			if (Histogram[j] == 0)
+				continue;
+			Out << "    " << setw(7) << FormatTime(1ULL << j) << " - "
+					<< setw(7) << left << FormatTime(2ULL << j) << right
+					<< setw(10) << Histogram[j] << " "
+					<< string((Histogram[j] * 40 + Max - 1) / Max, '#') << endl;
+		}
+	}
+	Out.flags(Flags);
+	Out.precision(Precision);
+}
+
+/* Вывести отчет, если он был запрошен сигналом */
+void vprobot::profiler::Poll() {
+	if (ReportRequested == 0)
+		return;
+	ReportRequested = 0;
+	Report(clog);
+}
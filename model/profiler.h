@@ -0,0 +1,108 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __PROFILER_H_
+#define __PROFILER_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <ostream>
+
+namespace vprobot {
+
+namespace profiler {
+
+/* Этапы, время которых измеряется */
+enum Phase {
+	/* Шаг симуляции целиком */
+	PhaseStep,
+	/* Выполнение команд роботами */
+	PhaseMotion,
+	/* Измерения роботов */
+	PhaseMeasure,
+	/* Получение команд от системы управления */
+	PhasePlanning,
+	/* Учет команд и измерений системой управления */
+	PhaseIntegration,
+	/* Выбор узла в дереве MCTS */
+	PhaseSelection,
+	/* Случайное моделирование MCTS */
+	PhasePlayout,
+	/* Обратное распространение MCTS */
+	PhaseBackprop,
+	/* Запись презентаций */
+	PhaseRecord,
+	/* Вывод презентаций */
+	PhaseRender,
+	/* Ожидание интерфейса пользователя */
+	PhaseWait,
+	PhaseCount
+};
+
+/* Включен профилировщик или трассировка */
+extern std::atomic<bool> Active;
+
+/* Включить профилировщик (отчет выводится при выходе и по SIGUSR1) */
+void Enable(bool Enabled);
+/* Включить запись событий в формате Chrome trace (пустое имя - не писать) */
+void EnableTrace(const std::string &Name);
+/* Дописать события и закрыть файл трассировки */
+void FinishTrace();
+/* Учесть время этапа */
+void Add(Phase Kind, std::chrono::steady_clock::time_point Start,
+		std::uint64_t Nanoseconds);
+/* Вывести отчет */
+void Report(std::ostream &Out);
+/* Вывести отчет, если он был запрошен сигналом */
+void Poll();
+
+/* Замер времени от создания до уничтожения объекта */
+class CScopedTimer {
+private:
+	Phase m_Phase;
+	bool m_Active;
+	std::chrono::steady_clock::time_point m_Start;
+
+	CScopedTimer(const CScopedTimer &Timer) = default;
+public:
+	inline CScopedTimer(Phase Kind) :
+			m_Phase(Kind), m_Active(Active.load(std::memory_order_relaxed)) {
+		if (m_Active)
+			m_Start = std::chrono::steady_clock::now();
+	}
+	inline ~CScopedTimer() {
+		if (m_Active)
+			Add(m_Phase, m_Start,
+					std::chrono::duration_cast<std::chrono::nanoseconds>(
+							std::chrono::steady_clock::now() - m_Start).count());
+	}
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,199 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "record.h"
+
+#include <cstring>
+#include <algorithm>
+
+using namespace ::std;
+using namespace ::vprobot::presentation;
+
+namespace {
+
+const char RecordMagic[8] = {'V', 'P', 'R', 'R', 'E', 'C', '0', '1'};
+
+/* Прочитать значение из файла с проверкой границ */
+template<typename T>
+bool ReadValue(const unsigned char *&Pos, const unsigned char *End,
+		T &Value) {
+	if (static_cast<size_t>(End - Pos) < sizeof(T))
+		return false;
+	memcpy(&Value, Pos, sizeof(T));
+	Pos += sizeof(T);
+	return true;
+}
+
+}
+
+/* CRecorder */
+
+vprobot::presentation::CRecorder::CRecorder(
+		const Json::Value &PresentationObject) :
+		m_File(), m_Interval(1), m_Step(0) {
+	const string Name = PresentationObject["record"].asString();
+
+	if (Name.empty())
+		return;
+	m_Interval = std::max(PresentationObject.get("record_interval", 1).asUInt(),
+			1u);
+	m_File.open(Name.c_str(), ios::out | ios::binary | ios::trunc);
+	if (!m_File)
+		return;
+
+	Json::FastWriter Writer;
+	const string Text = Writer.write(PresentationObject);
+	uint32_t Length = Text.size();
+
+	m_File.write(RecordMagic, sizeof(RecordMagic));
+	m_File.write(reinterpret_cast<const char *>(&Length), sizeof(Length));
+	m_File.write(Text.data(), Length);
+}
+
+vprobot::presentation::CRecorder::~CRecorder() {
+}
+
+/* Отметить очередной шаг (true, если его нужно записать) */
+bool vprobot::presentation::CRecorder::NextStep() {
+	if (!IsOpen())
+		return false;
+	return m_Step++ % m_Interval == 0;
+}
+
+/* Записать кадр (списки команд по порядку экранов) */
+void vprobot::presentation::CRecorder::Write(
+		const vector<CDisplayList *> &Frame) {
+	uint32_t Step = m_Step - 1;
+
+	m_File.write(reinterpret_cast<const char *>(&Step), sizeof(Step));
+	for (auto l : Frame) {
+		const vector<unsigned char> &Data = l->GetData();
+		uint32_t Size = Data.size();
+
+		m_File.write(reinterpret_cast<const char *>(&Size), sizeof(Size));
+		m_File.write(reinterpret_cast<const char *>(Data.data()), Size);
+	}
+}
+
+/* CRecording */
+
+vprobot::presentation::CRecording::CRecording() :
+		CPresentationHandler(), m_File(), m_Presentation(), m_Screens(0), m_Index(), m_Records(), m_Steps(), m_Frame(
+				0), m_Next(0) {
+}
+
+vprobot::presentation::CRecording::~CRecording() {
+}
+
+/* Открыть файл записи (false, если файл поврежден) */
+bool vprobot::presentation::CRecording::Open(const string &Name) {
+	m_Screens = 0;
+	m_Index.clear();
+	m_Records.clear();
+	m_Steps.clear();
+	m_sState = SimulationEnd;
+	if (!m_File.Open(Name))
+		return false;
+
+	const unsigned char *Pos =
+			reinterpret_cast<const unsigned char *>(m_File.GetData());
+	const unsigned char *End = Pos + m_File.GetSize();
+	uint32_t Length;
+
+	if (m_File.GetSize() < sizeof(RecordMagic)
+			|| memcmp(Pos, RecordMagic, sizeof(RecordMagic)) != 0)
+		return false;
+	Pos += sizeof(RecordMagic);
+	if (!ReadValue(Pos, End, Length)
+			|| static_cast<size_t>(End - Pos) < Length)
+		return false;
+
+	Json::Reader Reader;
+	const char *Text = reinterpret_cast<const char *>(Pos);
+
+	if (!Reader.parse(Text, Text + Length, m_Presentation, false))
+		return false;
+	Pos += Length;
+
+	const Json::Value Screens = m_Presentation["screens"];
+	Json::ArrayIndex i;
+
+	m_Screens = Screens.size();
+	for (i = 0; i < Screens.size(); i++) {
+		PresentationId Id = InternPresentationName(Screens[i]["name"].asString());
+
+		if (Id >= m_Index.size())
+			m_Index.resize(Id + 1, NoPresentation);
+		if (m_Index[Id] == NoPresentation)
+			m_Index[Id] = i;
+	}
+
+	/* Недописанный последний кадр отбрасывается */
+	while (Pos < End) {
+		const unsigned char *Frame = Pos;
+		uint32_t Step, Size;
+		size_t j;
+
+		if (!ReadValue(Pos, End, Step))
+			break;
+		for (j = 0; j < m_Screens; j++) {
+			if (!ReadValue(Pos, End, Size)
+					|| static_cast<size_t>(End - Pos) < Size)
+				break;
+			m_Records.push_back(SRecord { Pos, Size });
+			Pos += Size;
+		}
+		if (j < m_Screens) {
+			m_Records.resize(m_Steps.size() * m_Screens);
+			Pos = Frame;
+			break;
+		}
+		m_Steps.push_back(Step);
+	}
+	Seek(0);
+	return true;
+}
+
+/* Перейти к кадру */
+void vprobot::presentation::CRecording::Seek(size_t Frame) {
+	/* Кадр сразу становится текущим, следующий шаг показывает его же */
+	m_Frame = m_Steps.empty() ? 0 : std::min(Frame, m_Steps.size() - 1);
+	m_Next = Frame;
+	m_sState = m_Next < m_Steps.size() ? SimulationWait : SimulationEnd;
+}
+
+/* Перейти к следующему кадру */
+void vprobot::presentation::CRecording::Step() {
+	if (m_Next >= m_Steps.size())
+		return;
+	m_Frame = m_Next++;
+	m_sState = m_Next < m_Steps.size() ? SimulationWait : SimulationEnd;
+}
+
+/* Нарисовать */
+void vprobot::presentation::CRecording::DrawPresentation(
+		CPresentationDriver &Driver, PresentationId Id) {
+	if (m_Steps.empty() || Id >= m_Index.size()
+			|| m_Index[Id] == NoPresentation)
+		return;
+
+	const SRecord &Record = m_Records[m_Frame * m_Screens + m_Index[Id]];
+
+	CDisplayList::Replay(Record.s_Data, Record.s_Size, Driver);
+}
@@ -0,0 +1,130 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __RECORD_H_
+#define __RECORD_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <json/json.h>
+#include "presentation.h"
+#include "display-list.h"
+#include "mapped.h"
+
+namespace vprobot {
+
+namespace presentation {
+
+/* Формат файла записи:
+ * заголовок (сигнатура, длина и текст JSON-объекта "presentation"),
+ * затем кадры: номер шага (uint32) и для каждого экрана по порядку
+ * "screens" размер (uint32) и данные списка команд */
+
+/* Запись презентаций в файл (ключи "record" и "record_interval");
+ * NextStep вызывается один раз на завершенный шаг сцены */
+class CRecorder {
+private:
+	/* Файл записи */
+	std::ofstream m_File;
+	/* Записывается каждый m_Interval шаг */
+	std::size_t m_Interval;
+	/* Номер текущего шага */
+	std::uint32_t m_Step;
+
+	CRecorder(const CRecorder &Recorder) = default;
+public:
+	CRecorder(const Json::Value &PresentationObject);
+	~CRecorder();
+
+	/* Файл открыт */
+	inline bool IsOpen() const {
+		return m_File.is_open();
+	}
+	/* Отметить очередной шаг (true, если его нужно записать) */
+	bool NextStep();
+	/* Записать кадр (списки команд по порядку экранов) */
+	void Write(const std::vector<CDisplayList *> &Frame);
+};
+
+/* Воспроизведение записи как обработчик презентаций */
+class CRecording: public CPresentationHandler {
+private:
+	/* Список команд в файле */
+	struct SRecord {
+		const unsigned char *s_Data;
+		std::size_t s_Size;
+	};
+
+	/* Отображенный файл */
+	mapped::CMappedFile m_File;
+	/* Параметры вывода, с которыми велась запись */
+	Json::Value m_Presentation;
+	/* Количество экранов */
+	std::size_t m_Screens;
+	/* Номер экрана по идентификатору имени (или NoPresentation) */
+	std::vector<std::size_t> m_Index;
+	/* Списки команд по кадрам (m_Screens на кадр) */
+	std::vector<SRecord> m_Records;
+	/* Номера шагов кадров */
+	std::vector<std::uint32_t> m_Steps;
+	/* Текущий и следующий кадры */
+	std::size_t m_Frame;
+	std::size_t m_Next;
+
+	CRecording(const CRecording &Recording) = default;
+public:
+	CRecording();
+	~CRecording();
+
+	/* Открыть файл записи (false, если файл поврежден) */
+	bool Open(const std::string &Name);
+
+	/* Параметры вывода, с которыми велась запись */
+	inline const Json::Value &GetPresentation() const {
+		return m_Presentation;
+	}
+	/* Количество кадров */
+	inline std::size_t GetFrameCount() const {
+		return m_Steps.size();
+	}
+	/* Номер шага текущего кадра */
+	inline std::uint32_t GetStep() const {
+		return m_Steps.empty() ? 0 : m_Steps[m_Frame];
+	}
+	/* Перейти к кадру (за концом записи - к последнему и остановиться) */
+	void Seek(std::size_t Frame);
+	/* Перейти к следующему кадру */
+	void Step();
+
+	/* Нарисовать */
+	void DrawPresentation(CPresentationDriver &Driver, PresentationId Id);
+};
+
+}
+
+}
+
+#endif
@@ -18,9 +18,11 @@
 
 #include "robot.h"
 #include "line.h"
+#include "profiler.h"
 #include "../types.h"
 
 #include <cmath>
+#include <functional>
 
 using namespace ::std;
 using namespace ::Eigen;
@@ -33,13 +35,13 @@ using namespace ::vprobot::robot;
 /* CRobot */
 
 vprobot::robot::CRobot::CRobot(const Json::Value &RobotObject) :
-		CPresentationProvider(), m_State(), m_Generator() {
+		CPresentationProvider(), m_State(), m_Generator(), m_Buffer(0) {
 	random_device rd;
 
 	m_Generator.seed(rd());
-	m_Radius = 1 / RobotObject["radius"].asDouble();
 	m_DRadius = RobotObject["dradius"].asDouble() / 3;
 	m_Length = RobotObject["len"].asDouble();
+	m_Motion.SetParameters(m_Length, 1 / RobotObject["radius"].asDouble());
 	m_DLength = RobotObject["dlen"].asDouble() / 3;
 }
 
@@ -51,52 +53,53 @@ void vprobot::robot::CRobot::SetState(const Json::Value &StateObject) {
 	m_State.s_State << StateObject["x"].asDouble(), StateObject["y"].asDouble(), StateObject["angle"].asDouble();
 }
 
+/* Задать зерно генератора случайных чисел */
+void vprobot::robot::CRobot::Seed(unsigned int Seed) {
+	m_Generator.seed(Seed);
+}
+
+/* Записать состояние в контрольную точку */
+void vprobot::robot::CRobot::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	Writer.PutTag("robot");
+	Writer.PutMatrix(m_State.s_State);
+	Writer.PutEngine(m_Generator);
+	Writer.Put<uint8_t>(m_Buffer);
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::robot::CRobot::LoadState(vprobot::checkpoint::CReader &Reader) {
+	uint8_t Buffer;
+
+	if (!Reader.ExpectTag("robot") || !Reader.GetMatrix(m_State.s_State)
+			|| !Reader.GetEngine(m_Generator) || !Reader.Get(Buffer)
+			|| Buffer > 1)
+		return false;
+	m_Buffer = Buffer;
+	return true;
+}
+
 /* Выполнить команду */
 void vprobot::robot::CRobot::ExecuteCommand(const Control &Command) {
-	Point dx;
-	double angle = Command[0] * Command[1];
+	CMotionModel::SMotion Motion;
 
-	if (EqualsZero(Command[1])) { /* Бесконечный радиус поворота */
-		dx << Command[0], 0;
-	} else {
-		dx << sin(angle) / Command[1], (1 - cos(angle)) / Command[1];
-	}
-	m_State.s_State +=
-			(State() << Rotate(dx, m_State.s_State[2]), angle).finished();
-	m_State.s_State[2] = CorrectAngle(m_State.s_State[2]);
+	CMotionModel::GetMotion(Command[0], Command[1], Motion);
+	CMotionModel::Apply(m_State.s_State, Motion);
 }
 
 void vprobot::robot::CRobot::ExecuteCommand(const ControlCommand &Command) {
 	Control Cmd;
-	normal_distribution<double> nd_len(m_Length, m_DLength);
-	normal_distribution<double> nd_rad(0, m_DRadius);
-	auto gen_len = bind(nd_len, m_Generator);
-	auto gen_rad = bind(nd_rad, m_Generator);
-
-	switch (Command) {
-		case Nothing:
-			Cmd << 0, 0;
-			break;
-		case Forward:
-			Cmd << gen_len(), gen_rad();
-			break;
-		case ForwardLeft:
-			Cmd << gen_len(), m_Radius + gen_rad();
-			break;
-		case ForwardRight:
-			Cmd << gen_len(), -m_Radius + gen_rad();
-			break;
-		case Backward:
-			Cmd << -gen_len(), gen_rad();
-			break;
-		case BackwardLeft:
-			Cmd << -gen_len(), m_Radius + gen_rad();
-			break;
-		case BackwardRight:
-			Cmd << -gen_len(), -m_Radius + gen_rad();
-			break;
-		default:
-			break;
+
+	if (Command == Nothing) {
+		Cmd << 0, 0;
+	} else {
+		/* Шум добавляется к номинальному перемещению команды */
+		normal_distribution<double> nd_len(m_Length, m_DLength);
+		normal_distribution<double> nd_rad(0, m_DRadius);
+		double Len = nd_len(m_Generator);
+		double Curv = m_Motion.GetCurvature(Command) + nd_rad(m_Generator);
+
+		Cmd << (m_Motion.GetLen(Command) < 0 ? -Len : Len), Curv;
 	}
 	ExecuteCommand(Cmd);
 }
@@ -141,17 +144,40 @@ vprobot::robot::CRobotWithExactPosition::~CRobotWithExactPosition() {
 
 /* Произвести измерения */
 const SMeasures &vprobot::robot::CRobotWithExactPosition::Measure() {
-	m_Measure.Value = m_State.s_State;
-	return m_Measure;
+	profiler::CScopedTimer Timer(profiler::PhaseMeasure);
+	SMeasuresExactPosition &i_Measure = m_Measure[SwapBuffer()];
+
+	i_Measure.Value = m_State.s_State;
+	return i_Measure;
+}
+
+/* Последние измерения */
+const SMeasures &vprobot::robot::CRobotWithExactPosition::LastMeasure() const {
+	return m_Measure[m_Buffer];
+}
+
+/* Записать состояние в контрольную точку */
+void vprobot::robot::CRobotWithExactPosition::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	CRobot::SaveState(Writer);
+	Writer.PutMatrix(m_Measure[m_Buffer].Value);
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::robot::CRobotWithExactPosition::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	return CRobot::LoadState(Reader)
+			&& Reader.GetMatrix(m_Measure[m_Buffer].Value);
 }
 
 /* CRobotWithPointsPosition */
 
 vprobot::robot::CRobotWithPointsPosition::CRobotWithPointsPosition(
-		const Json::Value &RobotObject, CMap &Map) :
+		const Json::Value &RobotObject, const CMap &Map) :
 		CRobot(RobotObject), m_Measure(), m_Map(Map) {
 	m_Count = RobotObject["points_count"].asInt();
-	m_Measure.Value.resize(m_Count);
+	m_Measure[0].Value.resize(m_Count);
+	m_Measure[1].Value.resize(m_Count);
 	m_DDist = RobotObject["ddist"].asDouble() / 3;
 }
 
@@ -160,24 +186,46 @@ vprobot::robot::CRobotWithPointsPosition::~CRobotWithPointsPosition() {
 
 /* Произвести измерения */
 const SMeasures &vprobot::robot::CRobotWithPointsPosition::Measure() {
+	profiler::CScopedTimer Timer(profiler::PhaseMeasure);
 	size_t i;
 	Point r(m_State.s_State[0], m_State.s_State[1]);
 	normal_distribution<double> nd_dist(0, m_DDist);
-	auto gen_dist = bind(nd_dist, m_Generator);
+	auto gen_dist = bind(nd_dist, ref(m_Generator));
+	SMeasuresPointsPosition &i_Measure = m_Measure[SwapBuffer()];
 
 	for (i = 0; i < m_Count; i++) {
-		m_Measure.Value[i] = m_Map.GetDistance(r, i) + gen_dist();
+		i_Measure.Value[i] = m_Map.GetDistance(r, i) + gen_dist();
 	}
-	return m_Measure;
+	return i_Measure;
+}
+
+/* Последние измерения */
+const SMeasures &vprobot::robot::CRobotWithPointsPosition::LastMeasure() const {
+	return m_Measure[m_Buffer];
+}
+
+/* Записать состояние в контрольную точку */
+void vprobot::robot::CRobotWithPointsPosition::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	CRobot::SaveState(Writer);
+	Writer.PutMatrix(m_Measure[m_Buffer].Value);
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::robot::CRobotWithPointsPosition::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	return CRobot::LoadState(Reader)
+			&& Reader.GetMatrix(m_Measure[m_Buffer].Value, true);
 }
 
 /* CRobotWithPointsScanner */
 
 vprobot::robot::CRobotWithScanner::CRobotWithScanner(
-		const Json::Value &RobotObject, CMap &Map) :
+		const Json::Value &RobotObject, const CMap &Map) :
 		CRobot(RobotObject), m_Measure(), m_Map(Map) {
 	m_Count = RobotObject["measures_count"].asInt();
-	m_Measure.Value.resize(m_Count);
+	m_Measure[0].Value.resize(m_Count);
+	m_Measure[1].Value.resize(m_Count);
 	m_MaxAngle = RobotObject["max_angle"].asDouble();
 	m_MaxLength = RobotObject["max_length"].asDouble();
 	m_DDist = RobotObject["ddist"].asDouble() / 3;
@@ -204,6 +252,7 @@ void vprobot::robot::CRobotWithScanner::DrawPresentation(
 			dynamic_cast<const SRobotPresentationPrameters *>(Params);
 
 	if (i_Params != NULL && i_Params->m_OutType == "Measurements") {
+		const SMeasuresDistances &i_Measure = m_Measure[m_Buffer];
 		double *mx, *my, da = m_MaxAngle * 2 / m_Count, angle = PI / 2
 				- m_MaxAngle + da / 2;
 		size_t i;
@@ -213,7 +262,7 @@ void vprobot::robot::CRobotWithScanner::DrawPresentation(
 		*mx = 0;
 		*my = 0;
 		for (i = 0; i < m_Count; i++, angle += da) {
-			double d = m_Measure.Value[i];
+			double d = i_Measure.Value[i];
 
 			if (EqualsZero(d))
 				d = m_MaxLength;
@@ -222,7 +271,7 @@ void vprobot::robot::CRobotWithScanner::DrawPresentation(
 		}
 		Driver.DrawShape(mx, my, m_Count + 1, 0, 0, 0, 0, 242, 242, 242, 255);
 		for (i = 0; i < m_Count; i++) {
-			if (EqualsZero(m_Measure.Value[i]))
+			if (EqualsZero(i_Measure.Value[i]))
 				continue;
 			Driver.DrawCircle(mx[i + 1], my[i + 1], 0.2 * IndicatorZoom, 128,
 					128, 128, 255);
@@ -237,14 +286,16 @@ void vprobot::robot::CRobotWithScanner::DrawPresentation(
 
 /* Произвести измерения */
 const SMeasures &vprobot::robot::CRobotWithScanner::Measure() {
+	profiler::CScopedTimer Timer(profiler::PhaseMeasure);
 	size_t i;
 	double angle = m_State.s_State[2] - m_MaxAngle, da = m_MaxAngle * 2
 			/ m_Count;
 	Point r(m_State.s_State[0], m_State.s_State[1]);
 	normal_distribution<double> nd_dist(0, m_DDist);
 	normal_distribution<double> nd_angle(0, m_DAngle);
-	auto gen_dist = bind(nd_dist, m_Generator);
-	auto gen_angle = bind(nd_angle, m_Generator);
+	auto gen_dist = bind(nd_dist, ref(m_Generator));
+	auto gen_angle = bind(nd_angle, ref(m_Generator));
+	SMeasuresDistances &i_Measure = m_Measure[SwapBuffer()];
 
 	for (i = 0; i < m_Count; i++, angle += da) {
 		double d = m_Map.GetDistance(r, angle + gen_angle());
@@ -253,7 +304,26 @@ const SMeasures &vprobot::robot::CRobotWithScanner::Measure() {
 			d = 0;
 		if (!EqualsZero(d))
 			d += gen_dist();
-		m_Measure.Value[i] = d;
+		i_Measure.Value[i] = d;
 	}
-	return m_Measure;
+	return i_Measure;
+}
+
+/* Последние измерения */
+const SMeasures &vprobot::robot::CRobotWithScanner::LastMeasure() const {
+	return m_Measure[m_Buffer];
+}
+
+/* Записать состояние в контрольную точку */
+void vprobot::robot::CRobotWithScanner::SaveState(
+		vprobot::checkpoint::CWriter &Writer) const {
+	CRobot::SaveState(Writer);
+	Writer.PutMatrix(m_Measure[m_Buffer].Value);
+}
+
+/* Восстановить состояние из контрольной точки */
+bool vprobot::robot::CRobotWithScanner::LoadState(
+		vprobot::checkpoint::CReader &Reader) {
+	return CRobot::LoadState(Reader)
+			&& Reader.GetMatrix(m_Measure[m_Buffer].Value, true);
 }
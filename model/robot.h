@@ -31,6 +31,8 @@
 #include "presentation.h"
 #include "line.h"
 #include "map.h"
+#include "checkpoint.h"
+#include "motion.h"
 
 namespace vprobot {
 
@@ -57,20 +59,6 @@ struct SMeasuresDistances: public SMeasures {
 	Eigen::VectorXd Value;
 };
 
-/* Тип для управления */
-typedef Eigen::Vector2d Control;
-/* Команды */
-enum ControlCommand {
-	Nothing = 0,
-	Forward,
-	ForwardRight,
-	ForwardLeft,
-	Backward,
-	BackwardRight,
-	BackwardLeft,
-	MaxCommand
-};
-
 /* Базовый класс робота */
 class CRobot: public vprobot::presentation::CPresentationProvider {
 private:
@@ -92,8 +80,8 @@ protected:
 
 	/* Состояние робота */
 	SState m_State;
-	/* Радиус поворота */
-	double m_Radius;
+	/* Модель движения */
+	CMotionModel m_Motion;
 	/* Погрешность обратного радиуса */
 	double m_DRadius;
 	/* Длина перемещений */
@@ -102,6 +90,14 @@ protected:
 	double m_DLength;
 	/* Генератор случайных чисел */
 	std::default_random_engine m_Generator;
+	/* Текущий буфер измерений */
+	std::size_t m_Buffer;
+
+	/* Переключить буфер измерений */
+	inline std::size_t SwapBuffer() {
+		m_Buffer ^= 1;
+		return m_Buffer;
+	}
 
 	/* Парсинг параметров для экрана */
 	vprobot::presentation::SPresentationParameters *ParsePresentation(
@@ -118,10 +114,21 @@ public:
 	/* Выполнить команду */
 	void ExecuteCommand(const Control &Command);
 	void ExecuteCommand(const ControlCommand &Command);
-	/* Произвести измерения */
+	/* Произвести измерения
+	 * (результат действителен до повторного вызова через один) */
 	virtual const SMeasures &Measure() = 0;
 	/* Установить текущее состояние */
 	void SetState(const Json::Value &StateObject);
+	/* Задать зерно генератора случайных чисел */
+	void Seed(unsigned int Seed);
+
+	/* Последние измерения */
+	virtual const SMeasures &LastMeasure() const = 0;
+	/* Записать состояние в контрольную точку */
+	virtual void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки
+	 * (false, если точка не подходит к модели) */
+	virtual bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 /* Робот, точно возвращающий позицию */
@@ -129,14 +136,20 @@ class CRobotWithExactPosition: public CRobot {
 private:
 	CRobotWithExactPosition(const CRobotWithExactPosition &Robot) = default;
 
-	/* Измерение*/
-	SMeasuresExactPosition m_Measure;
+	/* Измерения (два буфера) */
+	SMeasuresExactPosition m_Measure[2];
 public:
 	CRobotWithExactPosition(const Json::Value &RobotObject);
 	~CRobotWithExactPosition();
 
 	/* Произвести измерения */
 	const SMeasures &Measure();
+	/* Последние измерения */
+	const SMeasures &LastMeasure() const;
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 /* Робот, возвращающий позицию точек */
@@ -144,21 +157,27 @@ class CRobotWithPointsPosition: public CRobot {
 private:
 	CRobotWithPointsPosition(const CRobotWithPointsPosition &Robot) = default;
 
-	/* Измерение*/
-	SMeasuresPointsPosition m_Measure;
+	/* Измерения (два буфера) */
+	SMeasuresPointsPosition m_Measure[2];
 	/* Храним ссылку на карту */
-	::vprobot::map::CMap &m_Map;
+	const ::vprobot::map::CMap &m_Map;
 	/* Колличество измерений */
 	std::size_t m_Count;
 	/* Погрешность измерения */
 	double m_DDist;
 public:
 	CRobotWithPointsPosition(const Json::Value &RobotObject,
-			::vprobot::map::CMap &Map);
+			const ::vprobot::map::CMap &Map);
 	~CRobotWithPointsPosition();
 
 	/* Произвести измерения */
 	const SMeasures &Measure();
+	/* Последние измерения */
+	const SMeasures &LastMeasure() const;
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 /* Робот, возвращающий расстояния до препятствий */
@@ -172,10 +191,10 @@ private:
 		}
 	};
 
-	/* Измерение*/
-	SMeasuresDistances m_Measure;
+	/* Измерения (два буфера) */
+	SMeasuresDistances m_Measure[2];
 	/* Храним ссылку на карту */
-	::vprobot::map::CMap &m_Map;
+	const ::vprobot::map::CMap &m_Map;
 	/* Колличество измерений */
 	std::size_t m_Count;
 	/* Угол отклонения */
@@ -198,11 +217,17 @@ protected:
 			vprobot::presentation::CPresentationDriver &Driver);
 public:
 	CRobotWithScanner(const Json::Value &RobotObject,
-			::vprobot::map::CMap &Map);
+			const ::vprobot::map::CMap &Map);
 	~CRobotWithScanner();
 
 	/* Произвести измерения */
 	const SMeasures &Measure();
+	/* Последние измерения */
+	const SMeasures &LastMeasure() const;
+	/* Записать состояние в контрольную точку */
+	void SaveState(vprobot::checkpoint::CWriter &Writer) const;
+	/* Восстановить состояние из контрольной точки */
+	bool LoadState(vprobot::checkpoint::CReader &Reader);
 };
 
 }
@@ -23,6 +23,8 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
+#include <string>
 #include <json/json.h>
 #include "presentation.h"
 
@@ -40,6 +42,17 @@ public:
 
 	/* Выполнить симуляцию */
 	virtual void Simulate() = 0;
+	/* Сохранить контрольную точку (false, если сцена не поддерживает) */
+	virtual bool SaveCheckpoint(const std::string &Name) {
+		return false;
+	}
+	/* Продолжить симуляцию с контрольной точки */
+	virtual bool LoadCheckpoint(const std::string &Name) {
+		return false;
+	}
+	/* Сохранять контрольную точку каждые Interval шагов */
+	virtual void SetCheckpoint(const std::string &Name, std::size_t Interval) {
+	}
 };
 
 }
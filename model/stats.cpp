@@ -0,0 +1,262 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "stats.h"
+
+#include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace ::std;
+using namespace ::vprobot::stats;
+
+namespace {
+
+/* Размер буфера по умолчанию */
+const size_t DefaultCapacity = 4096;
+
+/* Текущий приемник */
+atomic<CStatsSink *> Sink(NULL);
+
+/* Счетчик экземпляров планировщиков */
+atomic<size_t> Instances(0);
+
+/* Число для вывода: нечисловые значения заменяются на Empty */
+struct SNumber {
+	double s_Value;
+	const char *s_Empty;
+};
+
+ostream &operator<<(ostream &Out, const SNumber &Number) {
+	if (isfinite(Number.s_Value))
+		Out << Number.s_Value;
+	else
+		Out << Number.s_Empty;
+	return Out;
+}
+
+/* Значение JSON (null, если не число) */
+inline SNumber JSONNumber(double Value) {
+	SNumber Number = {Value, "null"};
+
+	return Number;
+}
+
+/* Значение CSV (пустое поле, если не число) */
+inline SNumber CSVNumber(double Value) {
+	SNumber Number = {Value, ""};
+
+	return Number;
+}
+
+}
+
+/* CStatsSink */
+
+vprobot::stats::CStatsSink::CStatsSink(const Json::Value &StatsObject) :
+		m_Buffer(), m_Head(0), m_Count(0), m_Dropped(0), m_Batch(), m_File(), m_Format(
+				FormatJSONLines), m_Console(false), m_Lock(), m_Cond(), m_Stop(
+				false), m_Writer() {
+	size_t Capacity = StatsObject.get("capacity",
+			static_cast<Json::UInt>(DefaultCapacity)).asUInt();
+	string Name = StatsObject["file"].asString();
+
+	if (Capacity == 0)
+		Capacity = DefaultCapacity;
+	m_Buffer.assign(Capacity, SStepStats("", 0, 0));
+	m_Batch.reserve(Capacity);
+	m_Console = StatsObject["console"].asBool();
+	if (StatsObject["format"].asString() == "csv")
+		m_Format = FormatCSV;
+	if (!Name.empty()) {
+		m_File.open(Name.c_str(), ios::out | ios::trunc);
+		if (!m_File)
+			clog << "Couldn't open stats file " << Name << endl;
+		else if (m_Format == FormatCSV)
+			m_File << "planner,instance,step,playouts,tree_size,best_depth,"
+					"best_visits,initial_y,mean_y,best_y,expected_diff,"
+					"mean_time,command,wall_ms,finished" << endl;
+	}
+	m_Writer = thread(&CStatsSink::WriterProcess, this);
+}
+
+vprobot::stats::CStatsSink::~CStatsSink() {
+	Finish();
+}
+
+/* Добавить показатели (false, если буфер переполнен) */
+bool vprobot::stats::CStatsSink::Push(const SStepStats &Stats) {
+	lock_guard<mutex> Guard(m_Lock);
+
+	if (m_Count == m_Buffer.size()) {
+		m_Dropped++;
+		return false;
+	}
+	m_Buffer[(m_Head + m_Count) % m_Buffer.size()] = Stats;
+	m_Count++;
+	/* Поток записи будится заранее, чтобы буфер не переполнялся */
+	if (m_Count == m_Buffer.size() / 2)
+		m_Cond.notify_one();
+	return true;
+}
+
+/* Остановить поток записи и дописать оставшееся */
+void vprobot::stats::CStatsSink::Finish() {
+	{
+		lock_guard<mutex> Guard(m_Lock);
+
+		if (m_Stop)
+			return;
+		m_Stop = true;
+	}
+	m_Cond.notify_one();
+	m_Writer.join();
+	WriteBatch();
+	if (m_Dropped != 0)
+		clog << "Stats buffer overflow: " << m_Dropped << " records dropped"
+				<< endl;
+	m_File.close();
+}
+
+/* Забрать показатели из буфера и записать */
+void vprobot::stats::CStatsSink::WriteBatch() {
+	ostringstream Out, Console;
+
+	{
+		lock_guard<mutex> Guard(m_Lock);
+
+		m_Batch.clear();
+		for (; m_Count > 0; m_Count--) {
+			m_Batch.push_back(m_Buffer[m_Head]);
+			m_Head = (m_Head + 1) % m_Buffer.size();
+		}
+	}
+	if (m_Batch.empty())
+		return;
+	for (auto &s : m_Batch) {
+		if (m_File.is_open()) {
+			if (m_Format == FormatCSV)
+				WriteCSV(Out, s);
+			else
+				WriteJSON(Out, s);
+		}
+		if (m_Console)
+			WriteConsole(Console, s);
+	}
+	if (m_File.is_open()) {
+		m_File << Out.str();
+		m_File.flush();
+	}
+	if (m_Console)
+		cout << Console.str() << flush;
+}
+
+/* Функция потока записи */
+void vprobot::stats::CStatsSink::WriterProcess() {
+	unique_lock<mutex> Lock(m_Lock);
+
+	while (!m_Stop) {
+		m_Cond.wait_for(Lock, chrono::milliseconds(100));
+		Lock.unlock();
+		WriteBatch();
+		Lock.lock();
+	}
+}
+
+/* Записать показатели */
+void vprobot::stats::CStatsSink::WriteJSON(ostream &Out,
+		const SStepStats &Stats) const {
+	Out << "{\"planner\":\"" << Stats.s_Planner << "\",\"instance\":"
+			<< Stats.s_Instance << ",\"step\":" << Stats.s_Step
+			<< ",\"playouts\":" << Stats.s_Playouts << ",\"tree_size\":"
+			<< Stats.s_TreeSize << ",\"best_depth\":" << Stats.s_BestDepth
+			<< ",\"best_visits\":" << Stats.s_BestVisits << ",\"initial_y\":"
+			<< JSONNumber(Stats.s_InitialY) << ",\"mean_y\":"
+			<< JSONNumber(Stats.s_MeanY) << ",\"best_y\":"
+			<< JSONNumber(Stats.s_BestY) << ",\"expected_diff\":"
+			<< JSONNumber(Stats.s_ExpectedDiff) << ",\"mean_time\":"
+			<< JSONNumber(Stats.s_MeanTime) << ",\"command\":"
+			<< Stats.s_Command << ",\"wall_ms\":"
+			<< JSONNumber(Stats.s_WallTime) << ",\"finished\":"
+			<< (Stats.s_Finished ? "true" : "false") << "}\n";
+}
+
+void vprobot::stats::CStatsSink::WriteCSV(ostream &Out,
+		const SStepStats &Stats) const {
+	Out << Stats.s_Planner << ',' << Stats.s_Instance << ',' << Stats.s_Step
+			<< ',' << Stats.s_Playouts << ',' << Stats.s_TreeSize << ','
+			<< Stats.s_BestDepth << ',' << Stats.s_BestVisits << ','
+			<< CSVNumber(Stats.s_InitialY) << ',' << CSVNumber(Stats.s_MeanY)
+			<< ',' << CSVNumber(Stats.s_BestY) << ','
+			<< CSVNumber(Stats.s_ExpectedDiff) << ','
+			<< CSVNumber(Stats.s_MeanTime) << ',' << Stats.s_Command << ','
+			<< CSVNumber(Stats.s_WallTime) << ',' << Stats.s_Finished << '\n';
+}
+
+void vprobot::stats::CStatsSink::WriteConsole(ostream &Out,
+		const SStepStats &Stats) const {
+	Out << Stats.s_Planner << '#' << Stats.s_Instance << " step "
+			<< Stats.s_Step << ": playouts " << Stats.s_Playouts << ", tree "
+			<< Stats.s_TreeSize << ", depth " << Stats.s_BestDepth
+			<< ", initial Y " << Stats.s_InitialY << ", mean Y "
+			<< Stats.s_MeanY << ", diff " << Stats.s_ExpectedDiff << ", "
+			<< fixed << setprecision(3) << Stats.s_WallTime << " ms"
+			<< defaultfloat << setprecision(6)
+			<< (Stats.s_Finished ? " (done)" : "") << '\n';
+}
+
+/* Создать приемник по параметрам (пустые параметры - показатели не пишутся) */
+void vprobot::stats::Configure(const Json::Value &StatsObject) {
+	static bool Installed = false;
+
+	Finish();
+	if (!StatsObject.isObject())
+		return;
+	Sink.store(new CStatsSink(StatsObject));
+	if (!Installed) {
+		atexit(Finish);
+		Installed = true;
+	}
+}
+
+/* Записать показатели, если приемник создан */
+void vprobot::stats::Record(const SStepStats &Stats) {
+	CStatsSink *s = Sink.load(memory_order_acquire);
+
+	if (s != NULL)
+		s->Push(Stats);
+}
+
+/* Дописать показатели и закрыть приемник */
+void vprobot::stats::Finish() {
+	CStatsSink *s = Sink.exchange(NULL);
+
+	/* Приемник не удаляется: планировщик может еще держать указатель */
+	if (s != NULL)
+		s->Finish();
+}
+
+/* Номер для нового экземпляра планировщика */
+size_t vprobot::stats::NewInstance() {
+	return Instances.fetch_add(1);
+}
@@ -0,0 +1,153 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STATS_H_
+#define __STATS_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <fstream>
+#include <ostream>
+#include <json/json.h>
+
+namespace vprobot {
+
+namespace stats {
+
+/* Показатели одного шага планировщика */
+struct SStepStats {
+	/* Тип планировщика и номер экземпляра */
+	const char *s_Planner;
+	std::size_t s_Instance;
+	/* Номер шага */
+	std::uint64_t s_Step;
+	/* Количество симуляций и узлов дерева */
+	std::size_t s_Playouts;
+	std::size_t s_TreeSize;
+	/* Глубина и посещения лучшего узла */
+	int s_BestDepth;
+	std::size_t s_BestVisits;
+	/* Оценка карты до шага, средняя и лучшая ожидаемые */
+	double s_InitialY;
+	double s_MeanY;
+	double s_BestY;
+	/* Ожидаемое изменение (критерий окончания) */
+	double s_ExpectedDiff;
+	/* Среднее время до окончания в симуляциях */
+	double s_MeanTime;
+	/* Выбранная команда (-1, если нет) */
+	int s_Command;
+	/* Время планирования в миллисекундах */
+	double s_WallTime;
+	/* Сработал критерий окончания */
+	bool s_Finished;
+
+	SStepStats(const char *Planner, std::size_t Instance, std::uint64_t Step) :
+			s_Planner(Planner), s_Instance(Instance), s_Step(Step), s_Playouts(
+					0), s_TreeSize(0), s_BestDepth(0), s_BestVisits(0), s_InitialY(
+					0), s_MeanY(0), s_BestY(0), s_ExpectedDiff(0), s_MeanTime(0), s_Command(
+					-1), s_WallTime(0), s_Finished(false) {
+	}
+};
+
+/* Приемник показателей: кольцевой буфер и поток записи в файл */
+class CStatsSink {
+public:
+	/* Формат файла */
+	enum Format {
+		FormatJSONLines,
+		FormatCSV
+	};
+private:
+	/* Кольцевой буфер (память выделяется один раз) */
+	std::vector<SStepStats> m_Buffer;
+	std::size_t m_Head;
+	std::size_t m_Count;
+	/* Показатели, не поместившиеся в буфер */
+	std::size_t m_Dropped;
+	/* Забранные потоком записи показатели */
+	std::vector<SStepStats> m_Batch;
+
+	/* Вывод */
+	std::ofstream m_File;
+	Format m_Format;
+	bool m_Console;
+
+	/* Поток записи */
+	std::mutex m_Lock;
+	std::condition_variable m_Cond;
+	bool m_Stop;
+	std::thread m_Writer;
+
+	/* Забрать показатели из буфера и записать */
+	void WriteBatch();
+	/* Функция потока записи */
+	void WriterProcess();
+	/* Записать показатели */
+	void WriteJSON(std::ostream &Out, const SStepStats &Stats) const;
+	void WriteCSV(std::ostream &Out, const SStepStats &Stats) const;
+	void WriteConsole(std::ostream &Out, const SStepStats &Stats) const;
+
+	CStatsSink(const CStatsSink &Sink) = default;
+public:
+	CStatsSink(const Json::Value &StatsObject);
+	~CStatsSink();
+
+	/* Добавить показатели (false, если буфер переполнен) */
+	bool Push(const SStepStats &Stats);
+	/* Остановить поток записи и дописать оставшееся */
+	void Finish();
+};
+
+/* Создать приемник по параметрам (пустые параметры - показатели не пишутся) */
+void Configure(const Json::Value &StatsObject);
+/* Записать показатели, если приемник создан */
+void Record(const SStepStats &Stats);
+/* Дописать показатели и закрыть приемник */
+void Finish();
+/* Номер для нового экземпляра планировщика */
+std::size_t NewInstance();
+
+/* Замер времени планирования в миллисекундах */
+class CStopwatch {
+private:
+	std::chrono::steady_clock::time_point m_Start;
+public:
+	inline CStopwatch() :
+			m_Start(std::chrono::steady_clock::now()) {
+	}
+	inline double Elapsed() const {
+		return std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - m_Start).count();
+	}
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <json/json.h>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include "model/record.h"
+#include "ui/ui.h"
+
+using namespace ::std;
+using namespace ::vprobot;
+using namespace ::vprobot::presentation;
+using namespace ::vprobot::ui;
+
+/* Прочитать параметры вывода из файла модели */
+bool ParsePresentation(const char *in_file, Json::Value &Presentation) {
+	std::ifstream inp(in_file);
+	std::stringstream json;
+
+	if (inp.fail()) {
+		clog << strerror(errno) << endl;
+		return false;
+	}
+	json << inp.rdbuf();
+
+	Json::Reader reader;
+	Json::Value root;
+
+	if (!reader.parse(json.str(), root))
+		return false;
+	Presentation = root["presentation"];
+	return true;
+}
+
+int Replay(const char *in_file, const char *model_file) {
+	CRecording Recording;
+	Json::Value Presentation;
+
+	if (!Recording.Open(in_file)) {
+		clog << "Couldn't read record " << in_file << endl;
+		return EXIT_FAILURE;
+	}
+	if (model_file != NULL) {
+		if (!ParsePresentation(model_file, Presentation))
+			return EXIT_FAILURE;
+	} else {
+		Presentation = Recording.GetPresentation();
+	}
+	/* Запись отображена в память и не должна перезаписываться,
+	 * при воспроизведении новая запись не ведется */
+	Presentation.removeMember("record");
+	clog << "Frames: " << Recording.GetFrameCount() << endl;
+
+	CUI UI(Recording, Presentation);
+
+	UI.Process([&] {Recording.Step();});
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		cerr << "Usage: " << argv[0] << " record_file [model_file]" << endl;
+		return EXIT_FAILURE;
+	}
+	return Replay(argv[1], argc > 2 ? argv[2] : NULL);
+}
@@ -0,0 +1,449 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* Микробенчмарки основных вычислительных функций (make bench) */
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <json/json.h>
+#include "../model/line.h"
+#include "../model/map.h"
+#include "../model/robot.h"
+#include "../model/localization/ekf.h"
+#include "../model/mapping/grid.h"
+#include "../model/ai/mcts-ai.h"
+#include "../types.h"
+
+using namespace ::std;
+using namespace ::vprobot;
+using namespace ::vprobot::line;
+using namespace ::vprobot::robot;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+/* Минимальное время одного замера в секундах */
+double MinTime = 0.2;
+/* Выполнять только замеры, имя которых содержит фильтр */
+const char *Filter = NULL;
+/* Результат, который не дает компилятору выбросить вычисления */
+volatile double Sink = 0;
+
+/* Размер стороны синтетической карты */
+const double MapSize = 40;
+
+/* Пакет из Count операций, возвращает время в наносекундах */
+typedef function<double(size_t Count)> BatchFunction;
+
+/* Время от начала замера в наносекундах */
+inline double Elapsed(Clock::time_point Start) {
+	return chrono::duration<double, nano>(Clock::now() - Start).count();
+}
+
+/* Подобрать число операций и вывести лучший из трех замеров
+ * (Units - количество единиц работы в одной операции) */
+void RunBatch(const char *Name, const string &Param, double Units,
+		const char *Unit, const BatchFunction &Batch) {
+	if (Filter != NULL && strstr(Name, Filter) == NULL)
+		return;
+
+	size_t Count = 1, i;
+	double Time = Batch(Count), Best;
+
+	while (Time < MinTime * 1e9) {
+		/* Растем не более чем в 10 раз, чтобы не промахнуться */
+		double Scale = Time > 0 ? MinTime * 1e9 * 1.2 / Time : 10;
+
+		Count = static_cast<size_t>(Count * std::min(std::max(Scale, 1.5), 10.0));
+		Time = Batch(Count);
+	}
+	Best = Time / Count;
+	for (i = 0; i < 2; i++)
+		Best = std::min(Best, Batch(Count) / Count);
+	cout << setw(16) << left << Name << setw(14) << Param << right << setw(14)
+			<< fixed << setprecision(1) << Best << " ns/op" << setw(16)
+			<< setprecision(0) << Units * 1e9 / Best << " " << Unit << "/s"
+			<< endl;
+}
+
+/* Замер одиночной операции */
+void Run(const char *Name, const string &Param, double Units, const char *Unit,
+		const function<void()> &Op) {
+	RunBatch(Name, Param, Units, Unit, [&](size_t Count) {
+		Clock::time_point Start = Clock::now();
+		size_t i;
+
+		for (i = 0; i < Count; i++)
+			Op();
+		return Elapsed(Start);
+	});
+}
+
+/* Точка в формате карты */
+Json::Value JsonPoint(double x, double y) {
+	Json::Value p;
+
+	p["x"] = x;
+	p["y"] = y;
+	return p;
+}
+
+/* Карта из рамки и Segments - 1 случайных отрезков */
+Json::Value LineMapObject(size_t Segments) {
+	default_random_engine Generator(1);
+	uniform_real_distribution<double> Position(1, MapSize - 1), Offset(-1, 1);
+	Json::Value Map, Lines(Json::arrayValue), Border(Json::arrayValue);
+	size_t i;
+
+	Border.append(JsonPoint(0, 0));
+	Border.append(JsonPoint(MapSize, 0));
+	Border.append(JsonPoint(MapSize, MapSize));
+	Border.append(JsonPoint(0, MapSize));
+	Lines.append(Border);
+	for (i = 1; i < Segments; i++) {
+		Json::Value Segment(Json::arrayValue);
+		double x = Position(Generator), y = Position(Generator);
+
+		Segment.append(JsonPoint(x, y));
+		Segment.append(JsonPoint(x + Offset(Generator), y + Offset(Generator)));
+		Lines.append(Segment);
+	}
+	Map["lines"] = Lines;
+	return Map;
+}
+
+/* Карта из Count маяков */
+Json::Value PointMapObject(size_t Count) {
+	default_random_engine Generator(2);
+	uniform_real_distribution<double> Position(0, MapSize);
+	Json::Value Map, Points(Json::arrayValue);
+	size_t i;
+
+	for (i = 0; i < Count; i++)
+		Points.append(JsonPoint(Position(Generator), Position(Generator)));
+	Map["points"] = Points;
+	return Map;
+}
+
+/* Сетка с теми же отрезками, что и LineMapObject(Segments) */
+Json::Value GridMapObject(size_t Segments, double Resolution, size_t Block) {
+	const Json::Value Lines = LineMapObject(Segments)["lines"];
+	size_t Size = static_cast<size_t>(MapSize / Resolution) + 1, k;
+	vector<string> Rows(Size, string(Size, '.'));
+	Json::Value Map;
+	Json::ArrayIndex i, j;
+
+	for (i = 0; i < Lines.size(); i++)
+		for (j = 0; j < Lines[i].size(); j++) {
+			const Json::Value &a = Lines[i][j], &b = Lines[i][(j + 1)
+					% Lines[i].size()];
+			double ax = a["x"].asDouble(), ay = a["y"].asDouble(), bx =
+					b["x"].asDouble(), by = b["y"].asDouble();
+			size_t n = static_cast<size_t>(hypot(bx - ax, by - ay) * 2
+					/ Resolution) + 1;
+
+			for (k = 0; k <= n; k++) {
+				size_t x = (ax + (bx - ax) * k / n) / Resolution, y = (ay
+						+ (by - ay) * k / n) / Resolution;
+
+				Rows[Size - 1 - y][x] = '#';
+			}
+		}
+	for (auto &r : Rows)
+		Map["rows"].append(r);
+	Map["resolution"] = Resolution;
+	Map["block"] = static_cast<Json::UInt>(Block);
+	return Map;
+}
+
+/* Параметры робота */
+Json::Value RobotObject(size_t Beams, size_t Points) {
+	Json::Value Robot;
+
+	Robot["radius"] = 3;
+	Robot["dradius"] = 0.1;
+	Robot["len"] = 0.5;
+	Robot["dlen"] = 0.05;
+	Robot["measures_count"] = static_cast<Json::UInt>(Beams);
+	Robot["points_count"] = static_cast<Json::UInt>(Points);
+	Robot["max_angle"] = 1.5;
+	Robot["max_length"] = 10;
+	Robot["ddist"] = 0.1;
+	Robot["dangle"] = 0.01;
+	return Robot;
+}
+
+/* Начальное состояние робота в центре карты */
+Json::Value StateObject() {
+	Json::Value State = JsonPoint(MapSize / 2, MapSize / 2);
+
+	State["angle"] = 0.3;
+	State["dx"] = 0.1;
+	State["dy"] = 0.1;
+	State["dangle"] = 0.05;
+	return State;
+}
+
+/* Параметры системы управления для одного робота */
+Json::Value ControlSystemObject(size_t Cells, const Json::Value &MapObject) {
+	Json::Value cs = RobotObject(0, 0);
+
+	cs["count"] = 1;
+	cs["commands"] = Json::Value(Json::arrayValue);
+	cs["robot_params"].append(StateObject());
+	cs["points"] = MapObject["points"];
+	cs["prob_occ"] = 0.7;
+	cs["prob_free"] = 0.3;
+	cs["map_width"] = MapSize;
+	cs["map_height"] = MapSize;
+	cs["num_width"] = static_cast<Json::UInt>(Cells);
+	cs["num_height"] = static_cast<Json::UInt>(Cells);
+	cs["start_x"] = 0;
+	cs["start_y"] = 0;
+	cs["robot_width"] = 0.5;
+	cs["robot_height"] = 0.5;
+	cs["end_c"] = 0;
+	cs["select_c"] = 0.5;
+	cs["add_moves"] = 3;
+	cs["limit_moves"] = 20;
+	cs["num_simulations"] = 32;
+	cs["seed"] = 1;
+	return cs;
+}
+
+/* Случайные лучи внутри карты */
+struct SRay {
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	Point s_Point;
+	double s_Angle;
+};
+typedef vector<SRay, Eigen::aligned_allocator<SRay>> RaySet;
+
+const size_t RayCount = 1024;
+
+RaySet Rays() {
+	default_random_engine Generator(3);
+	uniform_real_distribution<double> Position(0, MapSize), Angle(-PI, PI);
+	RaySet r(RayCount);
+
+	for (auto &i : r) {
+		i.s_Point = Point(Position(Generator), Position(Generator));
+		i.s_Angle = Angle(Generator);
+	}
+	return r;
+}
+
+/* Последнее измерение сканера */
+inline const SMeasuresDistances &Scan(CRobot &Robot) {
+	return static_cast<const SMeasuresDistances &>(Robot.Measure());
+}
+
+/* line::Measure для одного отрезка */
+void BenchLineMeasure() {
+	const RaySet r = Rays();
+	const Point a(10, 10), b(30, 12);
+	size_t k = 0;
+
+	Run("line_measure", "segment", 1, "rays", [&]() {
+		const SRay &i = r[k++ % RayCount];
+
+		Sink = Sink + Measure(a - i.s_Point, b - i.s_Point, i.s_Angle);
+	});
+}
+
+/* CLineMap::GetDistance на картах разного размера */
+void BenchMapDistance() {
+	static const size_t Sizes[] = {100, 1000, 10000, 100000};
+	const RaySet r = Rays();
+
+	for (auto s : Sizes) {
+		vprobot::map::CLineMap Map(LineMapObject(s));
+		size_t k = 0;
+
+		Run("map_distance", to_string(s) + " seg", s, "segments", [&]() {
+			const SRay &i = r[k++ % RayCount];
+
+			Sink = Sink + Map.GetDistance(i.s_Point, i.s_Angle);
+		});
+	}
+}
+
+/* CGridMap::GetDistance с пропуском пустых блоков и без */
+void BenchGridDistance() {
+	static const size_t Sizes[] = {100, 10000, 100000};
+	static const size_t Blocks[] = {0, 8};
+	const RaySet r = Rays();
+
+	for (auto s : Sizes)
+		for (auto b : Blocks) {
+			vprobot::map::CGridMap Map(GridMapObject(s, 0.05, b));
+			size_t k = 0;
+
+			Run("grid_distance",
+					to_string(s) + " seg, block " + to_string(b), 1, "rays",
+					[&]() {
+						const SRay &i = r[k++ % RayCount];
+
+						Sink = Sink + Map.GetDistance(i.s_Point, i.s_Angle);
+					});
+		}
+}
+
+/* Полный скан робота со сканером */
+void BenchScan() {
+	static const size_t Sizes[] = {100, 1000, 10000};
+	const size_t Beams = 360;
+
+	for (auto s : Sizes) {
+		vprobot::map::CLineMap Map(LineMapObject(s));
+		CRobotWithScanner Robot(RobotObject(Beams, 0), Map);
+
+		Robot.SetState(StateObject());
+		Robot.Seed(1);
+		Run("robot_scan", to_string(s) + " seg", Beams, "beams", [&]() {
+			Sink = Sink + Scan(Robot).Value[0];
+		});
+	}
+}
+
+/* Выполнение команды роботом */
+void BenchExecuteCommand() {
+	static const ControlCommand Commands[] = {Forward, ForwardLeft, Backward,
+			BackwardRight};
+	CRobotWithExactPosition Robot(RobotObject(0, 0));
+	size_t k = 0;
+
+	Robot.SetState(StateObject());
+	Robot.Seed(1);
+	Run("robot_execute", "command", 1, "commands", [&]() {
+		Robot.ExecuteCommand(Commands[k++ & 3]);
+	});
+}
+
+/* Обновление EKF по измерениям расстояний до маяков */
+void BenchEKF() {
+	static const size_t Sizes[] = {10, 100, 1000};
+
+	for (auto s : Sizes) {
+		Json::Value MapObject = PointMapObject(s);
+		vprobot::map::CPointMap Map(MapObject);
+		CRobotWithPointsPosition Robot(RobotObject(0, s), Map);
+		control::localization::CEKFLocalization EKF(
+				ControlSystemObject(0, MapObject));
+		const SMeasures *Measures[1];
+
+		Robot.SetState(StateObject());
+		Robot.Seed(1);
+		Measures[0] = &Robot.Measure();
+		Run("ekf_update", to_string(s) + " pts", s, "beacons", [&]() {
+			EKF.GetCommands(Measures);
+		});
+	}
+}
+
+/* Учет скана в сетке занятости */
+void BenchScanIntegration() {
+	static const size_t Sizes[] = {64, 256, 1024};
+	vprobot::map::CLineMap Map(LineMapObject(1000));
+	CRobotWithScanner Robot(RobotObject(360, 0), Map);
+	const SMeasures *Measures[1];
+
+	Robot.SetState(StateObject());
+	Robot.Seed(1);
+	Measures[0] = &Robot.Measure();
+	for (auto s : Sizes) {
+		control::mapping::CGridMapper Mapper(
+				ControlSystemObject(s, Json::Value()));
+
+		Run("scan_integrate", to_string(s) + "^2", s * s, "cells", [&]() {
+			Mapper.GetCommands(Measures);
+		});
+	}
+}
+
+/* Шаг MCTS: учет скана, выборка, случайные симуляции (GenerateSample,
+ * GoAround, GoLinear) и обратное распространение */
+void BenchMCTS() {
+	static const size_t Sizes[] = {64, 256, 1024};
+	vprobot::map::CLineMap Map(LineMapObject(1000));
+	CRobotWithScanner Robot(RobotObject(360, 0), Map);
+	const SMeasures *Measures[1];
+
+	Robot.SetState(StateObject());
+	Robot.Seed(1);
+	Measures[0] = &Robot.Measure();
+	for (auto s : Sizes) {
+		Json::Value cs = ControlSystemObject(s, Json::Value());
+		size_t Simulations = cs["num_simulations"].asUInt() - 1;
+
+		/* Планировщик двигает свою оценку положения, поэтому каждый пакет
+		 * начинается с нового планировщика (создание не замеряется) */
+		RunBatch("mcts_step", to_string(s) + "^2", Simulations, "playouts",
+				[&](size_t Count) {
+					double Time = 0;
+					size_t i;
+
+					for (i = 0; i < Count; i++) {
+						control::mcts_ai::CMCTSAI Planner(cs);
+						Clock::time_point Start = Clock::now();
+
+						Planner.GetCommands(Measures);
+						Time += Elapsed(Start);
+					}
+					return Time;
+				});
+	}
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			MinTime = atof(argv[++i]);
+		else if (argv[i][0] != '-')
+			Filter = argv[i];
+		else {
+			cerr << "Usage: " << argv[0] << " [-t seconds] [filter]" << endl;
+			return EXIT_FAILURE;
+		}
+	}
+	BenchLineMeasure();
+	BenchMapDistance();
+	BenchGridDistance();
+	BenchScan();
+	BenchExecuteCommand();
+	BenchEKF();
+	BenchScanIntegration();
+	BenchMCTS();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,280 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* Прогон сцен из набора с замером скорости и сравнением с базовыми
+ * значениями (make bench-scenes, bench-baseline, bench-check) */
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <exception>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <json/json.h>
+#include "../model/scene.h"
+#include "../model/parser.h"
+
+using namespace ::std;
+using namespace ::vprobot;
+using namespace ::vprobot::scene;
+using namespace ::vprobot::presentation;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+/* Короткие сцены повторяются, пока общее время меньше MinTime секунд */
+double MinTime = 0.5;
+
+/* Результат прогона сцены */
+struct SResult {
+	string s_Name;
+	size_t s_Steps;
+	double s_StepsPerSecond;
+	/* Задержка шага в миллисекундах */
+	double s_P50;
+	double s_P90;
+	double s_P99;
+	double s_Max;
+};
+
+/* Прочитать JSON из файла */
+bool ReadJson(const char *Name, Json::Value &Root) {
+	ifstream inp(Name);
+	stringstream json;
+	Json::Reader reader;
+
+	if (inp.fail()) {
+		clog << Name << ": " << strerror(errno) << endl;
+		return false;
+	}
+	json << inp.rdbuf();
+	if (!reader.parse(json.str(), Root)) {
+		clog << Name << ": " << reader.getFormattedErrorMessages();
+		return false;
+	}
+	return true;
+}
+
+/* Имя сцены по имени файла */
+string SceneName(const string &File) {
+	size_t Begin = File.find_last_of('/'), End;
+
+	Begin = Begin == string::npos ? 0 : Begin + 1;
+	End = File.rfind(".json");
+	if (End == string::npos || End < Begin)
+		End = File.size();
+	return File.substr(Begin, End - Begin);
+}
+
+/* Перцентиль отсортированного массива */
+double Percentile(const vector<double> &Sorted, double p) {
+	size_t i = static_cast<size_t>(p * (Sorted.size() - 1) + 0.5);
+
+	return Sorted[i];
+}
+
+/* Прогнать сцену "steps" шагов, добавить задержки шагов в Latency
+ * (возвращает время прогона в секундах, отрицательное при ошибке) */
+double RunOnce(const Json::Value &Root, vector<double> &Latency) {
+	CScene *oScene = Scene(Root["scene"]);
+
+	if (oScene == NULL)
+		return -1;
+
+	size_t Steps = Root.get("steps", 100).asUInt(), i;
+	Clock::time_point Start = Clock::now();
+
+	for (i = 0; i < Steps; i++) {
+		Clock::time_point StepStart = Clock::now();
+
+		/* Шаг - выполнение команд, измерения и планирование */
+		do {
+			oScene->Simulate();
+		} while (oScene->GetSimlationState()
+				== CPresentationHandler::SimulationWorking);
+		Latency.push_back(
+				chrono::duration<double, milli>(Clock::now() - StepStart).count());
+		if (oScene->GetSimlationState() == CPresentationHandler::SimulationEnd)
+			break;
+	}
+
+	double Time = chrono::duration<double>(Clock::now() - Start).count();
+
+	/* Удаление сцены не входит в замер */
+	delete oScene;
+	return Time;
+}
+
+/* Прогнать сцену из файла */
+bool RunScene(const char *File, SResult &Result) {
+	Json::Value Root;
+	vector<double> Latency;
+	double Total = 0;
+
+	if (!ReadJson(File, Root))
+		return false;
+	do {
+		double Time = RunOnce(Root, Latency);
+
+		if (Time < 0) {
+			clog << File << ": couldn't create scene" << endl;
+			return false;
+		}
+		Total += Time;
+	} while (Total < MinTime);
+	sort(Latency.begin(), Latency.end());
+	Result.s_Name = SceneName(File);
+	Result.s_Steps = Latency.size();
+	Result.s_StepsPerSecond = Latency.size() / Total;
+	Result.s_P50 = Percentile(Latency, 0.5);
+	Result.s_P90 = Percentile(Latency, 0.9);
+	Result.s_P99 = Percentile(Latency, 0.99);
+	Result.s_Max = Latency.back();
+	return true;
+}
+
+/* Записать базовые значения */
+bool WriteBaseline(const char *File, const vector<SResult> &Results) {
+	Json::Value Root, &Scenes = Root["scenes"];
+	ofstream Out(File, ios::out | ios::trunc);
+
+	if (!Out) {
+		clog << File << ": " << strerror(errno) << endl;
+		return false;
+	}
+	for (auto &r : Results) {
+		Json::Value &s = Scenes[r.s_Name];
+
+		s["steps"] = static_cast<Json::UInt>(r.s_Steps);
+		s["steps_per_second"] = r.s_StepsPerSecond;
+		s["p50_ms"] = r.s_P50;
+		s["p90_ms"] = r.s_P90;
+		s["p99_ms"] = r.s_P99;
+	}
+	Out << Root;
+	return true;
+}
+
+/* Сравнить с базовыми значениями (false, если есть замедление) */
+bool CheckBaseline(const char *File, const vector<SResult> &Results,
+		double Tolerance) {
+	Json::Value Root;
+	bool Passed = true;
+
+	if (!ReadJson(File, Root))
+		return false;
+
+	const Json::Value &Scenes = Root["scenes"];
+
+	cout << endl << "Baseline " << File << ":" << endl;
+	for (auto &r : Results) {
+		if (!Scenes.isMember(r.s_Name)) {
+			cout << setw(20) << left << r.s_Name << right << "     no baseline"
+					<< endl;
+			continue;
+		}
+
+		double Base = Scenes[r.s_Name]["steps_per_second"].asDouble();
+		double Ratio = r.s_StepsPerSecond / Base;
+		bool Slower = Ratio < 1 - Tolerance;
+
+		cout << setw(20) << left << r.s_Name << right << setw(12) << fixed
+				<< setprecision(2) << Base << " -> " << setw(10)
+				<< r.s_StepsPerSecond << " steps/s" << setw(9) << showpos
+				<< (Ratio - 1) * 100 << noshowpos << "%"
+				<< (Slower ? "  REGRESSION" : "") << endl;
+		if (Slower)
+			Passed = false;
+	}
+	return Passed;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	const char *Baseline = NULL, *Output = NULL;
+	double Tolerance = 0.25;
+	vector<SResult> Results;
+	bool Failed = false;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+			Baseline = argv[++i];
+		else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+			Output = argv[++i];
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			Tolerance = atof(argv[++i]);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			MinTime = atof(argv[++i]);
+		else if (argv[i][0] == '-') {
+			Failed = true;
+			break;
+		} else
+			break;
+	}
+	if (Failed || i == argc) {
+		cerr << "Usage: " << argv[0]
+				<< " [-b baseline] [-w baseline] [-r tolerance] [-t seconds]"
+				<< " scene_file..."
+				<< endl;
+		return EXIT_FAILURE;
+	}
+	cout << setw(20) << left << "scene" << right << setw(8) << "steps"
+			<< setw(12) << "steps/s" << setw(10) << "p50 ms" << setw(10)
+			<< "p90 ms" << setw(10) << "p99 ms" << setw(10) << "max ms"
+			<< endl;
+	for (; i < argc; i++) {
+		SResult r;
+		bool Passed;
+
+		try {
+			Passed = RunScene(argv[i], r);
+		} catch (const exception &e) {
+			clog << argv[i] << ": " << e.what() << endl;
+			Passed = false;
+		}
+		if (!Passed) {
+			Failed = true;
+			continue;
+		}
+		cout << setw(20) << left << r.s_Name << right << setw(8) << r.s_Steps
+				<< setw(12) << fixed << setprecision(2) << r.s_StepsPerSecond
+				<< setw(10) << r.s_P50 << setw(10) << r.s_P90 << setw(10)
+				<< r.s_P99 << setw(10) << r.s_Max << endl;
+		Results.push_back(r);
+		/* Файл переписывается после каждой сцены, чтобы падение на
+		 * следующей не теряло уже полученные значения */
+		if (Output != NULL && !WriteBaseline(Output, Results)) {
+			Output = NULL;
+			Failed = true;
+		}
+	}
+	if (Baseline != NULL && !CheckBaseline(Baseline, Results, Tolerance))
+		Failed = true;
+	return Failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
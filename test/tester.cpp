@@ -17,12 +17,25 @@
  */
 
 #include <string>
+#include <vector>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <json/json.h>
 #include <cstdlib>
+#include <cmath>
+#include <cstdio>
 #include <check.h>
+#include "../model/map.h"
+#include "../model/field.h"
+#include "../model/loader.h"
+#include "../model/scene.h"
+#include "../model/parser.h"
+#include "../model/mapping/prior.h"
+#include "../model/ai/transposition.h"
+#include "../model/motion.h"
+#include "../model/bitgrid.h"
+#include "../model/ai/footprint.h"
 
 #ifdef fail
 #undef fail
@@ -72,6 +85,486 @@ START_TEST(json_tree_check)
 		ck_assert_int_eq(targetCode, resultCode);
 	}END_TEST
 
+START_TEST(distance_field_check)
+	{
+		vprobot::map::CLineMap Map(data["map"]);
+		vprobot::map::CDistanceField Field(Map, data["field"]);
+		double Tolerance = data["tolerance"].asDouble();
+		const Json::Value Points = data["points"];
+		Json::ArrayIndex i;
+
+		for (i = 0; i < Points.size(); i++) {
+			double d = Field.GetDistance(Points[i]["x"].asDouble(),
+					Points[i]["y"].asDouble());
+
+			ck_assert_msg(
+					std::fabs(d - Points[i]["distance"].asDouble()) <= Tolerance,
+					"distance %f at point %u", d, i);
+		}
+	}END_TEST
+
+START_TEST(distance_field_cache_check)
+	{
+		const std::string Cache = data["field"]["cache"].asString();
+		vprobot::map::CLineMap Map(data["map"]);
+
+		std::remove(Cache.c_str());
+
+		vprobot::map::CDistanceField Built(Map, data["field"]);
+		vprobot::map::CDistanceField Loaded(Map, data["field"]);
+		const Json::Value Points = data["points"];
+		Json::ArrayIndex i;
+
+		ck_assert_int_eq(Built.GetWidth(), Loaded.GetWidth());
+		ck_assert_int_eq(Built.GetHeight(), Loaded.GetHeight());
+		for (i = 0; i < Points.size(); i++) {
+			double x = Points[i]["x"].asDouble(), y = Points[i]["y"].asDouble();
+
+			ck_assert(Built.GetDistance(x, y) == Loaded.GetDistance(x, y));
+		}
+		std::remove(Cache.c_str());
+	}END_TEST
+
+/* Собрать препятствия карты в массив */
+std::vector<double> MapObstacles(const vprobot::map::CMap &Map) {
+	std::vector<double> Result;
+
+	Map.EnumerateObstacles(
+			[&](const vprobot::line::Point &a, const vprobot::line::Point &b) {
+				Result.insert(Result.end(), {a[0], a[1], b[0], b[1]});
+			});
+	return Result;
+}
+
+START_TEST(map_loader_check)
+	{
+		const std::string Text = Json::FastWriter().write(data["model"]);
+		Json::Value Root;
+		vprobot::map::SMapGeometry Geometry;
+
+		ck_assert(
+				vprobot::loader::ParseModel(Text.data(),
+						Text.data() + Text.size(), Root, Geometry));
+		ck_assert(Geometry.s_HasLines);
+		ck_assert(Geometry.s_HasPoints);
+
+		/* Геометрия вырезана из дерева, остальное сохранено */
+		const Json::Value &MapObject = Root["scene"]["map"];
+
+		ck_assert_int_eq(MapObject["lines"].size(), 0);
+		ck_assert_int_eq(MapObject["points"].size(), 0);
+		ck_assert(
+				MapObject["presentations"]
+						== data["model"]["scene"]["map"]["presentations"]);
+		ck_assert(Root["presentation"] == data["model"]["presentation"]);
+		ck_assert_int_eq(Root["scene"]["robots_count"].asInt(), 2);
+
+		/* Карты совпадают с прочитанными из дерева */
+		vprobot::map::CLineMap Lines(MapObject, &Geometry);
+		vprobot::map::CLineMap TreeLines(data["model"]["scene"]["map"]);
+		vprobot::map::CPointMap Points(MapObject, &Geometry);
+		vprobot::map::CPointMap TreePoints(data["model"]["scene"]["map"]);
+
+		ck_assert(MapObstacles(Lines) == MapObstacles(TreeLines));
+		ck_assert(MapObstacles(Points) == MapObstacles(TreePoints));
+	}END_TEST
+
+START_TEST(map_loader_fallback_check)
+	{
+		const std::string Text = Json::FastWriter().write(data["broken"]);
+		Json::Value Root;
+		vprobot::map::SMapGeometry Geometry;
+
+		/* Неподдерживаемая геометрия остается в дереве */
+		ck_assert(
+				vprobot::loader::ParseModel(Text.data(),
+						Text.data() + Text.size(), Root, Geometry));
+		ck_assert(!Geometry.s_HasLines);
+		ck_assert(Root == data["broken"]);
+	}END_TEST
+
+START_TEST(grid_map_check)
+	{
+		vprobot::map::CGridMap Map(data["map"]);
+		double Tolerance = data["tolerance"].asDouble();
+		const Json::Value Rays = data["rays"];
+		Json::ArrayIndex i;
+
+		ck_assert_int_eq(Map.GetGrid().Count(), 30);
+		for (i = 0; i < Rays.size(); i++) {
+			double d = Map.GetDistance(
+					vprobot::line::Point(Rays[i]["x"].asDouble(),
+							Rays[i]["y"].asDouble()),
+					Rays[i]["angle"].asDouble());
+
+			ck_assert_msg(
+					std::fabs(d - Rays[i]["distance"].asDouble()) <= Tolerance,
+					"distance %f at ray %u", d, i);
+		}
+	}END_TEST
+
+START_TEST(grid_map_file_check)
+	{
+		const std::string File = data["file"].asString();
+		vprobot::map::CGridMap Map(data["map"]);
+		Json::Value MapObject;
+
+		ck_assert(Map.Save(File));
+		MapObject["file"] = File;
+
+		/* Без пропуска блоков результат тот же */
+		MapObject["block"] = 0;
+
+		vprobot::map::CGridMap Loaded(MapObject);
+		const Json::Value Rays = data["rays"];
+		Json::ArrayIndex i;
+
+		ck_assert_int_eq(Loaded.GetGrid().Count(), Map.GetGrid().Count());
+		for (i = 0; i < Rays.size(); i++) {
+			vprobot::line::Point p(Rays[i]["x"].asDouble(),
+					Rays[i]["y"].asDouble());
+			double Angle = Rays[i]["angle"].asDouble();
+
+			ck_assert(Map.GetDistance(p, Angle) == Loaded.GetDistance(p, Angle));
+		}
+		std::remove(File.c_str());
+	}END_TEST
+
+START_TEST(grid_map_missing_file_check)
+	{
+		Json::Value SceneObject;
+
+		SceneObject["map_type"] = "Grid";
+		SceneObject["map"]["file"] = data["missing"];
+
+		vprobot::map::CGridMap Map(SceneObject["map"]);
+
+		/* Сцена с незагруженной картой не создается */
+		ck_assert(!Map.IsLoaded());
+		ck_assert(vprobot::Scene(SceneObject) == NULL);
+	}END_TEST
+
+/* Выполнять шаги, пока не будет сделано Steps шагов или симуляция не закончится */
+int RunScene(vprobot::scene::CScene &Scene, int Steps) {
+	int Done = 0;
+
+	while (Done != Steps) {
+		Scene.Simulate();
+		if (Scene.GetSimlationState()
+				== vprobot::presentation::CPresentationHandler::SimulationEnd)
+			break;
+		if (Scene.GetSimlationState()
+				== vprobot::presentation::CPresentationHandler::SimulationWorking)
+			Done++;
+	}
+	return Done;
+}
+
+/* Содержимое файла */
+std::string ReadFile(const std::string &Name) {
+	std::ifstream inp(Name.c_str(), std::ios::in | std::ios::binary);
+	std::stringstream Data;
+
+	Data << inp.rdbuf();
+	return Data.str();
+}
+
+START_TEST(checkpoint_check)
+	{
+		const std::string File = data["file"].asString();
+		const std::string Final = File + ".final", Resumed = File + ".resumed";
+		int Steps = data["steps"].asInt();
+		vprobot::scene::CScene *Scene = vprobot::Scene(data["scene"]);
+
+		ck_assert(Scene != NULL);
+		ck_assert_int_eq(RunScene(*Scene, Steps), Steps);
+		ck_assert(Scene->SaveCheckpoint(File));
+		RunScene(*Scene, -1);
+		ck_assert(Scene->SaveCheckpoint(Final));
+		delete Scene;
+
+		/* Продолжение с контрольной точки приводит к тому же состоянию */
+		Scene = vprobot::Scene(data["scene"]);
+		ck_assert(Scene != NULL);
+		ck_assert(Scene->LoadCheckpoint(File));
+		RunScene(*Scene, -1);
+		ck_assert(Scene->SaveCheckpoint(Resumed));
+		delete Scene;
+
+		ck_assert(ReadFile(Final) == ReadFile(Resumed));
+		std::remove(File.c_str());
+		std::remove(Final.c_str());
+		std::remove(Resumed.c_str());
+	}END_TEST
+
+START_TEST(checkpoint_mismatch_check)
+	{
+		const std::string File = data["file"].asString();
+		Json::Value SceneObject = data["scene"];
+		vprobot::scene::CScene *Scene = vprobot::Scene(SceneObject);
+
+		ck_assert(Scene != NULL);
+		RunScene(*Scene, 1);
+		ck_assert(Scene->SaveCheckpoint(File));
+		delete Scene;
+
+		/* Контрольная точка другой сцены не загружается */
+		SceneObject["robots_count"] = 1;
+		SceneObject["control_system"]["count"] = 1;
+		Scene = vprobot::Scene(SceneObject);
+		ck_assert(Scene != NULL);
+		ck_assert(!Scene->LoadCheckpoint(File));
+		delete Scene;
+		std::remove(File.c_str());
+	}END_TEST
+
+/* Область сетки из теста */
+vprobot::control::mapping::SGridArea GridArea(const Json::Value &AreaObject) {
+	vprobot::control::mapping::SGridArea Area = {AreaObject["x"].asDouble(),
+			AreaObject["y"].asDouble(), AreaObject["width"].asDouble(),
+			AreaObject["height"].asDouble()};
+
+	return Area;
+}
+
+START_TEST(map_prior_check)
+	{
+		const std::string File = data["file"].asString();
+		const Json::Value Rows = data["map"];
+		const vprobot::control::mapping::SGridArea Area = GridArea(
+				data["area"]);
+		Eigen::MatrixXd Map(Rows.size(), Rows[0].size());
+		Json::ArrayIndex i, j;
+
+		for (i = 0; i < Rows.size(); i++)
+			for (j = 0; j < Rows[i].size(); j++)
+				Map(i, j) = Rows[i][j].asDouble();
+		ck_assert(vprobot::control::mapping::SaveLogOdds(File, Map, Area));
+
+		Eigen::MatrixXd Loaded = Eigen::MatrixXd::Zero(Map.rows(), Map.cols());
+
+		ck_assert(vprobot::control::mapping::LoadLogOdds(File, Loaded, Area));
+		ck_assert(Loaded == Map);
+		std::remove(File.c_str());
+	}END_TEST
+
+START_TEST(map_prior_mismatch_check)
+	{
+		const std::string File = data["file"].asString();
+		const Json::Value Rows = data["map"];
+		vprobot::control::mapping::SGridArea Area = GridArea(data["area"]);
+		Eigen::MatrixXd Map = Eigen::MatrixXd::Zero(Rows.size(),
+				Rows[0].size());
+
+		ck_assert(vprobot::control::mapping::SaveLogOdds(File, Map, Area));
+
+		/* Карта другого размера или другой области не загружается */
+		Eigen::MatrixXd Other = Eigen::MatrixXd::Zero(Map.rows() + 1,
+				Map.cols());
+
+		ck_assert(!vprobot::control::mapping::LoadLogOdds(File, Other, Area));
+		Area.s_Width *= 2;
+		ck_assert(!vprobot::control::mapping::LoadLogOdds(File, Map, Area));
+		std::remove(File.c_str());
+		ck_assert(!vprobot::control::mapping::LoadLogOdds(File, Map, Area));
+	}END_TEST
+
+START_TEST(transposition_check)
+	{
+		vprobot::control::mcts_ai::CTranspositionTable Table;
+		const Json::Value Samples = data["samples"];
+		Json::ArrayIndex i;
+
+		ck_assert(!Table.IsEnabled());
+		Table.Add(1, 1, 1);
+		ck_assert(Table.Find(1) == NULL);
+		Table.Resize(data["size"].asUInt());
+		ck_assert(Table.IsEnabled());
+		for (i = 0; i < Samples.size(); i++)
+			Table.Add(Samples[i]["key"].asUInt64(), Samples[i]["y"].asDouble(),
+					Samples[i]["time"].asDouble());
+
+		/* Семплы одного состояния складываются */
+		const vprobot::control::mcts_ai::CTranspositionTable::SEntry *Entry =
+				Table.Find(11);
+
+		ck_assert(Entry != NULL);
+		ck_assert_int_eq(Entry->s_Visits, 2);
+		ck_assert(Entry->s_Y == 6 && Entry->s_Time == 6);
+		ck_assert(Table.Find(12) != NULL && Table.Find(12)->s_Visits == 1);
+		ck_assert(Table.Find(13) == NULL);
+		Table.Clear();
+		ck_assert(Table.Find(11) == NULL);
+	}END_TEST
+
+START_TEST(transposition_replace_check)
+	{
+		vprobot::control::mcts_ai::CTranspositionTable Table;
+		std::uint64_t Key, Keys = data["keys"].asUInt64();
+		std::size_t Found = 0;
+
+		/* В переполненной таблице часто посещаемое состояние не вытесняется */
+		Table.Resize(data["size"].asUInt());
+		Table.Add(vprobot::control::mcts_ai::CTranspositionTable::Mix(0, 0), 1,
+				1);
+		Table.Add(vprobot::control::mcts_ai::CTranspositionTable::Mix(0, 0), 1,
+				1);
+		for (Key = 1; Key < Keys; Key++)
+			Table.Add(vprobot::control::mcts_ai::CTranspositionTable::Mix(0, Key),
+					1, 1);
+		ck_assert(
+				Table.Find(vprobot::control::mcts_ai::CTranspositionTable::Mix(0, 0))
+						!= NULL);
+		for (Key = 1; Key < Keys; Key++)
+			if (Table.Find(vprobot::control::mcts_ai::CTranspositionTable::Mix(0,
+					Key)) != NULL)
+				Found++;
+		ck_assert(Found < data["size"].asUInt());
+	}END_TEST
+
+START_TEST(motion_check)
+	{
+		vprobot::robot::CMotionModel Model(data["len"].asDouble(),
+				1 / data["radius"].asDouble());
+		const Json::Value States = data["states"];
+		Eigen::Vector3d All[vprobot::robot::MaxCommand];
+		Eigen::ArrayXd X(States.size()), Y(States.size()), Angle(States.size());
+		Eigen::ArrayXd Len(States.size()), Curv(States.size());
+		Json::ArrayIndex i;
+		int c;
+
+		for (c = vprobot::robot::Forward; c < vprobot::robot::MaxCommand; c++) {
+			vprobot::robot::ControlCommand Command =
+					static_cast<vprobot::robot::ControlCommand>(c);
+			double l = Model.GetLen(Command), k = Model.GetCurvature(Command);
+
+			for (i = 0; i < States.size(); i++) {
+				Eigen::Vector3d State, Expected;
+
+				State << States[i]["x"].asDouble(), States[i]["y"].asDouble(), States[i]["angle"].asDouble();
+				X[i] = State[0];
+				Y[i] = State[1];
+				Angle[i] = State[2];
+				Len[i] = l;
+				Curv[i] = k;
+
+				/* Дуга в глобальной системе координат */
+				if (k == 0)
+					Expected << State[0] + l * cos(State[2]), State[1]
+							+ l * sin(State[2]), State[2];
+				else
+					Expected << State[0]
+							+ (sin(State[2] + l * k) - sin(State[2])) / k, State[1]
+							+ (cos(State[2]) - cos(State[2] + l * k)) / k, State[2]
+							+ l * k;
+				Model.ApplyAll(State, All);
+				ck_assert(All[vprobot::robot::Nothing] == State);
+				Model.Apply(State, Command);
+				ck_assert(All[c] == State);
+				ck_assert((State.head<2>() - Expected.head<2>()).norm() < 1e-12);
+				ck_assert(std::fabs(std::sin(State[2] - Expected[2])) < 1e-12);
+				ck_assert(State[2] >= -M_PI && State[2] <= M_PI);
+			}
+
+			/* Пакетный сдвиг дает те же позиции */
+			vprobot::robot::CMotionModel::Apply(X, Y, Angle, Len, Curv);
+			for (i = 0; i < States.size(); i++) {
+				Eigen::Vector3d State;
+
+				State << States[i]["x"].asDouble(), States[i]["y"].asDouble(), States[i]["angle"].asDouble();
+				Model.Apply(State, Command);
+				ck_assert(std::fabs(X[i] - State[0]) < 1e-12);
+				ck_assert(std::fabs(Y[i] - State[1]) < 1e-12);
+				ck_assert(std::fabs(std::sin(Angle[i] - State[2])) < 1e-12);
+			}
+		}
+	}END_TEST
+
+START_TEST(footprint_check)
+	{
+		const Json::Value States = data["states"];
+		vprobot::control::mapping::SGridArea Area;
+		std::size_t NumWidth = data["num_width"].asUInt(), NumHeight =
+				data["num_height"].asUInt();
+		double Width = data["width"].asDouble(), Height =
+				data["height"].asDouble();
+		double cw, ch;
+		vprobot::control::CFootprint Footprint, Point;
+		vprobot::bitgrid::CBitGrid Grid(NumWidth, NumHeight);
+		Json::ArrayIndex i;
+		int u, v;
+
+		Area.s_StartX = data["area"]["x"].asDouble();
+		Area.s_StartY = data["area"]["y"].asDouble();
+		Area.s_Width = data["area"]["width"].asDouble();
+		Area.s_Height = data["area"]["height"].asDouble();
+		cw = Area.s_Width / NumWidth;
+		ch = Area.s_Height / NumHeight;
+		Footprint.Build(Width, Height, Area, NumWidth, NumHeight,
+				data["directions"].asUInt());
+		Point.Build(0, 0, Area, NumWidth, NumHeight, data["directions"].asUInt());
+		for (i = 0; i < States.size(); i++) {
+			Eigen::Vector3d State;
+
+			State << States[i]["x"].asDouble(), States[i]["y"].asDouble(), States[i]["angle"].asDouble();
+
+			/* На пустой сетке столкновений нет */
+			ck_assert(!Footprint.Overlaps(Grid, State));
+
+			/* Любая точка контура в занятой клетке дает столкновение */
+			for (u = -4; u <= 4; u++)
+				for (v = -4; v <= 4; v++) {
+					double px = u * Width / 8, py = v * Height / 8;
+					int x = static_cast<int>(floor(
+							(State[0] + px * cos(State[2]) - py * sin(State[2])
+									- Area.s_StartX) / cw));
+					int y = static_cast<int>(floor(
+							(State[1] + px * sin(State[2]) + py * cos(State[2])
+									- Area.s_StartY) / ch));
+
+					Grid.Set(x, y);
+					ck_assert(Footprint.Overlaps(Grid, State));
+					Grid.Set(x, y, false);
+				}
+
+			/* Далекие клетки не задеваются */
+			int cx = static_cast<int>(floor((State[0] - Area.s_StartX) / cw));
+			int cy = static_cast<int>(floor((State[1] - Area.s_StartY) / ch));
+			int rx = static_cast<int>(ceil(std::hypot(Width, Height) / cw)) + 2;
+			int ry = static_cast<int>(ceil(std::hypot(Width, Height) / ch)) + 2;
+
+			Grid.Set(cx - rx, cy);
+			Grid.Set(cx + rx, cy);
+			Grid.Set(cx, cy - ry);
+			Grid.Set(cx, cy + ry);
+			ck_assert(!Footprint.Overlaps(Grid, State));
+
+			/* Робот нулевого размера проверяет только свою клетку */
+			ck_assert(!Point.Overlaps(Grid, State));
+			Grid.Set(cx, cy);
+			ck_assert(Point.Overlaps(Grid, State));
+			ck_assert(Footprint.Overlaps(Grid, State));
+
+			/* Клетки под роботом освобождаются, остальные остаются */
+			Footprint.Release(Grid, State);
+			ck_assert(!Grid.Get(cx, cy) && Grid.Get(cx + rx, cy));
+			ck_assert(!Footprint.Overlaps(Grid, State));
+			Grid.Set(cx - rx, cy, false);
+			Grid.Set(cx + rx, cy, false);
+			Grid.Set(cx, cy - ry, false);
+			Grid.Set(cx, cy + ry, false);
+		}
+
+		/* Выход за сетку - столкновение */
+		Eigen::Vector3d Outside(Area.s_StartX + Width / 4, Area.s_StartY
+				+ Area.s_Height / 2, 0);
+
+		ck_assert(Footprint.Overlaps(Grid, Outside));
+		ck_assert(!Point.Overlaps(Grid, Outside));
+		Outside[0] = Area.s_StartX - cw / 2;
+		ck_assert(Point.Overlaps(Grid, Outside));
+	}END_TEST
+
 Suite *RobotTests(const char *in_file) {
 	std::ifstream inp(in_file);
 	std::stringstream json;
@@ -98,6 +591,61 @@ Suite *RobotTests(const char *in_file) {
 		tcase_add_test(tc_core, json_array_check);
 		tcase_add_test(tc_core, json_tree_check);
 	}
+	if (test_case == "distance_field") {
+		s = suite_create("distance_field");
+		tc_core = tcase_create("Core");
+
+		tcase_add_test(tc_core, distance_field_check);
+		tcase_add_test(tc_core, distance_field_cache_check);
+	}
+	if (test_case == "map_loader") {
+		s = suite_create("map_loader");
+		tc_core = tcase_create("Core");
+
+		tcase_add_test(tc_core, map_loader_check);
+		tcase_add_test(tc_core, map_loader_fallback_check);
+	}
+	if (test_case == "grid_map") {
+		s = suite_create("grid_map");
+		tc_core = tcase_create("Core");
+
+		tcase_add_test(tc_core, grid_map_check);
+		tcase_add_test(tc_core, grid_map_file_check);
+		tcase_add_test(tc_core, grid_map_missing_file_check);
+	}
+	if (test_case == "checkpoint") {
+		s = suite_create("checkpoint");
+		tc_core = tcase_create("Core");
+
+		tcase_add_test(tc_core, checkpoint_check);
+		tcase_add_test(tc_core, checkpoint_mismatch_check);
+	}
+	if (test_case == "map_prior") {
+		s = suite_create("map_prior");
+		tc_core = tcase_create("Core");
+
+		tcase_add_test(tc_core, map_prior_check);
+		tcase_add_test(tc_core, map_prior_mismatch_check);
+	}
+	if (test_case == "transposition") {
+		s = suite_create("transposition");
+		tc_core = tcase_create("Core");
+
+		tcase_add_test(tc_core, transposition_check);
+		tcase_add_test(tc_core, transposition_replace_check);
+	}
+	if (test_case == "motion") {
+		s = suite_create("motion");
+		tc_core = tcase_create("Core");
+
+		tcase_add_test(tc_core, motion_check);
+	}
+	if (test_case == "footprint") {
+		s = suite_create("footprint");
+		tc_core = tcase_create("Core");
+
+		tcase_add_test(tc_core, footprint_check);
+	}
 	if (s == NULL)
 		return NULL;
 	if (tc_core != NULL)
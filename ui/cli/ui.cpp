@@ -0,0 +1,112 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "ui.h"
+
+#include <cstdio>
+#include <algorithm>
+#include <iostream>
+
+#include "../../model/profiler.h"
+
+using namespace ::vprobot;
+using namespace ::vprobot::presentation;
+using namespace ::vprobot::ui;
+
+/* CUI */
+
+vprobot::ui::CUI::CUI(CPresentationHandler &Handler,
+		const Json::Value &PresentationObject) :
+		m_Handler(Handler), m_ScreensSet(), m_Frame(), m_Recorder(
+				PresentationObject), m_Window(NULL), m_Frames(
+				PresentationObject["frames"].asString()), m_FrameFormat(
+				PresentationObject.get("frame_format", "png").asString()) {
+	m_FrameInterval = std::max(
+			PresentationObject.get("frame_interval", 1).asUInt(), 1u);
+	if (!m_Frames.empty())
+		m_Window = new CImage(std::max(PresentationObject["width"].asInt(), 0),
+				std::max(PresentationObject["height"].asInt(), 0));
+
+	Json::ArrayIndex i;
+	const Json::Value Screens = PresentationObject["screens"];
+
+	for (i = 0; i < Screens.size(); i++) {
+		m_ScreensSet.push_back(new SScreen(Screens[i], m_Window != NULL));
+		m_Frame.push_back(new CDisplayList());
+	}
+}
+
+vprobot::ui::CUI::~CUI() {
+	for (auto s : m_ScreensSet) {
+		delete s;
+	}
+	for (auto l : m_Frame) {
+		delete l;
+	}
+	delete m_Window;
+}
+
+/* Сохранить кадр */
+void vprobot::ui::CUI::SaveFrame(std::size_t Step) {
+	profiler::CScopedTimer Timer(profiler::PhaseRender);
+	char Number[32];
+	bool Saved;
+
+	m_Window->Clear(CImage::Color(255, 255, 255, 255));
+	for (auto s : m_ScreensSet) {
+		s->Driver->Update();
+		m_Handler.DrawPresentation(*s->Driver, s->Id);
+		s->Driver->ProjectToImage(*m_Window);
+	}
+	snprintf(Number, sizeof(Number), "%06lu",
+			static_cast<unsigned long>(Step));
+	if (m_FrameFormat == "ppm")
+		Saved = m_Window->SavePPM(m_Frames + Number + ".ppm");
+	else
+		Saved = m_Window->SavePNG(m_Frames + Number + ".png");
+	if (!Saved)
+		std::clog << "Couldn't save frame " << m_Frames << Number << std::endl;
+}
+
+/* Обновление данных */
+void vprobot::ui::CUI::Process(const HandlerFunction &Function) {
+	std::size_t i, Step = 0;
+
+	do {
+		Function();
+		/* Записываются и сохраняются только завершенные шаги (без
+		 * конвейера шаг сцены занимает два вызова Function) */
+		if (m_Handler.GetSimlationState()
+				== CPresentationHandler::SimulationWorking)
+			continue;
+		if (m_Recorder.NextStep()) {
+			profiler::CScopedTimer Timer(profiler::PhaseRecord);
+
+			for (i = 0; i < m_ScreensSet.size(); i++) {
+				m_Frame[i]->Clear();
+				m_Handler.DrawPresentation(*m_Frame[i], m_ScreensSet[i]->Id);
+			}
+			m_Recorder.Write(m_Frame);
+		}
+		if (m_Window != NULL && Step % m_FrameInterval == 0)
+			SaveFrame(Step);
+		Step++;
+	} while (m_Handler.GetSimlationState()
+			!= CPresentationHandler::SimulationEnd);
+}
@@ -23,4 +23,78 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+#include <json/json.h>
+#include "../../model/presentation.h"
+#include "../../model/display-list.h"
+#include "../../model/record.h"
+#include "../raster/raster.h"
+
+namespace vprobot {
+
+namespace ui {
+
+/* Интерфейс без окна: симуляция идет без остановок, презентации
+ * при необходимости записываются в файл или сохраняются кадрами */
+class CUI {
+public:
+	/* Тип для обработчика */
+	typedef std::function<void()> HandlerFunction;
+private:
+	/* Структура для экрана */
+	struct SScreen {
+		/* Растровый вывод (NULL, если кадры не сохраняются) */
+		CRasterPresentationDriver *Driver;
+		vprobot::presentation::PresentationId Id;
+		SScreen(const Json::Value &ScreenObject, bool Raster) :
+				Driver(Raster ?
+						new CRasterPresentationDriver(ScreenObject) : NULL), Id(
+						vprobot::presentation::InternPresentationName(
+								ScreenObject["name"].asString())) {
+		}
+		~SScreen() {
+			delete Driver;
+		}
+	private:
+		SScreen(const SScreen &Scren) = default;
+	};
+	typedef std::vector<SScreen *> ScreensSet;
+
+	/* Ссылка на обработчик презентаций */
+	vprobot::presentation::CPresentationHandler &m_Handler;
+	/* Экраны */
+	ScreensSet m_ScreensSet;
+	/* Списки команд текущего кадра (по экрану) */
+	std::vector<vprobot::presentation::CDisplayList *> m_Frame;
+	/* Запись презентаций */
+	vprobot::presentation::CRecorder m_Recorder;
+	/* Изображение окна для кадров (NULL, если кадры не сохраняются) */
+	CImage *m_Window;
+	/* Начало имени файлов кадров (пустое - кадры не сохраняются) */
+	std::string m_Frames;
+	/* Формат кадров ("png" или "ppm") */
+	std::string m_FrameFormat;
+	/* Кадр сохраняется каждый m_FrameInterval завершенный шаг */
+	std::size_t m_FrameInterval;
+
+	/* Сохранить кадр */
+	void SaveFrame(std::size_t Step);
+
+	CUI(const CUI &UI) = default;
+public:
+	CUI(vprobot::presentation::CPresentationHandler &Handler,
+			const Json::Value &PresentationObject);
+	~CUI();
+
+	/* Обновление данных */
+	void Process(const HandlerFunction &Handler);
+};
+
+}
+
+}
+
 #endif
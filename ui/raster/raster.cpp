@@ -0,0 +1,836 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "raster.h"
+
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "../../types.h"
+
+using namespace ::std;
+using namespace ::vprobot;
+using namespace ::vprobot::ui;
+
+namespace {
+
+/* Шрифт 8x8 для символов 32 - 126 (младший бит - левый пиксель) */
+const unsigned char Font[95][8] = {
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+	{0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00},
+	{0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+	{0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00},
+	{0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00},
+	{0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00},
+	{0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00},
+	{0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00},
+	{0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00},
+	{0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00},
+	{0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00},
+	{0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06},
+	{0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00},
+	{0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00},
+	{0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00},
+	{0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00},
+	{0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00},
+	{0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00},
+	{0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00},
+	{0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00},
+	{0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00},
+	{0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00},
+	{0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00},
+	{0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00},
+	{0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00},
+	{0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06},
+	{0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00},
+	{0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00},
+	{0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00},
+	{0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00},
+	{0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00},
+	{0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00},
+	{0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00},
+	{0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00},
+	{0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00},
+	{0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00},
+	{0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00},
+	{0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00},
+	{0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00},
+	{0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+	{0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00},
+	{0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00},
+	{0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00},
+	{0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00},
+	{0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00},
+	{0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00},
+	{0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00},
+	{0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00},
+	{0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00},
+	{0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00},
+	{0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+	{0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00},
+	{0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00},
+	{0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00},
+	{0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00},
+	{0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00},
+	{0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00},
+	{0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00},
+	{0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00},
+	{0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00},
+	{0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00},
+	{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF},
+	{0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00},
+	{0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00},
+	{0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00},
+	{0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00},
+	{0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00},
+	{0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00},
+	{0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00},
+	{0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F},
+	{0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00},
+	{0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+	{0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E},
+	{0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00},
+	{0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00},
+	{0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00},
+	{0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00},
+	{0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00},
+	{0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F},
+	{0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78},
+	{0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00},
+	{0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00},
+	{0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00},
+	{0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00},
+	{0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00},
+	{0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00},
+	{0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00},
+	{0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F},
+	{0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00},
+	{0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00},
+	{0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00},
+	{0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00},
+	{0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
+};
+
+const uint32_t White = CImage::Color(255, 255, 255, 255);
+const uint32_t Black = CImage::Color(0, 0, 0, 255);
+
+/* Залить отрезок непрозрачным цветом */
+inline void FillOpaque(uint32_t *p, size_t n, uint32_t Color) {
+#ifdef __SSE2__
+	__m128i c = _mm_set1_epi32(Color);
+
+	for (; n >= 4; n -= 4, p += 4)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(p), c);
+#endif
+	for (; n > 0; n--)
+		*p++ = Color;
+}
+
+/* Смешать отрезок с цветом: d = (s * a + d * (255 - a)) / 255 по каналам
+ * (деление на 255 с округлением через (v + (v >> 8)) >> 8) */
+inline void BlendSpan(uint32_t *p, size_t n, uint32_t Color, unsigned a) {
+#ifdef __SSE2__
+	__m128i Zero = _mm_setzero_si128();
+	__m128i sa = _mm_add_epi16(
+			_mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32(Color), Zero),
+					_mm_set1_epi16(a)), _mm_set1_epi16(128));
+	__m128i ia = _mm_set1_epi16(255 - a);
+
+	for (; n >= 4; n -= 4, p += 4) {
+		__m128i d = _mm_loadu_si128(reinterpret_cast<__m128i *>(p));
+		__m128i lo = _mm_add_epi16(
+				_mm_mullo_epi16(_mm_unpacklo_epi8(d, Zero), ia), sa);
+		__m128i hi = _mm_add_epi16(
+				_mm_mullo_epi16(_mm_unpackhi_epi8(d, Zero), ia), sa);
+
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(p),
+				_mm_packus_epi16(lo, hi));
+	}
+#endif
+	for (; n > 0; n--, p++) {
+		uint32_t r = 0;
+		int Shift;
+
+		for (Shift = 0; Shift < 32; Shift += 8) {
+			unsigned v = ((Color >> Shift) & 255) * a
+					+ ((*p >> Shift) & 255) * (255 - a) + 128;
+
+			r |= static_cast<uint32_t>((v + (v >> 8)) >> 8) << Shift;
+		}
+		*p = r;
+	}
+}
+
+/* Отсечь отрезок прямоугольником (алгоритм Лианга-Барски) */
+bool ClipLine(double &x0, double &y0, double &x1, double &y1, double xmin,
+		double ymin, double xmax, double ymax) {
+	double t0 = 0, t1 = 1, dx = x1 - x0, dy = y1 - y0;
+	double p[4] = {-dx, dx, -dy, dy};
+	double q[4] = {x0 - xmin, xmax - x0, y0 - ymin, ymax - y0};
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		if (p[i] == 0) {
+			if (q[i] < 0)
+				return false;
+			continue;
+		}
+
+		double t = q[i] / p[i];
+
+		if (p[i] < 0)
+			t0 = std::max(t0, t);
+		else
+			t1 = std::min(t1, t);
+	}
+	if (t0 > t1)
+		return false;
+	x1 = x0 + t1 * dx;
+	y1 = y0 + t1 * dy;
+	x0 += t0 * dx;
+	y0 += t0 * dy;
+	return true;
+}
+
+/* Контрольная сумма CRC-32 */
+uint32_t Crc32(uint32_t Crc, const unsigned char *Data, size_t Size) {
+	static const vector<uint32_t> Table = [] {
+		vector<uint32_t> t(256);
+		uint32_t i, j;
+
+		for (i = 0; i < 256; i++) {
+			uint32_t c = i;
+
+			for (j = 0; j < 8; j++)
+				c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+			t[i] = c;
+		}
+		return t;
+	}();
+	size_t i;
+
+	Crc = ~Crc;
+	for (i = 0; i < Size; i++)
+		Crc = Table[(Crc ^ Data[i]) & 255] ^ (Crc >> 8);
+	return ~Crc;
+}
+
+/* Контрольная сумма Adler-32 */
+uint32_t Adler32(const unsigned char *Data, size_t Size) {
+	uint32_t a = 1, b = 0;
+	size_t i;
+
+	for (i = 0; i < Size; i++) {
+		a = (a + Data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	return (b << 16) | a;
+}
+
+/* Запись потока бит (младшие биты первыми) */
+class CBitWriter {
+private:
+	vector<unsigned char> &m_Out;
+	uint32_t m_Bits;
+	int m_Count;
+public:
+	CBitWriter(vector<unsigned char> &Out) :
+			m_Out(Out), m_Bits(0), m_Count(0) {
+	}
+
+	/* Записать Count бит значения */
+	inline void Put(uint32_t Value, int Count) {
+		m_Bits |= Value << m_Count;
+		m_Count += Count;
+		while (m_Count >= 8) {
+			m_Out.push_back(m_Bits & 255);
+			m_Bits >>= 8;
+			m_Count -= 8;
+		}
+	}
+	/* Записать код Хаффмана (старшие биты первыми) */
+	inline void PutCode(uint32_t Code, int Length) {
+		uint32_t r = 0;
+		int i;
+
+		for (i = 0; i < Length; i++)
+			r |= ((Code >> i) & 1) << (Length - 1 - i);
+		Put(r, Length);
+	}
+	/* Дописать неполный байт */
+	inline void Flush() {
+		if (m_Count > 0)
+			m_Out.push_back(m_Bits & 255);
+		m_Bits = 0;
+		m_Count = 0;
+	}
+};
+
+const unsigned LengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19,
+		23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const unsigned LengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+		2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const unsigned DistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97,
+		129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193,
+		12289, 16385, 24577};
+const unsigned DistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/* Записать литерал или длину фиксированным кодом Хаффмана */
+inline void PutSymbol(CBitWriter &Writer, unsigned Symbol) {
+	if (Symbol < 144)
+		Writer.PutCode(0x30 + Symbol, 8);
+	else if (Symbol < 256)
+		Writer.PutCode(0x190 + Symbol - 144, 9);
+	else if (Symbol < 280)
+		Writer.PutCode(Symbol - 256, 7);
+	else
+		Writer.PutCode(0xC0 + Symbol - 280, 8);
+}
+
+/* Записать повтор */
+inline void PutMatch(CBitWriter &Writer, unsigned Length, unsigned Dist) {
+	unsigned l = upper_bound(LengthBase, LengthBase + 29, Length) - LengthBase
+			- 1;
+	unsigned d = upper_bound(DistBase, DistBase + 30, Dist) - DistBase - 1;
+
+	PutSymbol(Writer, 257 + l);
+	Writer.Put(Length - LengthBase[l], LengthExtra[l]);
+	Writer.PutCode(d, 5);
+	Writer.Put(Dist - DistBase[d], DistExtra[d]);
+}
+
+/* Сжать данные в формат zlib (один блок с фиксированными кодами;
+ * повторы ищутся только на пиксель влево и на строку вверх) */
+void Compress(const vector<unsigned char> &Data, size_t Pixel, size_t Stride,
+		vector<unsigned char> &Out) {
+	CBitWriter Writer(Out);
+	size_t n = Data.size(), i = 0;
+	size_t Dists[2] = {Pixel, Stride};
+	uint32_t Adler = Adler32(Data.data(), n);
+	int k;
+
+	Out.push_back(0x78);
+	Out.push_back(0x01);
+	Writer.Put(1, 1);
+	Writer.Put(1, 2);
+	while (i < n) {
+		size_t Best = 0, BestDist = 0;
+
+		for (k = 0; k < 2; k++) {
+			size_t d = Dists[k], l = 0;
+
+			if (d > i || d > 32768)
+				continue;
+			while (l < 258 && i + l < n && Data[i + l] == Data[i + l - d])
+				l++;
+			if (l > Best) {
+				Best = l;
+				BestDist = d;
+			}
+		}
+		if (Best >= 3) {
+			PutMatch(Writer, Best, BestDist);
+			i += Best;
+		} else {
+			PutSymbol(Writer, Data[i]);
+			i++;
+		}
+	}
+	PutSymbol(Writer, 256);
+	Writer.Flush();
+	for (k = 3; k >= 0; k--)
+		Out.push_back((Adler >> (8 * k)) & 255);
+}
+
+/* Записать число в порядке big-endian */
+inline void PutBigEndian(vector<unsigned char> &Out, uint32_t Value) {
+	int k;
+
+	for (k = 3; k >= 0; k--)
+		Out.push_back((Value >> (8 * k)) & 255);
+}
+
+/* Записать блок PNG */
+void PutChunk(ofstream &File, const char *Type,
+		const vector<unsigned char> &Data) {
+	vector<unsigned char> Head, Tail;
+	uint32_t Crc;
+
+	PutBigEndian(Head, Data.size());
+	Head.insert(Head.end(), Type, Type + 4);
+	Crc = Crc32(0, &Head[4], 4);
+	Crc = Crc32(Crc, Data.data(), Data.size());
+	PutBigEndian(Tail, Crc);
+	File.write(reinterpret_cast<const char *>(Head.data()), Head.size());
+	File.write(reinterpret_cast<const char *>(Data.data()), Data.size());
+	File.write(reinterpret_cast<const char *>(Tail.data()), Tail.size());
+}
+
+}
+
+/* CImage */
+
+vprobot::ui::CImage::CImage(size_t Width, size_t Height) :
+		m_Width(Width), m_Height(Height), m_Pixels(Width * Height, White) {
+}
+
+/* Залить изображение */
+void vprobot::ui::CImage::Clear(uint32_t Color) {
+	if (!m_Pixels.empty())
+		FillOpaque(m_Pixels.data(), m_Pixels.size(), Color);
+}
+
+/* Залить отрезок строки [x0, x1] с прозрачностью из Color */
+void vprobot::ui::CImage::FillSpan(int y, int x0, int x1, uint32_t Color) {
+	unsigned a = Color & 255;
+
+	if (y < 0 || y >= static_cast<int>(m_Height) || a == 0)
+		return;
+	x0 = std::max(x0, 0);
+	x1 = std::min(x1, static_cast<int>(m_Width) - 1);
+	if (x0 > x1)
+		return;
+
+	uint32_t *p = GetRow(y) + x0;
+	size_t n = x1 - x0 + 1;
+
+	/* Альфа-канал результата остается непрозрачным */
+	if (a == 255)
+		FillOpaque(p, n, Color);
+	else
+		BlendSpan(p, n, Color | 255, a);
+}
+
+/* Залить прямоугольник */
+void vprobot::ui::CImage::FillRectangle(int x0, int y0, int x1, int y1,
+		uint32_t Color) {
+	int y;
+
+	y0 = std::max(y0, 0);
+	y1 = std::min(y1, static_cast<int>(m_Height) - 1);
+	for (y = y0; y <= y1; y++)
+		FillSpan(y, x0, x1, Color);
+}
+
+/* Нарисовать линию */
+void vprobot::ui::CImage::DrawLine(int x0, int y0, int x1, int y1,
+		uint32_t Color) {
+	int dx = std::abs(x1 - x0), dy = -std::abs(y1 - y0);
+	int sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1, e = dx + dy;
+
+	for (;;) {
+		BlendPixel(x0, y0, Color);
+		if (x0 == x1 && y0 == y1)
+			break;
+
+		int e2 = 2 * e;
+
+		if (e2 >= dy) {
+			e += dy;
+			x0 += sx;
+		}
+		if (e2 <= dx) {
+			e += dx;
+			y0 += sy;
+		}
+	}
+}
+
+/* Нарисовать рамку */
+void vprobot::ui::CImage::DrawFrame(int x0, int y0, int x1, int y1,
+		uint32_t Color) {
+	int y;
+
+	FillSpan(y0, x0, x1, Color);
+	if (y1 != y0)
+		FillSpan(y1, x0, x1, Color);
+	for (y = std::max(y0 + 1, 0);
+			y < std::min(y1, static_cast<int>(m_Height)); y++) {
+		BlendPixel(x0, y, Color);
+		if (x1 != x0)
+			BlendPixel(x1, y, Color);
+	}
+}
+
+/* Написать текст шрифтом 8x8 (x, y - левый верхний угол) */
+void vprobot::ui::CImage::PutText(int x, int y, const char *Text,
+		uint32_t Color) {
+	int i, j;
+
+	for (; *Text != '\0'; Text++, x += 8) {
+		unsigned char c = *Text;
+
+		if (c < 32 || c > 126)
+			c = '?';
+		for (i = 0; i < 8; i++) {
+			unsigned char Row = Font[c - 32][i];
+
+			for (j = 0; j < 8; j++)
+				if (Row & (1 << j))
+					BlendPixel(x + j, y + i, Color);
+		}
+	}
+}
+
+/* Скопировать изображение с наложением по альфа-каналу */
+void vprobot::ui::CImage::Blit(const CImage &Image, int x, int y) {
+	int i, j;
+	int x0 = std::max(x, 0), x1 = std::min(x + static_cast<int>(Image.m_Width),
+			static_cast<int>(m_Width));
+	int y0 = std::max(y, 0), y1 = std::min(
+			y + static_cast<int>(Image.m_Height), static_cast<int>(m_Height));
+
+	for (i = y0; i < y1; i++) {
+		const uint32_t *s = Image.GetRow(i - y);
+		uint32_t *d = GetRow(i);
+
+		for (j = x0; j < x1; j++) {
+			uint32_t c = s[j - x];
+
+			if ((c & 255) == 255)
+				d[j] = c;
+			else
+				BlendPixel(j, i, c);
+		}
+	}
+}
+
+/* Сохранить в PNG (false при ошибке записи) */
+bool vprobot::ui::CImage::SavePNG(const string &Name) const {
+	static const unsigned char Signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+	ofstream File(Name.c_str(), ios::out | ios::binary | ios::trunc);
+	vector<unsigned char> Header, Raw, Data;
+	size_t x, y, Stride = 1 + 3 * m_Width;
+
+	if (!File)
+		return false;
+	/* Строки без фильтра: байт типа фильтра и RGB */
+	Raw.reserve(Stride * m_Height);
+	for (y = 0; y < m_Height; y++) {
+		const uint32_t *p = GetRow(y);
+
+		Raw.push_back(0);
+		for (x = 0; x < m_Width; x++) {
+			Raw.push_back(p[x] >> 24);
+			Raw.push_back((p[x] >> 16) & 255);
+			Raw.push_back((p[x] >> 8) & 255);
+		}
+	}
+	Compress(Raw, 3, Stride, Data);
+
+	PutBigEndian(Header, m_Width);
+	PutBigEndian(Header, m_Height);
+	Header.push_back(8);
+	Header.push_back(2);
+	Header.push_back(0);
+	Header.push_back(0);
+	Header.push_back(0);
+	File.write(reinterpret_cast<const char *>(Signature), sizeof(Signature));
+	PutChunk(File, "IHDR", Header);
+	PutChunk(File, "IDAT", Data);
+	PutChunk(File, "IEND", vector<unsigned char>());
+	return File.good();
+}
+
+/* Сохранить в PPM (false при ошибке записи) */
+bool vprobot::ui::CImage::SavePPM(const string &Name) const {
+	ofstream File(Name.c_str(), ios::out | ios::binary | ios::trunc);
+	vector<unsigned char> Row(3 * m_Width);
+	size_t x, y;
+
+	if (!File)
+		return false;
+	File << "P6\n" << m_Width << " " << m_Height << "\n255\n";
+	for (y = 0; y < m_Height; y++) {
+		const uint32_t *p = GetRow(y);
+
+		for (x = 0; x < m_Width; x++) {
+			Row[3 * x] = p[x] >> 24;
+			Row[3 * x + 1] = (p[x] >> 16) & 255;
+			Row[3 * x + 2] = (p[x] >> 8) & 255;
+		}
+		File.write(reinterpret_cast<const char *>(Row.data()), Row.size());
+	}
+	return File.good();
+}
+
+/* CRasterPresentationDriver */
+
+vprobot::ui::CRasterPresentationDriver::CRasterPresentationDriver(
+		const Json::Value &ScreenObject) :
+		m_Title(ScreenObject["title"].asString()), m_x(
+				ScreenObject["x"].asInt()), m_y(ScreenObject["y"].asInt()), m_Image(
+				std::max(ScreenObject["width"].asInt(), 0),
+				std::max(ScreenObject["height"].asInt(), 0)), m_PointsX(), m_PointsY(), m_Crossings(), m_Columns() {
+	m_ofsx = ScreenObject["ofsx"].asDouble();
+	m_ofsy = ScreenObject["ofsy"].asDouble();
+	m_zoom = ScreenObject["zoom"].asDouble();
+}
+
+vprobot::ui::CRasterPresentationDriver::~CRasterPresentationDriver() {
+}
+
+/* Залить многоугольник из m_PointsX, m_PointsY (экранные координаты) */
+void vprobot::ui::CRasterPresentationDriver::FillPolygon(uint32_t Color) {
+	size_t n = m_PointsX.size(), i, j;
+	int y, y0, y1;
+
+	if (n < 3)
+		return;
+
+	double MinY = *min_element(m_PointsY.begin(), m_PointsY.end());
+	double MaxY = *max_element(m_PointsY.begin(), m_PointsY.end());
+
+	/* Заливаются пиксели, центры которых внутри (правило чет-нечет) */
+	y0 = static_cast<int>(std::max(ceil(MinY - 0.5), 0.0));
+	y1 = static_cast<int>(std::min(ceil(MaxY - 0.5),
+			static_cast<double>(m_Image.GetHeight())));
+	for (y = y0; y < y1; y++) {
+		double yc = y + 0.5;
+
+		m_Crossings.clear();
+		for (i = 0, j = n - 1; i < n; j = i++) {
+			double ya = m_PointsY[j], yb = m_PointsY[i];
+
+			if ((ya <= yc && yc < yb) || (yb <= yc && yc < ya))
+				m_Crossings.push_back(
+						m_PointsX[j]
+								+ (yc - ya) * (m_PointsX[i] - m_PointsX[j])
+										/ (yb - ya));
+		}
+		sort(m_Crossings.begin(), m_Crossings.end());
+		for (i = 0; i + 1 < m_Crossings.size(); i += 2) {
+			double xa = std::max(ceil(m_Crossings[i] - 0.5), -1.0);
+			double xb = std::min(ceil(m_Crossings[i + 1] - 0.5),
+					static_cast<double>(m_Image.GetWidth()));
+
+			m_Image.FillSpan(y, static_cast<int>(xa), static_cast<int>(xb) - 1,
+					Color);
+		}
+	}
+}
+
+/* Очистить экран */
+void vprobot::ui::CRasterPresentationDriver::Update() {
+	m_Image.Clear(White);
+}
+
+/* Нарисовать точку */
+void vprobot::ui::CRasterPresentationDriver::DrawCircle(double x, double y,
+		double r, int R, int G, int B, int A) {
+	int r_r = static_cast<int>(std::min(m_zoom * r, 1e6)), dy;
+	double r_x, r_y;
+
+	if (r_r <= 0 || A <= 0)
+		return;
+	TranslateCoord(x, y, r_x, r_y);
+
+	int cx = static_cast<int>(floor(r_x)), cy = static_cast<int>(floor(r_y));
+	int dy0 = std::max(-r_r, -cy), dy1 = std::min(r_r,
+			static_cast<int>(m_Image.GetHeight()) - 1 - cy);
+	uint32_t Color = CImage::Color(R, G, B, A);
+
+	for (dy = dy0; dy <= dy1; dy++) {
+		int w = static_cast<int>(sqrt(
+				static_cast<double>(r_r) * r_r - static_cast<double>(dy) * dy));
+
+		m_Image.FillSpan(cy + dy, cx - w, cx + w, Color);
+	}
+}
+
+/* Нарисовать угол */
+void vprobot::ui::CRasterPresentationDriver::DrawPie(double x, double y,
+		double r, double sa, double fa, int R, int G, int B, int A) {
+	double r_r = m_zoom * r, px, py;
+	int n, i;
+
+	if (r_r < 1 || A <= 0)
+		return;
+	n = std::max(2, std::min(180, static_cast<int>(fabs(fa - sa) * r_r / 3) + 2));
+	m_PointsX.clear();
+	m_PointsY.clear();
+	TranslateCoord(x, y, px, py);
+	m_PointsX.push_back(px);
+	m_PointsY.push_back(py);
+	for (i = 0; i <= n; i++) {
+		double t = sa + (fa - sa) * i / n;
+
+		TranslateCoord(x + r * cos(t), y + r * sin(t), px, py);
+		m_PointsX.push_back(px);
+		m_PointsY.push_back(py);
+	}
+	FillPolygon(CImage::Color(R, G, B, A));
+}
+
+/* Нарисовать элипс */
+void vprobot::ui::CRasterPresentationDriver::DrawEllipse(double x, double y,
+		double a, double b, double angle, int R, int G, int B, int A) {
+	double c = cos(angle), s = sin(angle), px, py;
+	int n = std::max(16,
+			std::min(256, static_cast<int>((a + b) * m_zoom * 2))), i;
+
+	if (A <= 0)
+		return;
+	m_PointsX.clear();
+	m_PointsY.clear();
+	for (i = 0; i < n; i++) {
+		double t = 2 * PI * i / n, u = a * cos(t), v = b * sin(t);
+
+		TranslateCoord(x + u * c - v * s, y + u * s + v * c, px, py);
+		m_PointsX.push_back(px);
+		m_PointsY.push_back(py);
+	}
+	FillPolygon(CImage::Color(R, G, B, A));
+}
+
+/* Нарисовать фигуру */
+void vprobot::ui::CRasterPresentationDriver::DrawShape(double *x, double *y,
+		int count, int R, int G, int B, int A, int f_R, int f_G, int f_B,
+		int f_A) {
+	int i;
+
+	if (count <= 0)
+		return;
+	if (f_A > 0) {
+		m_PointsX.resize(count);
+		m_PointsY.resize(count);
+		for (i = 0; i < count; i++)
+			TranslateCoord(x[i], y[i], m_PointsX[i], m_PointsY[i]);
+		FillPolygon(CImage::Color(f_R, f_G, f_B, f_A));
+	}
+	if (A > 0) {
+		for (i = 0; i < count; i++) {
+			int j = (i + 1) % count;
+
+			DrawLine(x[i], y[i], x[j], y[j], R, G, B, A);
+		}
+	}
+}
+
+/* Нарисовать линию */
+void vprobot::ui::CRasterPresentationDriver::DrawLine(double x0, double y0,
+		double xf, double yf, int R, int G, int B, int A) {
+	double r_x0, r_y0, r_xf, r_yf;
+
+	if (A <= 0)
+		return;
+	TranslateCoord(x0, y0, r_x0, r_y0);
+	TranslateCoord(xf, yf, r_xf, r_yf);
+	if (!ClipLine(r_x0, r_y0, r_xf, r_yf, -1, -1, m_Image.GetWidth(),
+			m_Image.GetHeight()))
+		return;
+	m_Image.DrawLine(static_cast<int>(floor(r_x0)),
+			static_cast<int>(floor(r_y0)), static_cast<int>(floor(r_xf)),
+			static_cast<int>(floor(r_yf)), CImage::Color(R, G, B, A));
+}
+
+/* Нарисовать квадрат */
+void vprobot::ui::CRasterPresentationDriver::DrawRectangle(double x0,
+		double y0, double xf, double yf, int R, int G, int B, int A) {
+	double r_x0, r_y0, r_xf, r_yf;
+
+	if (A <= 0)
+		return;
+	TranslateCoord(x0, y0, r_x0, r_y0);
+	TranslateCoord(xf, yf, r_xf, r_yf);
+	m_PointsX.assign({r_x0, r_x0, r_xf, r_xf});
+	m_PointsY.assign({r_y0, r_yf, r_yf, r_y0});
+	FillPolygon(CImage::Color(R, G, B, A));
+}
+
+/* Написать текст */
+void vprobot::ui::CRasterPresentationDriver::PutText(double x, double y,
+		const char *Text, int R, int G, int B, int A) {
+	double r_x, r_y;
+
+	if (A <= 0)
+		return;
+	TranslateCoord(x, y, r_x, r_y);
+	m_Image.PutText(static_cast<int>(floor(r_x)), static_cast<int>(floor(r_y)),
+			Text, CImage::Color(R, G, B, A));
+}
+
+/* Нарисовать сетку */
+void vprobot::ui::CRasterPresentationDriver::DrawGrid(double x0, double y0,
+		double xf, double yf, size_t Width, size_t Height,
+		const unsigned char *Cells, const unsigned char *Palette) {
+	uint32_t Colors[256];
+	bool Opaque = true;
+	double l, t, r, b;
+	int i, px0, px1, py0, py1, x, y;
+
+	TranslateCoord(x0, yf, l, t);
+	TranslateCoord(xf, y0, r, b);
+	if (Width == 0 || Height == 0 || r <= l || b <= t)
+		return;
+	px0 = static_cast<int>(std::max(ceil(l - 0.5), 0.0));
+	px1 = static_cast<int>(std::min(ceil(r - 0.5),
+			static_cast<double>(m_Image.GetWidth()))) - 1;
+	py0 = static_cast<int>(std::max(ceil(t - 0.5), 0.0));
+	py1 = static_cast<int>(std::min(ceil(b - 0.5),
+			static_cast<double>(m_Image.GetHeight()))) - 1;
+	if (px0 > px1 || py0 > py1)
+		return;
+	for (i = 0; i < 256; i++) {
+		const unsigned char *c = Palette + 4 * i;
+
+		Colors[i] = CImage::Color(c[0], c[1], c[2], c[3]);
+		Opaque = Opaque && c[3] == 255;
+	}
+	/* Столбцы сетки для столбцов экрана */
+	m_Columns.resize(px1 - px0 + 1);
+	for (x = px0; x <= px1; x++)
+		m_Columns[x - px0] = std::min(
+				static_cast<size_t>((x + 0.5 - l) / (r - l) * Width),
+				Width - 1);
+	/* Строки сетки идут снизу вверх */
+	for (y = py0; y <= py1; y++) {
+		size_t Row = std::min(static_cast<size_t>((y + 0.5 - t) / (b - t) * Height),
+				Height - 1);
+		const unsigned char *c = Cells + (Height - 1 - Row) * Width;
+		uint32_t *p = m_Image.GetRow(y) + px0;
+
+		if (Opaque) {
+			for (x = 0; x <= px1 - px0; x++)
+				p[x] = Colors[c[m_Columns[x]]];
+		} else {
+			for (x = 0; x <= px1 - px0; x++)
+				m_Image.BlendPixel(px0 + x, y, Colors[c[m_Columns[x]]]);
+		}
+	}
+}
+
+/* Проецировать на общее изображение */
+void vprobot::ui::CRasterPresentationDriver::ProjectToImage(
+		CImage &Image) const {
+	Image.Blit(m_Image, m_x, m_y);
+	Image.DrawFrame(m_x, m_y, m_x + m_Image.GetWidth() - 1,
+			m_y + m_Image.GetHeight() - 1, Black);
+	Image.PutText(m_x + 1, m_y + 1, m_Title.c_str(), Black);
+}
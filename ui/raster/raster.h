@@ -0,0 +1,167 @@
+/*
+ vprobot
+ Copyright (C) 2016 Ivanov Viktor
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __RASTER_H_
+#define __RASTER_H_
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <json/json.h>
+#include "../../model/presentation.h"
+
+namespace vprobot {
+
+namespace ui {
+
+/* Изображение RGBA в памяти (пиксель - R << 24 | G << 16 | B << 8 | A,
+ * строки сверху вниз) */
+class CImage {
+private:
+	std::size_t m_Width;
+	std::size_t m_Height;
+	std::vector<std::uint32_t> m_Pixels;
+public:
+	CImage(std::size_t Width, std::size_t Height);
+
+	/* Упаковать цвет */
+	static inline std::uint32_t Color(int R, int G, int B, int A) {
+		return (static_cast<std::uint32_t>(R & 255) << 24)
+				| (static_cast<std::uint32_t>(G & 255) << 16)
+				| (static_cast<std::uint32_t>(B & 255) << 8)
+				| static_cast<std::uint32_t>(A & 255);
+	}
+
+	/* Размеры */
+	inline std::size_t GetWidth() const {
+		return m_Width;
+	}
+	inline std::size_t GetHeight() const {
+		return m_Height;
+	}
+	/* Строка пикселей */
+	inline std::uint32_t *GetRow(std::size_t y) {
+		return &m_Pixels[y * m_Width];
+	}
+	inline const std::uint32_t *GetRow(std::size_t y) const {
+		return &m_Pixels[y * m_Width];
+	}
+
+	/* Залить изображение */
+	void Clear(std::uint32_t Color);
+	/* Залить отрезок строки [x0, x1] с прозрачностью из Color */
+	void FillSpan(int y, int x0, int x1, std::uint32_t Color);
+	/* Закрасить пиксель */
+	inline void BlendPixel(int x, int y, std::uint32_t Color) {
+		FillSpan(y, x, x, Color);
+	}
+	/* Залить прямоугольник */
+	void FillRectangle(int x0, int y0, int x1, int y1, std::uint32_t Color);
+	/* Нарисовать линию */
+	void DrawLine(int x0, int y0, int x1, int y1, std::uint32_t Color);
+	/* Нарисовать рамку */
+	void DrawFrame(int x0, int y0, int x1, int y1, std::uint32_t Color);
+	/* Написать текст шрифтом 8x8 (x, y - левый верхний угол) */
+	void PutText(int x, int y, const char *Text, std::uint32_t Color);
+	/* Скопировать изображение с наложением по альфа-каналу */
+	void Blit(const CImage &Image, int x, int y);
+
+	/* Сохранить в PNG (false при ошибке записи) */
+	bool SavePNG(const std::string &Name) const;
+	/* Сохранить в PPM (false при ошибке записи) */
+	bool SavePPM(const std::string &Name) const;
+};
+
+/* Драйвер, рисующий в изображение в памяти (без SDL) */
+class CRasterPresentationDriver: public vprobot::presentation::CPresentationDriver {
+private:
+	/* Данные об экране */
+	double m_ofsx;
+	double m_ofsy;
+	double m_zoom;
+	std::string m_Title;
+	/* Положение на общем изображении */
+	int m_x;
+	int m_y;
+	/* Изображение экрана */
+	CImage m_Image;
+	/* Буферы для многоугольников */
+	std::vector<double> m_PointsX;
+	std::vector<double> m_PointsY;
+	std::vector<double> m_Crossings;
+	std::vector<std::size_t> m_Columns;
+
+	/* Функция для преобразования координат */
+	inline void TranslateCoord(double x, double y, double &d_x, double &d_y) const {
+		d_x = (x + m_ofsx) * m_zoom;
+		d_y = m_Image.GetHeight() - (y + m_ofsy) * m_zoom;
+	}
+	/* Залить многоугольник из m_PointsX, m_PointsY (экранные координаты) */
+	void FillPolygon(std::uint32_t Color);
+
+	CRasterPresentationDriver(const CRasterPresentationDriver &Driver) = default;
+public:
+	CRasterPresentationDriver(const Json::Value &ScreenObject);
+	~CRasterPresentationDriver();
+
+	/* Нарисовать точку */
+	void DrawCircle(double x, double y, double r, int R, int G, int B, int A);
+	/* Нарисовать угол */
+	void DrawPie(double x, double y, double r, double sa, double fa, int R,
+			int G, int B, int A);
+	/* Нарисовать элипс */
+	void DrawEllipse(double x, double y, double a, double b, double angle,
+			int R, int G, int B, int A);
+	/* Нарисовать фигуру */
+	void DrawShape(double *x, double *y, int count, int R, int G, int B, int A,
+			int f_R, int f_G, int f_B, int f_A);
+	/* Нарисовать линию */
+	void DrawLine(double x0, double y0, double xf, double yf, int R, int G,
+			int B, int A);
+	/* Нарисовать квадрат */
+	void DrawRectangle(double x0, double y0, double xf, double yf, int R, int G,
+			int B, int A);
+	/* Написать текст */
+	void PutText(double x, double y, const char *Text, int R, int G, int B,
+			int A);
+	/* Нарисовать сетку */
+	void DrawGrid(double x0, double y0, double xf, double yf,
+			std::size_t Width, std::size_t Height, const unsigned char *Cells,
+			const unsigned char *Palette);
+	/* Проецировать на общее изображение */
+	void ProjectToImage(CImage &Image) const;
+	/* Очистить экран */
+	void Update();
+
+	/* Изображение экрана */
+	inline const CImage &GetImage() const {
+		return m_Image;
+	}
+};
+
+}
+
+}
+
+#endif
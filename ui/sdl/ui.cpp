@@ -18,9 +18,12 @@
 
 #include "ui.h"
 
+#include <iostream>
+
 #include <SDL2/SDL2_framerate.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 
+#include "../../model/profiler.h"
 #include "../types.h"
 
 using namespace ::vprobot;
@@ -31,7 +34,8 @@ using namespace ::vprobot::ui;
 
 vprobot::ui::CSDLPresentationDriver::CSDLPresentationDriver(
 		const Json::Value &ScreenObject, SDL_Renderer *Renderer) :
-		m_Title(ScreenObject["title"].asString()), m_Renderer(Renderer), m_Rect() {
+		m_Title(ScreenObject["title"].asString()), m_Renderer(Renderer), m_Rect(), m_GridTexture(
+				NULL), m_GridWidth(0), m_GridHeight(0), m_Sprites(), m_Frame(0) {
 	m_Rect.x = ScreenObject["x"].asInt();
 	m_Rect.y = ScreenObject["y"].asInt();
 	m_Rect.w = ScreenObject["width"].asInt();
@@ -39,11 +43,17 @@ vprobot::ui::CSDLPresentationDriver::CSDLPresentationDriver(
 	m_ofsx = ScreenObject["ofsx"].asDouble();
 	m_ofsy = ScreenObject["ofsy"].asDouble();
 	m_zoom = ScreenObject["zoom"].asDouble();
+	m_MaxSprites = ScreenObject.get("ellipse_cache", 256).asUInt();
 	m_Texture = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_RGBA8888,
 			SDL_TEXTUREACCESS_TARGET, m_Rect.w, m_Rect.h);
 }
 
 vprobot::ui::CSDLPresentationDriver::~CSDLPresentationDriver() {
+	for (auto &s : m_Sprites) {
+		SDL_DestroyTexture(s.second.s_Texture);
+	}
+	if (m_GridTexture != NULL)
+		SDL_DestroyTexture(m_GridTexture);
 	SDL_DestroyTexture(m_Texture);
 }
 
@@ -54,8 +64,49 @@ void vprobot::ui::CSDLPresentationDriver::TranslateCoord(double x, double y,
 	d_y = m_Rect.h - static_cast<Sint16>((y + m_ofsy) * m_zoom);
 }
 
+/* Получить спрайт эллипса (NULL, если не удалось создать) */
+SDL_Texture *vprobot::ui::CSDLPresentationDriver::GetEllipseSprite(Sint16 r_a,
+		Sint16 r_b, int R, int G, int B) {
+	std::uint64_t Key = (static_cast<std::uint64_t>(static_cast<Uint16>(r_a))
+			<< 40) | (static_cast<std::uint64_t>(static_cast<Uint16>(r_b)) << 24)
+			| ((R & 255) << 16) | ((G & 255) << 8) | (B & 255);
+	SpriteCache::iterator i = m_Sprites.find(Key);
+
+	if (i != m_Sprites.end()) {
+		i->second.s_Frame = m_Frame;
+		return i->second.s_Texture;
+	}
+	/* Вытесняем спрайт, который дольше всех не использовался */
+	if (m_Sprites.size() >= m_MaxSprites && !m_Sprites.empty()) {
+		SpriteCache::iterator Oldest = m_Sprites.begin();
+
+		for (i = m_Sprites.begin(); i != m_Sprites.end(); ++i)
+			if (i->second.s_Frame < Oldest->second.s_Frame)
+				Oldest = i;
+		SDL_DestroyTexture(Oldest->second.s_Texture);
+		m_Sprites.erase(Oldest);
+	}
+
+	SDL_Texture *aux = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_RGBA8888,
+			SDL_TEXTUREACCESS_TARGET, r_a * 2 + 2, r_b * 2 + 2);
+
+	if (aux == NULL)
+		return NULL;
+	/* Вне эллипса спрайт прозрачный */
+	SDL_SetRenderTarget(m_Renderer, aux);
+	SDL_SetRenderDrawBlendMode(m_Renderer, SDL_BLENDMODE_NONE);
+	SDL_SetRenderDrawColor(m_Renderer, R, G, B, 0);
+	SDL_RenderClear(m_Renderer);
+	filledEllipseRGBA(m_Renderer, r_a, r_b, r_a, r_b, R, G, B, 255);
+	SDL_SetRenderTarget(m_Renderer, m_Texture);
+	SDL_SetTextureBlendMode(aux, SDL_BLENDMODE_BLEND);
+	m_Sprites[Key] = SSprite { aux, m_Frame };
+	return aux;
+}
+
 /* Обновить экран */
 void vprobot::ui::CSDLPresentationDriver::Update() {
+	m_Frame++;
 	SDL_SetRenderTarget(m_Renderer, m_Texture);
 	SDL_SetRenderDrawColor(m_Renderer, 255, 255, 255, 255);
 	SDL_RenderFillRect(m_Renderer, NULL);
@@ -93,23 +144,23 @@ void vprobot::ui::CSDLPresentationDriver::DrawEllipse(double x, double y,
 
 	r_a = static_cast<Sint16>(a * m_zoom);
 	r_b = static_cast<Sint16>(b * m_zoom);
+	if (r_a <= 0 || r_b <= 0 || A <= 0)
+		return;
 	TranslateCoord(x, y, r_x, r_y);
 	r_w = r_a * 2 + 2;
 	r_h = r_b * 2 + 2;
-	aux = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_RGBA8888,
-			SDL_TEXTUREACCESS_TARGET, r_w, r_h);
-	SDL_SetRenderTarget(m_Renderer, aux);
-	filledEllipseRGBA(m_Renderer, r_a, r_b, r_a, r_b, R, G, B, 255);
-	SDL_SetRenderTarget(m_Renderer, m_Texture);
+	/* Спрайт рисуется один раз на полуоси и цвет, поворот и прозрачность
+	 * задаются при копировании */
+	aux = GetEllipseSprite(r_a, r_b, R, G, B);
+	if (aux == NULL)
+		return;
 
 	SDL_Point i_Center = {r_a, r_b};
 	SDL_Rect i_Rect = {r_x - r_a, r_y - r_b, r_w, r_h};
 
 	SDL_SetTextureAlphaMod(aux, A);
-	SDL_SetTextureBlendMode(aux, SDL_BLENDMODE_NONE);
 	SDL_RenderCopyEx(m_Renderer, aux, NULL, &i_Rect, -angle / PI * 180,
 			&i_Center, SDL_FLIP_NONE);
-	SDL_DestroyTexture(aux);
 }
 
 /* Нарисовать фигуру */
@@ -169,6 +220,62 @@ void vprobot::ui::CSDLPresentationDriver::PutText(double x, double y,
 		stringRGBA(m_Renderer, r_x, r_y, Text, R, G, B, A);
 }
 
+/* Нарисовать сетку */
+void vprobot::ui::CSDLPresentationDriver::DrawGrid(double x0, double y0,
+		double xf, double yf, std::size_t Width, std::size_t Height,
+		const unsigned char *Cells, const unsigned char *Palette) {
+	Uint32 Colors[256];
+	bool Opaque = true;
+	Sint16 r_x0, r_y0, r_xf, r_yf;
+	void *Pixels;
+	int Pitch, i;
+	std::size_t x, y;
+
+	if (Width == 0 || Height == 0)
+		return;
+	if (m_GridTexture == NULL || m_GridWidth != static_cast<int>(Width)
+			|| m_GridHeight != static_cast<int>(Height)) {
+		if (m_GridTexture != NULL)
+			SDL_DestroyTexture(m_GridTexture);
+		m_GridWidth = Width;
+		m_GridHeight = Height;
+		m_GridTexture = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_RGBA8888,
+				SDL_TEXTUREACCESS_STREAMING, m_GridWidth, m_GridHeight);
+		if (m_GridTexture == NULL)
+			return;
+	}
+	/* RGBA8888 - упакованный формат, порядок байт не важен */
+	for (i = 0; i < 256; i++) {
+		const unsigned char *c = Palette + 4 * i;
+
+		Colors[i] = (static_cast<Uint32>(c[0]) << 24)
+				| (static_cast<Uint32>(c[1]) << 16)
+				| (static_cast<Uint32>(c[2]) << 8) | c[3];
+		Opaque = Opaque && c[3] == 255;
+	}
+	if (SDL_LockTexture(m_GridTexture, NULL, &Pixels, &Pitch) != 0)
+		return;
+	/* Строки текстуры идут сверху вниз, строки сетки - снизу вверх */
+	for (y = 0; y < Height; y++) {
+		Uint32 *Row = reinterpret_cast<Uint32 *>(static_cast<Uint8 *>(Pixels)
+				+ (Height - 1 - y) * Pitch);
+		const unsigned char *c = Cells + y * Width;
+
+		for (x = 0; x < Width; x++)
+			Row[x] = Colors[c[x]];
+	}
+	SDL_UnlockTexture(m_GridTexture);
+	SDL_SetTextureBlendMode(m_GridTexture,
+			Opaque ? SDL_BLENDMODE_NONE : SDL_BLENDMODE_BLEND);
+
+	TranslateCoord(x0, yf, r_x0, r_y0);
+	TranslateCoord(xf, y0, r_xf, r_yf);
+
+	SDL_Rect i_Rect = {r_x0, r_y0, r_xf - r_x0, r_yf - r_y0};
+
+	SDL_RenderCopy(m_Renderer, m_GridTexture, NULL, &i_Rect);
+}
+
 /* Проецировать на экран */
 void vprobot::ui::CSDLPresentationDriver::ProjectToSurface() {
 	SDL_SetTextureBlendMode(m_Texture, SDL_BLENDMODE_BLEND);
@@ -183,8 +290,9 @@ void vprobot::ui::CSDLPresentationDriver::ProjectToSurface() {
 
 vprobot::ui::CUI::CUI(CPresentationHandler &Handler,
 		const Json::Value &PresentationObject) :
-		m_Handler(Handler), m_ScreensSet(), m_Quit(false), m_Redraw(false), m_Wait(
-				false), m_HandlerFunction(NULL) {
+		m_Handler(Handler), m_ScreensSet(), m_Writing(0), m_Ready(1), m_Reading(
+				2), m_Fresh(false), m_Quit(false), m_Wait(false), m_HandlerFunction(
+				NULL), m_Recorder(PresentationObject) {
 	int i_w = PresentationObject["width"].asInt(), i_h =
 			PresentationObject["height"].asInt();
 
@@ -195,8 +303,8 @@ vprobot::ui::CUI::CUI(CPresentationHandler &Handler,
 	SDL_WINDOWPOS_UNDEFINED, i_w, i_h, SDL_WINDOW_SHOWN);
 	std::cout << SDL_GetError() << std::endl;
 	m_Renderer = SDL_CreateRenderer(m_Window, -1,
-			SDL_RENDERER_ACCELERATED || SDL_RENDERER_PRESENTVSYNC
-					|| SDL_RENDERER_TARGETTEXTURE);
+			SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
+					| SDL_RENDERER_TARGETTEXTURE);
 	m_Texture = SDL_CreateTexture(m_Renderer, SDL_PIXELFORMAT_RGBA8888,
 			SDL_TEXTUREACCESS_TARGET, i_w, i_h);
 	SDL_SetRenderDrawColor(m_Renderer, 255, 255, 255, 255);
@@ -212,6 +320,11 @@ vprobot::ui::CUI::CUI(CPresentationHandler &Handler,
 	for (i = 0; i < Screens.size(); i++) {
 		m_ScreensSet.push_back(new SScreen(Screens[i], m_Renderer));
 	}
+	for (auto &Shot : m_Snapshots) {
+		for (i = 0; i < Screens.size(); i++) {
+			Shot.push_back(new CDisplayList());
+		}
+	}
 
 	m_MutexDraw = SDL_CreateMutex();
 	m_Cond = SDL_CreateCond();
@@ -223,6 +336,11 @@ vprobot::ui::CUI::~CUI() {
 	for (auto s : m_ScreensSet) {
 		delete s;
 	}
+	for (auto &Shot : m_Snapshots) {
+		for (auto l : Shot) {
+			delete l;
+		}
+	}
 	SDL_DestroyTexture(m_Texture);
 	SDL_DestroyRenderer(m_Renderer);
 	SDL_DestroyWindow(m_Window);
@@ -240,91 +358,116 @@ int vprobot::ui::CUI::ThreadProcess() {
 
 	do {
 		if (i_State == CPresentationHandler::SimulationWait && m_Delay > 0) {
+			profiler::CScopedTimer Timer(profiler::PhaseWait);
+
 			SDL_LockMutex(m_MutexDraw);
-			SDL_CondWaitTimeout(m_Cond, m_MutexDraw, m_Delay);
+			if (!m_Quit)
+				SDL_CondWaitTimeout(m_Cond, m_MutexDraw, m_Delay);
 			SDL_UnlockMutex(m_MutexDraw);
 		}
 		(*m_HandlerFunction)();
 		i_State = m_Handler.GetSimlationState();
+		/* Буфер m_Writing принадлежит этому потоку, блокировка не нужна */
+		Record(m_Snapshots[m_Writing]);
+		/* В файл пишутся только завершенные шаги */
+		if (i_State != CPresentationHandler::SimulationWorking
+				&& m_Recorder.NextStep())
+			m_Recorder.Write(m_Snapshots[m_Writing]);
 		SDL_LockMutex(m_MutexDraw);
+		std::swap(m_Writing, m_Ready);
+		m_Fresh = true;
 		if (i_State == CPresentationHandler::SimulationEnd && m_QuitOnStop)
 			m_Quit = true;
 		else if (i_State == CPresentationHandler::SimulationWait
 				&& m_Delay == 0) {
+			/* Пошаговый режим: ждем нажатия клавиши */
+			profiler::CScopedTimer Timer(profiler::PhaseWait);
+
 			m_Wait = true;
+			while (m_Wait && !m_Quit)
+				SDL_CondWait(m_Cond, m_MutexDraw);
 		}
-		if (m_Quit) {
-			SDL_UnlockMutex(m_MutexDraw);
-			break;
-		}
-		m_Redraw = true;
-		SDL_CondWait(m_Cond, m_MutexDraw);
 		quit = m_Quit;
 		SDL_UnlockMutex(m_MutexDraw);
 	} while (!quit && i_State != CPresentationHandler::SimulationEnd);
 	return 0;
 }
 
+/* Записать снимок презентаций */
+void vprobot::ui::CUI::Record(Snapshot &Shot) {
+	profiler::CScopedTimer Timer(profiler::PhaseRecord);
+	std::size_t i;
+
+	for (i = 0; i < m_ScreensSet.size(); i++) {
+		Shot[i]->Clear();
+		m_Handler.DrawPresentation(*Shot[i], m_ScreensSet[i]->Id);
+	}
+}
+
+/* Вывести снимок на экран */
+void vprobot::ui::CUI::Render(const Snapshot &Shot) {
+	profiler::CScopedTimer Timer(profiler::PhaseRender);
+	std::size_t i;
+
+	for (i = 0; i < m_ScreensSet.size(); i++) {
+		CSDLPresentationDriver &Driver = m_ScreensSet[i]->Driver;
+
+		Driver.Update();
+		Shot[i]->Replay(Driver);
+		SDL_SetRenderTarget(m_Renderer, m_Texture);
+		Driver.ProjectToSurface();
+	}
+	SDL_SetRenderTarget(m_Renderer, NULL);
+}
+
 /* Обновление данных */
 void vprobot::ui::CUI::Process(const HandlerFunction &Function) {
-	bool input = false, quit = false, wait = false;
+	bool input = false, quit = false, fresh;
 	SDL_Thread *i_Thread;
 	FPSmanager manager;
 	SDL_Event e;
 
-	m_Redraw = false;
+	m_Fresh = false;
 	m_HandlerFunction = &Function;
 	SDL_initFramerate(&manager);
 	i_Thread = SDL_CreateThread(ThreadFunction, "GUIThread",
 			static_cast<void *>(this));
 	do {
 		SDL_framerateDelay(&manager);
+		/* Берем последний снимок, промежуточные пропускаются */
 		SDL_LockMutex(m_MutexDraw);
-		if (m_Redraw) {
-			wait = true;
-			SDL_SetRenderDrawColor(m_Renderer, 255, 255, 255, 255);
-			SDL_RenderClear(m_Renderer);
-			for (auto s : m_ScreensSet) {
-				s->Driver.Update();
-				m_Handler.DrawPresentation(s->Driver, s->Name);
-				SDL_SetRenderTarget(m_Renderer, m_Texture);
-				s->Driver.ProjectToSurface();
-			}
-			SDL_SetRenderTarget(m_Renderer, NULL);
-			SDL_RenderCopy(m_Renderer, m_Texture, NULL, NULL);
-			SDL_RenderPresent(m_Renderer);
-			m_Redraw = false;
-		} else {
-			SDL_SetRenderDrawColor(m_Renderer, 255, 255, 255, 255);
-			SDL_RenderClear(m_Renderer);
-			SDL_RenderCopy(m_Renderer, m_Texture, NULL, NULL);
-			SDL_RenderPresent(m_Renderer);
+		fresh = m_Fresh;
+		if (fresh) {
+			std::swap(m_Ready, m_Reading);
+			m_Fresh = false;
 		}
+		SDL_UnlockMutex(m_MutexDraw);
+		if (fresh)
+			Render(m_Snapshots[m_Reading]);
+		SDL_SetRenderDrawColor(m_Renderer, 255, 255, 255, 255);
+		SDL_RenderClear(m_Renderer);
+		SDL_RenderCopy(m_Renderer, m_Texture, NULL, NULL);
+		SDL_RenderPresent(m_Renderer);
 		while (SDL_PollEvent(&e)) {
 			switch (e.type) {
 				case SDL_QUIT:
-					m_Quit = true;
+					quit = true;
 					break;
 				case SDL_KEYDOWN:
 					input = true;
 					break;
 			}
 		}
+		SDL_LockMutex(m_MutexDraw);
+		if (quit)
+			m_Quit = true;
 		if (m_Quit) {
 			SDL_CondSignal(m_Cond);
-		} else if (wait) {
-			if (m_Wait) {
-				if (input) {
-					wait = false;
-					m_Wait = false;
-					input = false;
-					SDL_CondSignal(m_Cond);
-				}
-			} else {
-				wait = false;
-				SDL_CondSignal(m_Cond);
-			}
+		} else if (m_Wait && input) {
+			m_Wait = false;
+			SDL_CondSignal(m_Cond);
 		}
+		input = false;
 		quit = m_Quit;
 		SDL_UnlockMutex(m_MutexDraw);
 	} while (!quit);
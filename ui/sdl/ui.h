@@ -23,12 +23,17 @@
 #include "config.h"
 #endif
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <functional>
 #include <SDL2/SDL.h>
 #include <json/json.h>
 #include "../../model/presentation.h"
+#include "../../model/display-list.h"
+#include "../../model/record.h"
 
 namespace vprobot {
 
@@ -48,6 +53,26 @@ private:
 	SDL_Texture *m_Texture;
 	/* Место, куда будут записываться данные */
 	SDL_Rect m_Rect;
+	/* Текстура для сеток (пересоздается при смене размера) */
+	SDL_Texture *m_GridTexture;
+	int m_GridWidth;
+	int m_GridHeight;
+	/* Спрайт эллипса */
+	struct SSprite {
+		SDL_Texture *s_Texture;
+		/* Кадр последнего использования */
+		std::uint64_t s_Frame;
+	};
+	/* Кэш спрайтов эллипсов по полуосям и цвету */
+	typedef std::unordered_map<std::uint64_t, SSprite> SpriteCache;
+	SpriteCache m_Sprites;
+	/* Наибольшее количество спрайтов */
+	std::size_t m_MaxSprites;
+	/* Номер кадра */
+	std::uint64_t m_Frame;
+
+	/* Получить спрайт эллипса (NULL, если не удалось создать) */
+	SDL_Texture *GetEllipseSprite(Sint16 r_a, Sint16 r_b, int R, int G, int B);
 
 	/* Функция для преобразования координат */
 	void TranslateCoord(double x, double y, Sint16 &d_x, Sint16 &d_y);
@@ -78,6 +103,10 @@ public:
 	/* Написать текст */
 	void PutText(double x, double y, const char *Text, int R, int G, int B,
 			int A);
+	/* Нарисовать сетку */
+	void DrawGrid(double x0, double y0, double xf, double yf,
+			std::size_t Width, std::size_t Height, const unsigned char *Cells,
+			const unsigned char *Palette);
 	/* Проецировать на экран */
 	void ProjectToSurface();
 	/* Обновить экран */
@@ -93,15 +122,18 @@ private:
 	/* Структура для экрана */
 	struct SScreen {
 		CSDLPresentationDriver Driver;
-		std::string Name;
+		vprobot::presentation::PresentationId Id;
 		SScreen(const Json::Value &ScreenObject, SDL_Renderer *ScreenRenderer) :
-				Driver(ScreenObject, ScreenRenderer), Name(
-						ScreenObject["name"].asString()) {
+				Driver(ScreenObject, ScreenRenderer), Id(
+						vprobot::presentation::InternPresentationName(
+								ScreenObject["name"].asString())) {
 		}
 	private:
 		SScreen(const SScreen &Scren) = default;
 	};
 	typedef std::vector<SScreen *> ScreensSet;
+	/* Снимок презентаций (по списку команд на экран) */
+	typedef std::vector<vprobot::presentation::CDisplayList *> Snapshot;
 
 	/* Ссылка на обработчик презентаций */
 	vprobot::presentation::CPresentationHandler &m_Handler;
@@ -113,26 +145,38 @@ private:
 	SDL_Renderer *m_Renderer;
 	/* Текстура */
 	SDL_Texture *m_Texture;
-	/* Мьютекс для обновления экрана */
+	/* Мьютекс для обмена снимками */
 	SDL_mutex *m_MutexDraw;
+	/* Тройной буфер снимков: симуляция пишет в m_Writing, экран выводит
+	 * m_Reading, m_Ready - последний готовый снимок */
+	Snapshot m_Snapshots[3];
+	std::size_t m_Writing;
+	std::size_t m_Ready;
+	std::size_t m_Reading;
+	/* Готов новый снимок */
+	bool m_Fresh;
 	/* Время ожидания */
 	int m_Delay;
 	/* Условие для ожидания нажатия клавишы */
 	SDL_cond *m_Cond;
 	/* Условие завершения цикла (программа закрыта) */
 	bool m_Quit;
-	/* Условие перерисовки */
-	bool m_Redraw;
 	/* Условие ожидания */
 	bool m_Wait;
 	/* Функция обработки */
 	const HandlerFunction* m_HandlerFunction;
 	/* Выходить по окончании симуляции */
 	bool m_QuitOnStop;
+	/* Запись презентаций */
+	vprobot::presentation::CRecorder m_Recorder;
 
 	/* Функция для потока обработки сообщений */
 	static int ThreadFunction(void *data);
 	int ThreadProcess();
+	/* Записать снимок презентаций */
+	void Record(Snapshot &Shot);
+	/* Вывести снимок на экран */
+	void Render(const Snapshot &Shot);
 
 	CUI(const CUI &UI) = default;
 public: